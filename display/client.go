@@ -0,0 +1,121 @@
+package display
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"os"
+	"sync"
+	"syscall"
+)
+
+// Client sends updates to a Server. It is safe for concurrent use; requests
+// are sent one at a time.
+type Client struct {
+	// Shared sends payloads through a shared-memory file passed with the
+	// request instead of copying them through the socket.
+	Shared bool
+
+	mu   sync.Mutex
+	conn *net.UnixConn
+}
+
+// Dial connects to the server socket at path.
+func Dial(path string) (*Client, error) {
+	c, err := net.DialUnix("unix", nil, &net.UnixAddr{Name: path, Net: "unix"})
+	if err != nil {
+		return nil, err
+	}
+	return &Client{conn: c}, nil
+}
+
+// Close closes the connection. Updates already queued are still drawn.
+func (c *Client) Close() error {
+	return c.conn.Close()
+}
+
+// Send submits u and returns StatusQueued, or with FlagWait StatusDrawn or
+// StatusSuperseded. Updates the server rejected or failed to draw return
+// an error.
+func (c *Client) Send(u *Update) (Status, error) {
+	payload, err := encodePayload(u)
+	if err != nil {
+		return StatusFailed, err
+	}
+	h := header{
+		Type:     u.Type,
+		Priority: u.Priority,
+		Flags:    u.Flags &^ FlagShared,
+		Key:      u.Key,
+		Length:   uint32(len(payload)),
+	}
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if c.Shared {
+		err = c.sendShared(h, payload)
+	} else {
+		if len(payload) > maxInlinePayload {
+			return StatusFailed, fmt.Errorf("display: payload of %d bytes exceeds %d", len(payload), maxInlinePayload)
+		}
+		b := make([]byte, headerSize+len(payload))
+		h.marshal(b)
+		copy(b[headerSize:], payload)
+		_, err = c.conn.Write(b)
+	}
+	if err != nil {
+		return StatusFailed, err
+	}
+	return c.readReply()
+}
+
+// sendShared writes the payload to an unlinked file in /dev/shm (a tmpfs,
+// so it stays in memory) and passes its descriptor.
+func (c *Client) sendShared(h header, payload []byte) error {
+	dir := "/dev/shm"
+	if _, err := os.Stat(dir); err != nil {
+		dir = ""
+	}
+	f, err := os.CreateTemp(dir, "jarvis-display-")
+	if err != nil {
+		return err
+	}
+	os.Remove(f.Name())
+	defer f.Close()
+	if _, err := f.Write(payload); err != nil {
+		return err
+	}
+
+	h.Flags |= FlagShared
+	var b [headerSize]byte
+	h.marshal(b[:])
+	n, _, err := c.conn.WriteMsgUnix(b[:], syscall.UnixRights(int(f.Fd())), nil)
+	if err == nil && n != headerSize {
+		err = io.ErrShortWrite
+	}
+	return err
+}
+
+func (c *Client) readReply() (Status, error) {
+	var b [headerSize]byte
+	if _, err := io.ReadFull(c.conn, b[:]); err != nil {
+		return StatusFailed, err
+	}
+	h, err := parseHeader(b[:])
+	if err != nil {
+		return StatusFailed, err
+	}
+	if h.Type != MsgReply || h.Length == 0 || h.Length > maxInlinePayload {
+		return StatusFailed, errors.New("display: malformed reply")
+	}
+	p := make([]byte, h.Length)
+	if _, err := io.ReadFull(c.conn, p); err != nil {
+		return StatusFailed, err
+	}
+	status := Status(p[0])
+	if status == StatusFailed {
+		return status, fmt.Errorf("display: %s", p[1:])
+	}
+	return status, nil
+}
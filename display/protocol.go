@@ -0,0 +1,238 @@
+// Package display lets several producers share the panel. One process owns
+// the panel (lib/screen.c keeps global state and the bcm2835 /dev/mem mapping
+// is exclusive) and runs a Server; producers send it frames, windows or text
+// over a Unix domain socket with a Client.
+//
+// Every message starts with a 16-byte little-endian header:
+//
+//	offset 0  u32 magic "JDP1"
+//	offset 4  u8  type (MsgFrame, MsgWindow, MsgText, MsgReply)
+//	offset 5  u8  priority
+//	offset 6  u16 flags
+//	offset 8  u32 key
+//	offset 12 u32 payload length
+//
+// The payload follows inline, or with FlagShared it is the start of a file
+// descriptor passed alongside the header (SCM_RIGHTS), which the server reads
+// instead of the socket. Payloads are:
+//
+//	MsgFrame   FrameBytes of panel-native frame (see screen.Frame)
+//	MsgWindow  u16 column, u16 row, u16 width, u16 height, then the rows
+//	MsgText    u8 font height, u8 line count, then per line u16 length and bytes
+//	MsgReply   u8 status, then an error message for StatusFailed
+//
+// Updates with the same key replace each other while they wait for the
+// panel, so a producer that outpaces the refresh only ever has its latest
+// update drawn. Key 0 means one slot per connection.
+package display
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+
+	"jarvis/screen"
+)
+
+const (
+	magic      uint32 = 0x3150444a // "JDP1"
+	headerSize        = 16
+
+	maxInlinePayload = 64 << 10
+	maxSharedPayload = 1 << 20
+	maxTextLines     = 32
+)
+
+// MsgType identifies a message.
+type MsgType uint8
+
+const (
+	MsgFrame  MsgType = 1
+	MsgWindow MsgType = 2
+	MsgText   MsgType = 3
+	MsgReply  MsgType = 0x80
+)
+
+// Priority orders waiting updates; higher goes first, ties in arrival order.
+// A refresh already under way is never interrupted.
+type Priority uint8
+
+const (
+	PriorityLow Priority = iota
+	PriorityNormal
+	PriorityHigh
+)
+
+// Flags modify a request.
+type Flags uint16
+
+const (
+	// FlagFullRefresh uses the full waveform (frames and windows only).
+	FlagFullRefresh Flags = 1 << 0
+	// FlagShared means the payload is in the passed file descriptor.
+	FlagShared Flags = 1 << 1
+	// FlagWait delays the reply until the update was drawn or replaced,
+	// instead of as soon as it is queued.
+	FlagWait Flags = 1 << 2
+)
+
+// Status is the outcome reported in a reply.
+type Status uint8
+
+const (
+	StatusQueued Status = iota
+	StatusDrawn
+	StatusSuperseded
+	StatusFailed
+)
+
+var (
+	// ErrSuperseded is reported for an update replaced by a newer one with
+	// the same key before it reached the panel.
+	ErrSuperseded = errors.New("display: update superseded")
+	// ErrClosed is reported for updates still waiting when the server stops.
+	ErrClosed = errors.New("display: server closed")
+)
+
+type header struct {
+	Type     MsgType
+	Priority Priority
+	Flags    Flags
+	Key      uint32
+	Length   uint32
+}
+
+func (h header) marshal(b []byte) {
+	binary.LittleEndian.PutUint32(b[0:], magic)
+	b[4] = byte(h.Type)
+	b[5] = byte(h.Priority)
+	binary.LittleEndian.PutUint16(b[6:], uint16(h.Flags))
+	binary.LittleEndian.PutUint32(b[8:], h.Key)
+	binary.LittleEndian.PutUint32(b[12:], h.Length)
+}
+
+func parseHeader(b []byte) (header, error) {
+	if binary.LittleEndian.Uint32(b[0:]) != magic {
+		return header{}, errors.New("display: bad magic")
+	}
+	return header{
+		Type:     MsgType(b[4]),
+		Priority: Priority(b[5]),
+		Flags:    Flags(binary.LittleEndian.Uint16(b[6:])),
+		Key:      binary.LittleEndian.Uint32(b[8:]),
+		Length:   binary.LittleEndian.Uint32(b[12:]),
+	}, nil
+}
+
+// Window is a rectangle of the panel-native frame, as for screen.PushWindow.
+type Window struct {
+	Column, Row, Width, Height int
+	Data                       []byte
+}
+
+// Text is a list of lines laid out by the library, as for screen.Paint.
+type Text struct {
+	Lines      []string
+	FontHeight int
+}
+
+// Update is one request for the panel. Exactly one of Frame, Window and
+// Text is used, as selected by Type.
+type Update struct {
+	Type     MsgType
+	Priority Priority
+	Flags    Flags
+	Key      uint32
+
+	Frame  []byte
+	Window Window
+	Text   Text
+}
+
+func encodePayload(u *Update) ([]byte, error) {
+	switch u.Type {
+	case MsgFrame:
+		if len(u.Frame) != screen.FrameBytes {
+			return nil, fmt.Errorf("display: frame is %d bytes, want %d", len(u.Frame), screen.FrameBytes)
+		}
+		return u.Frame, nil
+	case MsgWindow:
+		w := u.Window
+		b := make([]byte, 8, 8+len(w.Data))
+		binary.LittleEndian.PutUint16(b[0:], uint16(w.Column))
+		binary.LittleEndian.PutUint16(b[2:], uint16(w.Row))
+		binary.LittleEndian.PutUint16(b[4:], uint16(w.Width))
+		binary.LittleEndian.PutUint16(b[6:], uint16(w.Height))
+		return append(b, w.Data...), nil
+	case MsgText:
+		t := u.Text
+		if len(t.Lines) == 0 || len(t.Lines) > maxTextLines {
+			return nil, fmt.Errorf("display: %d lines, want 1 to %d", len(t.Lines), maxTextLines)
+		}
+		if t.FontHeight < 0 || t.FontHeight > 255 {
+			return nil, fmt.Errorf("display: font height %d out of range", t.FontHeight)
+		}
+		b := []byte{byte(t.FontHeight), byte(len(t.Lines))}
+		for _, line := range t.Lines {
+			if len(line) > 0xFFFF {
+				return nil, errors.New("display: line too long")
+			}
+			b = binary.LittleEndian.AppendUint16(b, uint16(len(line)))
+			b = append(b, line...)
+		}
+		return b, nil
+	}
+	return nil, fmt.Errorf("display: unknown message type %d", u.Type)
+}
+
+// decodePayload fills the update described by h from p. Frame and window
+// data alias p.
+func decodePayload(h header, p []byte) (*Update, error) {
+	u := &Update{Type: h.Type, Priority: h.Priority, Flags: h.Flags &^ FlagShared, Key: h.Key}
+	if u.Priority > PriorityHigh {
+		u.Priority = PriorityHigh
+	}
+	switch h.Type {
+	case MsgFrame:
+		if len(p) != screen.FrameBytes {
+			return nil, fmt.Errorf("frame is %d bytes, want %d", len(p), screen.FrameBytes)
+		}
+		u.Frame = p
+	case MsgWindow:
+		if len(p) < 8 {
+			return nil, errors.New("short window header")
+		}
+		u.Window = Window{
+			Column: int(binary.LittleEndian.Uint16(p[0:])),
+			Row:    int(binary.LittleEndian.Uint16(p[2:])),
+			Width:  int(binary.LittleEndian.Uint16(p[4:])),
+			Height: int(binary.LittleEndian.Uint16(p[6:])),
+			Data:   p[8:],
+		}
+	case MsgText:
+		if len(p) < 2 {
+			return nil, errors.New("short text header")
+		}
+		u.Text.FontHeight = int(p[0])
+		n := int(p[1])
+		if n == 0 || n > maxTextLines {
+			return nil, fmt.Errorf("%d lines, want 1 to %d", n, maxTextLines)
+		}
+		p = p[2:]
+		u.Text.Lines = make([]string, 0, n)
+		for i := 0; i < n; i++ {
+			if len(p) < 2 {
+				return nil, errors.New("truncated text")
+			}
+			l := int(binary.LittleEndian.Uint16(p))
+			if len(p) < 2+l {
+				return nil, errors.New("truncated text")
+			}
+			u.Text.Lines = append(u.Text.Lines, string(p[2:2+l]))
+			p = p[2+l:]
+		}
+	default:
+		return nil, fmt.Errorf("unknown message type %d", h.Type)
+	}
+	return u, nil
+}
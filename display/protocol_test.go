@@ -0,0 +1,127 @@
+package display
+
+import (
+	"bytes"
+	"encoding/binary"
+	"reflect"
+	"strings"
+	"testing"
+
+	"jarvis/screen"
+)
+
+func roundTrip(t *testing.T, u *Update) *Update {
+	t.Helper()
+	p, err := encodePayload(u)
+	if err != nil {
+		t.Fatalf("encode: %v", err)
+	}
+	var b [headerSize]byte
+	header{Type: u.Type, Priority: u.Priority, Flags: u.Flags, Key: u.Key, Length: uint32(len(p))}.marshal(b[:])
+	h, err := parseHeader(b[:])
+	if err != nil {
+		t.Fatalf("parse header: %v", err)
+	}
+	if int(h.Length) != len(p) {
+		t.Fatalf("header length %d, payload %d", h.Length, len(p))
+	}
+	got, err := decodePayload(h, p)
+	if err != nil {
+		t.Fatalf("decode: %v", err)
+	}
+	return got
+}
+
+func TestPayloadRoundTrip(t *testing.T) {
+	frame := screen.NewFrame()
+	frame.Set(10, 20, true)
+	updates := []*Update{
+		{Type: MsgFrame, Priority: PriorityHigh, Flags: FlagFullRefresh, Key: 7, Frame: frame},
+		{Type: MsgWindow, Priority: PriorityLow, Key: 1 << 31, Window: Window{
+			Column: 8, Row: 100, Width: 16, Height: 3, Data: []byte{1, 2, 3, 4, 5, 6},
+		}},
+		{Type: MsgText, Priority: PriorityNormal, Flags: FlagWait, Text: Text{
+			Lines: []string{"hello", "", strings.Repeat("x", 300)}, FontHeight: 16,
+		}},
+	}
+	for _, u := range updates {
+		if got := roundTrip(t, u); !reflect.DeepEqual(got, u) {
+			t.Errorf("type %d: got %+v, want %+v", u.Type, got, u)
+		}
+	}
+}
+
+func TestDecodeDropsSharedFlagAndClampsPriority(t *testing.T) {
+	h := header{Type: MsgText, Priority: 200, Flags: FlagShared | FlagWait}
+	u, err := decodePayload(h, []byte{0, 1, 2, 0, 'h', 'i'})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if u.Flags != FlagWait || u.Priority != PriorityHigh {
+		t.Errorf("flags %d priority %d", u.Flags, u.Priority)
+	}
+}
+
+func TestParseHeaderBadMagic(t *testing.T) {
+	b := make([]byte, headerSize)
+	copy(b, "JDP0")
+	if _, err := parseHeader(b); err == nil {
+		t.Error("bad magic accepted")
+	}
+}
+
+func TestDecodeTruncated(t *testing.T) {
+	text := func(b ...byte) []byte { return b }
+	cases := []struct {
+		name string
+		h    header
+		p    []byte
+	}{
+		{"short frame", header{Type: MsgFrame}, make([]byte, screen.FrameBytes-1)},
+		{"long frame", header{Type: MsgFrame}, make([]byte, screen.FrameBytes+1)},
+		{"window header", header{Type: MsgWindow}, make([]byte, 7)},
+		{"text header", header{Type: MsgText}, text(16)},
+		{"no lines", header{Type: MsgText}, text(16, 0)},
+		{"too many lines", header{Type: MsgText}, text(16, maxTextLines+1)},
+		{"line length", header{Type: MsgText}, text(16, 1, 5)},
+		{"line bytes", header{Type: MsgText}, text(16, 1, 5, 0, 'a', 'b')},
+		{"missing line", header{Type: MsgText}, text(16, 2, 1, 0, 'a')},
+		{"unknown type", header{Type: 9}, nil},
+	}
+	for _, c := range cases {
+		if _, err := decodePayload(c.h, c.p); err == nil {
+			t.Errorf("%s: accepted", c.name)
+		}
+	}
+}
+
+func TestEncodeRejects(t *testing.T) {
+	cases := []*Update{
+		{Type: MsgFrame, Frame: make([]byte, 10)},
+		{Type: MsgText},
+		{Type: MsgText, Text: Text{Lines: make([]string, maxTextLines+1)}},
+		{Type: MsgText, Text: Text{Lines: []string{"a"}, FontHeight: 256}},
+		{Type: MsgText, Text: Text{Lines: []string{strings.Repeat("x", 0x10000)}}},
+		{Type: MsgReply},
+	}
+	for i, u := range cases {
+		if _, err := encodePayload(u); err == nil {
+			t.Errorf("case %d: accepted", i)
+		}
+	}
+}
+
+func TestWindowPayloadLayout(t *testing.T) {
+	p, err := encodePayload(&Update{Type: MsgWindow, Window: Window{Column: 1, Row: 2, Width: 3, Height: 4, Data: []byte{9}}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	want := binary.LittleEndian.AppendUint16(nil, 1)
+	want = binary.LittleEndian.AppendUint16(want, 2)
+	want = binary.LittleEndian.AppendUint16(want, 3)
+	want = binary.LittleEndian.AppendUint16(want, 4)
+	want = append(want, 9)
+	if !bytes.Equal(p, want) {
+		t.Errorf("got % x, want % x", p, want)
+	}
+}
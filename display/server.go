@@ -0,0 +1,435 @@
+package display
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"os"
+	"sync"
+	"syscall"
+
+	"jarvis/screen"
+)
+
+// Panel draws updates for a Server.
+type Panel interface {
+	Draw(u *Update) error
+}
+
+// ScreenPanel draws on the panel through package screen.
+type ScreenPanel struct{}
+
+func (ScreenPanel) Draw(u *Update) error {
+	var flags screen.FrameFlags
+	if u.Flags&FlagFullRefresh != 0 {
+		flags = screen.FullRefresh
+	}
+	switch u.Type {
+	case MsgFrame:
+		return screen.PushFrameFlags(u.Frame, flags)
+	case MsgWindow:
+		w := u.Window
+		return screen.PushWindow(w.Data, w.Column, w.Row, w.Width, w.Height, flags)
+	case MsgText:
+		return screen.Paint(u.Text.Lines, u.Text.FontHeight)
+	}
+	return fmt.Errorf("display: unknown message type %d", u.Type)
+}
+
+// ServerStats counts what happened to submitted updates.
+type ServerStats struct {
+	Submitted  uint64
+	Drawn      uint64
+	Superseded uint64
+	Failed     uint64
+}
+
+// slot holds the update waiting for one coalescing key.
+type slot struct {
+	u    *Update
+	seq  uint64
+	done chan error
+}
+
+func (s *slot) finish(err error) {
+	s.done <- err
+}
+
+type task struct {
+	fn   func()
+	done chan struct{}
+}
+
+// Server serializes every panel access on the goroutine running Run, which
+// is the only one allowed to call into package screen once Run started;
+// other code reaches the panel through Submit and Do.
+type Server struct {
+	// OnDraw, when set before Run, is called on the drawing goroutine after
+	// each update that reached the panel, with the error Draw returned.
+	OnDraw func(u *Update, err error)
+
+	panel Panel
+	wake  chan struct{}
+
+	mu       sync.Mutex
+	slots    map[uint64]*slot
+	tasks    []task
+	seq      uint64
+	conns    uint64
+	stopped  bool
+	counters ServerStats
+}
+
+// NewServer returns a server drawing on p.
+func NewServer(p Panel) *Server {
+	return &Server{
+		panel: p,
+		wake:  make(chan struct{}, 1),
+		slots: make(map[uint64]*slot),
+	}
+}
+
+// slotKey maps a request key to its coalescing slot: non-zero keys are
+// shared across connections, key 0 is private to connection conn.
+func slotKey(conn uint64, key uint32) uint64 {
+	if key != 0 {
+		return uint64(key)
+	}
+	return 1<<32 | conn
+}
+
+func (s *Server) signal() {
+	select {
+	case s.wake <- struct{}{}:
+	default:
+	}
+}
+
+// Submit queues u and returns a channel that receives nil once it was
+// drawn, the error Draw returned, ErrSuperseded when a newer update with
+// the same key replaced it first, or ErrClosed. Key 0 from Submit shares
+// one slot for the whole process. u must not change until then.
+func (s *Server) Submit(u *Update) <-chan error {
+	return s.submit(u, slotKey(0, u.Key))
+}
+
+func (s *Server) submit(u *Update, key uint64) <-chan error {
+	next := &slot{u: u, done: make(chan error, 1)}
+	s.mu.Lock()
+	if s.stopped {
+		s.mu.Unlock()
+		next.finish(ErrClosed)
+		return next.done
+	}
+	s.seq++
+	next.seq = s.seq
+	s.counters.Submitted++
+	prev := s.slots[key]
+	s.slots[key] = next
+	if prev != nil {
+		s.counters.Superseded++
+	}
+	s.mu.Unlock()
+
+	if prev != nil {
+		prev.finish(ErrSuperseded)
+	}
+	s.signal()
+	return next.done
+}
+
+// Do runs fn on the drawing goroutine between two updates and waits for
+// it, for panel calls other than drawing such as screen.Stats. Once Run
+// returned, fn runs on the caller's goroutine.
+func (s *Server) Do(fn func()) {
+	t := task{fn: fn, done: make(chan struct{})}
+	s.mu.Lock()
+	if s.stopped {
+		s.mu.Unlock()
+		fn()
+		return
+	}
+	s.tasks = append(s.tasks, t)
+	s.mu.Unlock()
+	s.signal()
+	<-t.done
+}
+
+// Stats returns the update counters.
+func (s *Server) Stats() ServerStats {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.counters
+}
+
+// takeLocked removes and returns the waiting update to draw next: highest
+// priority first, then oldest.
+func (s *Server) takeLocked() *slot {
+	var best *slot
+	var bestKey uint64
+	for k, sl := range s.slots {
+		if best == nil || sl.u.Priority > best.u.Priority ||
+			(sl.u.Priority == best.u.Priority && sl.seq < best.seq) {
+			best, bestKey = sl, k
+		}
+	}
+	if best != nil {
+		delete(s.slots, bestKey)
+	}
+	return best
+}
+
+// Run draws submitted updates until ctx is done. Updates arriving while
+// the panel refreshes wait in their slot, where newer ones with the same
+// key replace them. A refresh under way when ctx is done is finished first,
+// and nothing is drawn after it, so Do can still turn the panel off.
+func (s *Server) Run(ctx context.Context) {
+	for {
+		if ctx.Err() != nil {
+			s.stop()
+			return
+		}
+		s.mu.Lock()
+		tasks := s.tasks
+		s.tasks = nil
+		next := s.takeLocked()
+		s.mu.Unlock()
+
+		for _, t := range tasks {
+			t.fn()
+			close(t.done)
+		}
+		if next != nil {
+			err := s.panel.Draw(next.u)
+			s.mu.Lock()
+			if err != nil {
+				s.counters.Failed++
+			} else {
+				s.counters.Drawn++
+			}
+			s.mu.Unlock()
+			if s.OnDraw != nil {
+				s.OnDraw(next.u, err)
+			}
+			next.finish(err)
+			continue
+		}
+		if len(tasks) > 0 {
+			continue
+		}
+
+		select {
+		case <-ctx.Done():
+			s.stop()
+			return
+		case <-s.wake:
+		}
+	}
+}
+
+func (s *Server) stop() {
+	s.mu.Lock()
+	s.stopped = true
+	tasks, slots := s.tasks, s.slots
+	s.tasks, s.slots = nil, make(map[uint64]*slot)
+	s.mu.Unlock()
+
+	for _, t := range tasks {
+		t.fn()
+		close(t.done)
+	}
+	for _, sl := range slots {
+		sl.finish(ErrClosed)
+	}
+}
+
+// Listen creates the server socket at path, replacing a stale one left by a
+// previous run. The socket is group-writable so producers running as other
+// users of the panel's group can connect.
+func Listen(path string) (*net.UnixListener, error) {
+	if fi, err := os.Lstat(path); err == nil && fi.Mode()&os.ModeSocket != 0 {
+		if c, err := net.Dial("unix", path); err == nil {
+			c.Close()
+			return nil, fmt.Errorf("display: %s is in use", path)
+		}
+		os.Remove(path)
+	}
+	l, err := net.ListenUnix("unix", &net.UnixAddr{Name: path, Net: "unix"})
+	if err != nil {
+		return nil, err
+	}
+	if err := os.Chmod(path, 0o660); err != nil {
+		l.Close()
+		return nil, err
+	}
+	return l, nil
+}
+
+// Serve accepts producers on l until ctx is done, then closes l.
+func (s *Server) Serve(ctx context.Context, l *net.UnixListener) error {
+	go func() {
+		<-ctx.Done()
+		l.Close()
+	}()
+	for {
+		c, err := l.AcceptUnix()
+		if err != nil {
+			if ctx.Err() != nil {
+				return nil
+			}
+			return err
+		}
+		s.mu.Lock()
+		s.conns++
+		id := s.conns
+		s.mu.Unlock()
+		go s.handle(c, id)
+	}
+}
+
+// handle reads requests from one producer. Replies go out in request order:
+// right after queueing, or with FlagWait once the update was drawn.
+func (s *Server) handle(c *net.UnixConn, id uint64) {
+	defer c.Close()
+	var hbuf [headerSize]byte
+	for {
+		h, fd, err := readHeader(c, hbuf[:])
+		if err != nil {
+			return
+		}
+		payload, err := readPayload(c, h, fd)
+		if err != nil {
+			writeReply(c, h.Key, StatusFailed, err)
+			return
+		}
+		u, err := decodePayload(h, payload)
+		if err != nil {
+			if writeReply(c, h.Key, StatusFailed, err) != nil {
+				return
+			}
+			continue
+		}
+
+		done := s.submit(u, slotKey(id, h.Key))
+		status := StatusQueued
+		if h.Flags&FlagWait != 0 {
+			switch err = <-done; err {
+			case nil:
+				status = StatusDrawn
+			case ErrSuperseded:
+				status, err = StatusSuperseded, nil
+			default:
+				status = StatusFailed
+			}
+		}
+		if writeReply(c, h.Key, status, err) != nil {
+			return
+		}
+	}
+}
+
+// readHeader reads one header and the file descriptor passed with it, or -1.
+func readHeader(c *net.UnixConn, b []byte) (header, int, error) {
+	oob := make([]byte, syscall.CmsgSpace(4))
+	fd := -1
+	for n := 0; n < headerSize; {
+		m, oobn, _, _, err := c.ReadMsgUnix(b[n:headerSize], oob)
+		if oobn > 0 {
+			for _, f := range parseRights(oob[:oobn]) {
+				if fd < 0 {
+					fd = f
+				} else {
+					syscall.Close(f)
+				}
+			}
+		}
+		if err == nil && m == 0 {
+			err = io.EOF
+		}
+		if err != nil {
+			if fd >= 0 {
+				syscall.Close(fd)
+			}
+			return header{}, -1, err
+		}
+		n += m
+	}
+	h, err := parseHeader(b)
+	if err != nil && fd >= 0 {
+		syscall.Close(fd)
+	}
+	return h, fd, err
+}
+
+func parseRights(oob []byte) []int {
+	msgs, err := syscall.ParseSocketControlMessage(oob)
+	if err != nil {
+		return nil
+	}
+	var fds []int
+	for i := range msgs {
+		if f, err := syscall.ParseUnixRights(&msgs[i]); err == nil {
+			fds = append(fds, f...)
+		}
+	}
+	return fds
+}
+
+// readPayload returns the payload described by h: read from the socket, or
+// from the start of fd for FlagShared. fd is closed in every case.
+//
+// A shared payload is read into private memory rather than mapped. The
+// client keeps its descriptor and could shrink the file while the update
+// waits for the panel, and touching a mapping past the new end would kill
+// the server with SIGBUS; a short read is only an error.
+func readPayload(c *net.UnixConn, h header, fd int) ([]byte, error) {
+	if h.Flags&FlagShared == 0 {
+		if fd >= 0 {
+			syscall.Close(fd)
+		}
+		if h.Length > maxInlinePayload {
+			return nil, fmt.Errorf("payload of %d bytes exceeds %d", h.Length, maxInlinePayload)
+		}
+		p := make([]byte, h.Length)
+		_, err := io.ReadFull(c, p)
+		return p, err
+	}
+
+	if fd < 0 {
+		return nil, errors.New("shared payload without a file descriptor")
+	}
+	defer syscall.Close(fd)
+	if h.Length == 0 || h.Length > maxSharedPayload {
+		return nil, fmt.Errorf("shared payload of %d bytes, want 1 to %d", h.Length, maxSharedPayload)
+	}
+	p := make([]byte, h.Length)
+	for n := 0; n < len(p); {
+		m, err := syscall.Pread(fd, p[n:], int64(n))
+		if err == syscall.EINTR {
+			continue
+		}
+		if err != nil {
+			return nil, err
+		}
+		if m == 0 {
+			return nil, fmt.Errorf("shared payload of %d bytes in a %d-byte file", h.Length, n)
+		}
+		n += m
+	}
+	return p, nil
+}
+
+func writeReply(c *net.UnixConn, key uint32, status Status, err error) error {
+	msg := ""
+	if status == StatusFailed && err != nil {
+		msg = err.Error()
+	}
+	b := make([]byte, headerSize+1+len(msg))
+	header{Type: MsgReply, Key: key, Length: uint32(1 + len(msg))}.marshal(b)
+	b[headerSize] = byte(status)
+	copy(b[headerSize+1:], msg)
+	_, werr := c.Write(b)
+	return werr
+}
@@ -0,0 +1,274 @@
+package display
+
+import (
+	"context"
+	"errors"
+	"net"
+	"os"
+	"path/filepath"
+	"sync"
+	"syscall"
+	"testing"
+	"time"
+
+	"jarvis/screen"
+)
+
+// fakePanel records the updates drawn, optionally blocking each Draw until
+// released.
+type fakePanel struct {
+	mu    sync.Mutex
+	drawn []*Update
+	gate  chan struct{}
+	err   error
+}
+
+func (p *fakePanel) Draw(u *Update) error {
+	if p.gate != nil {
+		<-p.gate
+	}
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.drawn = append(p.drawn, u)
+	return p.err
+}
+
+func (p *fakePanel) keys() []uint32 {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	var keys []uint32
+	for _, u := range p.drawn {
+		keys = append(keys, u.Key)
+	}
+	return keys
+}
+
+func textUpdate(key uint32, prio Priority, line string) *Update {
+	return &Update{Type: MsgText, Priority: prio, Key: key, Text: Text{Lines: []string{line}}}
+}
+
+func TestTakeOrderAndCoalescing(t *testing.T) {
+	s := NewServer(&fakePanel{})
+	low := s.Submit(textUpdate(1, PriorityLow, "low"))
+	first := s.Submit(textUpdate(2, PriorityNormal, "first"))
+	s.Submit(textUpdate(3, PriorityHigh, "high"))
+	s.Submit(textUpdate(4, PriorityNormal, "other"))
+	s.Submit(textUpdate(2, PriorityNormal, "second"))
+
+	if err := <-first; err != ErrSuperseded {
+		t.Fatalf("replaced update: %v, want ErrSuperseded", err)
+	}
+	select {
+	case err := <-low:
+		t.Fatalf("low priority update finished early: %v", err)
+	default:
+	}
+
+	// Highest priority first, ties by arrival, and the replacement of key 2
+	// arrived after key 4
+	var got []string
+	s.mu.Lock()
+	for sl := s.takeLocked(); sl != nil; sl = s.takeLocked() {
+		got = append(got, sl.u.Text.Lines[0])
+	}
+	s.mu.Unlock()
+	want := []string{"high", "other", "second", "low"}
+	if len(got) != len(want) {
+		t.Fatalf("got %q, want %q", got, want)
+	}
+	for i := range want {
+		if got[i] != want[i] {
+			t.Fatalf("got %q, want %q", got, want)
+		}
+	}
+	if st := s.Stats(); st.Submitted != 5 || st.Superseded != 1 {
+		t.Errorf("stats %+v", st)
+	}
+}
+
+func TestRunCoalescesWhileDrawing(t *testing.T) {
+	panel := &fakePanel{gate: make(chan struct{})}
+	s := NewServer(panel)
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	go s.Run(ctx)
+
+	busy := s.Submit(textUpdate(1, PriorityNormal, "busy"))
+	// Wait until the first update is being drawn
+	for {
+		s.mu.Lock()
+		n := len(s.slots)
+		s.mu.Unlock()
+		if n == 0 {
+			break
+		}
+		time.Sleep(time.Millisecond)
+	}
+	stale := s.Submit(textUpdate(1, PriorityNormal, "stale"))
+	latest := s.Submit(textUpdate(1, PriorityNormal, "latest"))
+	close(panel.gate)
+
+	for _, c := range []struct {
+		done <-chan error
+		want error
+	}{{busy, nil}, {stale, ErrSuperseded}, {latest, nil}} {
+		if err := <-c.done; err != c.want {
+			t.Errorf("got %v, want %v", err, c.want)
+		}
+	}
+	if keys := panel.keys(); len(keys) != 2 {
+		t.Errorf("drew %d updates, want 2", len(keys))
+	}
+	if st := s.Stats(); st.Drawn != 2 || st.Superseded != 1 {
+		t.Errorf("stats %+v", st)
+	}
+}
+
+func TestSubmitAfterStop(t *testing.T) {
+	s := NewServer(&fakePanel{})
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	s.Run(ctx)
+	if err := <-s.Submit(textUpdate(1, PriorityNormal, "late")); err != ErrClosed {
+		t.Errorf("got %v, want ErrClosed", err)
+	}
+}
+
+func TestDrawErrorIsReported(t *testing.T) {
+	panel := &fakePanel{err: errors.New("broken")}
+	s := NewServer(panel)
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	go s.Run(ctx)
+	if err := <-s.Submit(textUpdate(1, PriorityNormal, "x")); err != panel.err {
+		t.Errorf("got %v, want %v", err, panel.err)
+	}
+	if st := s.Stats(); st.Failed != 1 {
+		t.Errorf("stats %+v", st)
+	}
+}
+
+// startServer serves a fake panel on a socket in a temporary directory.
+func startServer(t *testing.T) (*fakePanel, string) {
+	t.Helper()
+	path := filepath.Join(t.TempDir(), "display.sock")
+	l, err := Listen(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	panel := &fakePanel{}
+	s := NewServer(panel)
+	ctx, cancel := context.WithCancel(context.Background())
+	t.Cleanup(cancel)
+	go s.Run(ctx)
+	go s.Serve(ctx, l)
+	return panel, path
+}
+
+func TestClientServer(t *testing.T) {
+	panel, path := startServer(t)
+	frame := screen.NewFrame()
+	frame.Set(5, 5, true)
+	for _, shared := range []bool{false, true} {
+		c, err := Dial(path)
+		if err != nil {
+			t.Fatal(err)
+		}
+		c.Shared = shared
+		status, err := c.Send(&Update{Type: MsgFrame, Flags: FlagWait, Key: 9, Frame: frame})
+		if err != nil || status != StatusDrawn {
+			t.Fatalf("shared=%v: status %d, %v", shared, status, err)
+		}
+		status, err = c.Send(&Update{Type: MsgText, Text: Text{Lines: []string{"queued"}}})
+		if err != nil || status != StatusQueued {
+			t.Fatalf("shared=%v: status %d, %v", shared, status, err)
+		}
+		if _, err := c.Send(&Update{Type: MsgWindow, Flags: FlagWait, Window: Window{Width: 8, Height: 1}}); err != nil {
+			t.Fatalf("shared=%v: window: %v", shared, err)
+		}
+		c.Close()
+	}
+	panel.mu.Lock()
+	defer panel.mu.Unlock()
+	if len(panel.drawn) == 0 || string(panel.drawn[0].Frame) != string(frame) {
+		t.Error("frame did not arrive intact")
+	}
+}
+
+// sendRaw writes a header, with fd attached when it is not negative, and
+// returns the reply status.
+func sendRaw(t *testing.T, path string, h header, payload []byte, fd int) (Status, error) {
+	t.Helper()
+	conn, err := net.DialUnix("unix", nil, &net.UnixAddr{Name: path, Net: "unix"})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer conn.Close()
+	b := make([]byte, headerSize)
+	h.marshal(b)
+	var oob []byte
+	if fd >= 0 {
+		oob = syscall.UnixRights(fd)
+	}
+	if _, _, err := conn.WriteMsgUnix(b, oob, nil); err != nil {
+		t.Fatal(err)
+	}
+	if len(payload) > 0 {
+		if _, err := conn.Write(payload); err != nil {
+			t.Fatal(err)
+		}
+	}
+	c := &Client{conn: conn}
+	return c.readReply()
+}
+
+func TestOversizedPayloads(t *testing.T) {
+	_, path := startServer(t)
+	status, err := sendRaw(t, path, header{Type: MsgText, Length: maxInlinePayload + 1}, nil, -1)
+	if status != StatusFailed || err == nil {
+		t.Errorf("inline: status %d, %v", status, err)
+	}
+
+	f, err := os.CreateTemp(t.TempDir(), "payload")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+	status, err = sendRaw(t, path, header{Type: MsgFrame, Flags: FlagShared, Length: maxSharedPayload + 1}, nil, int(f.Fd()))
+	if status != StatusFailed || err == nil {
+		t.Errorf("shared: status %d, %v", status, err)
+	}
+	status, err = sendRaw(t, path, header{Type: MsgFrame, Flags: FlagShared, Length: screen.FrameBytes}, nil, -1)
+	if status != StatusFailed || err == nil {
+		t.Errorf("shared without fd: status %d, %v", status, err)
+	}
+}
+
+func TestTruncatedSharedPayload(t *testing.T) {
+	_, path := startServer(t)
+	f, err := os.CreateTemp(t.TempDir(), "payload")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+	if _, err := f.Write(make([]byte, screen.FrameBytes/2)); err != nil {
+		t.Fatal(err)
+	}
+	status, err := sendRaw(t, path, header{Type: MsgFrame, Flags: FlagShared, Length: screen.FrameBytes}, nil, int(f.Fd()))
+	if status != StatusFailed || err == nil {
+		t.Errorf("status %d, %v", status, err)
+	}
+}
+
+func TestTruncatedInlinePayload(t *testing.T) {
+	panel, path := startServer(t)
+	// A text payload whose line runs past the declared length
+	p := []byte{16, 1, 10, 0, 'a'}
+	status, err := sendRaw(t, path, header{Type: MsgText, Length: uint32(len(p))}, p, -1)
+	if status != StatusFailed || err == nil {
+		t.Errorf("status %d, %v", status, err)
+	}
+	if keys := panel.keys(); len(keys) != 0 {
+		t.Errorf("drew %d updates", len(keys))
+	}
+}
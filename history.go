@@ -0,0 +1,87 @@
+package main
+
+import (
+	"fmt"
+	"net/http"
+	"path"
+	"strconv"
+	"strings"
+	"text/tabwriter"
+	"time"
+
+	"jarvis/screen"
+)
+
+// framesPath serves the frame history next to the metrics:
+//
+//	/frames/             the frames held, oldest first, with their timings
+//	/frames/<seq>.png    one of them, also as .pbm
+//	/frames/current.png  the last frame sent, ?panel=N for another panel
+//
+// The history is locked inside the library, so these may be served while
+// the display loop paints.
+const framesPath = "/frames/"
+
+type frameHistory struct{}
+
+func (frameHistory) ServeHTTP(w http.ResponseWriter, r *http.Request) {
+	name := strings.TrimPrefix(r.URL.Path, framesPath)
+	if name == "" {
+		writeHistory(w)
+		return
+	}
+	ext := path.Ext(name)
+	if ext != ".png" && ext != ".pbm" {
+		http.NotFound(w, r)
+		return
+	}
+
+	var frame screen.Frame
+	var err error
+	if base := strings.TrimSuffix(name, ext); base == "current" {
+		panel := 0
+		if s := r.URL.Query().Get("panel"); s != "" {
+			if panel, err = strconv.Atoi(s); err != nil {
+				http.Error(w, "bad panel", http.StatusBadRequest)
+				return
+			}
+		}
+		frame, err = screen.CurrentFrame(panel)
+	} else {
+		seq, perr := strconv.ParseUint(base, 10, 64)
+		if perr != nil {
+			http.NotFound(w, r)
+			return
+		}
+		frame, _, err = screen.HistoryFrame(seq)
+	}
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusNotFound)
+		return
+	}
+
+	if ext == ".png" {
+		w.Header().Set("Content-Type", "image/png")
+		frame.WritePNG(w)
+	} else {
+		w.Header().Set("Content-Type", "image/x-portable-bitmap")
+		frame.WritePBM(w)
+	}
+}
+
+func writeHistory(w http.ResponseWriter) {
+	w.Header().Set("Content-Type", "text/plain; charset=utf-8")
+	entries := screen.History()
+	size := 0
+	for _, e := range entries {
+		size += e.Size
+	}
+	fmt.Fprintf(w, "%d frames in %d bytes\n\n", len(entries), size)
+	tw := tabwriter.NewWriter(w, 0, 0, 2, ' ', 0)
+	fmt.Fprintln(tw, "seq\ttime\tpanel\tmode\tbytes\tlayout\traster\tresume\tupload\tbusy")
+	for _, e := range entries {
+		fmt.Fprintf(tw, "%d\t%s\t%d\t%s\t%d\t%s\t%s\t%s\t%s\t%s\n", e.Seq, e.Time.Format(time.RFC3339Nano),
+			e.Panel, e.Mode, e.Size, e.Layout, e.Raster, e.Resume, e.Upload, e.Busy)
+	}
+	tw.Flush()
+}
@@ -0,0 +1,243 @@
+// Asset pack check, built against the simulated panel (make test). Opens a
+// pack written by tools/mkassets, finds every sample image byte-identical to
+// its array in ImageData*.c, then feeds GUI_AssetPack_Open truncated and
+// corrupt copies, all of which must be rejected.
+//
+//   assetpack assets.pak
+//
+// The arrays are compiled into this file so their sizes are known; the list
+// of names is generated from the same sources by the Makefile.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "GUI/GUI_AssetPack.h"
+
+#include "GUI/ImageData.c"
+#include "GUI/ImageData2.c"
+
+typedef struct {
+  const char *name;
+  const unsigned char *data;
+  size_t size;
+} asset;
+
+#define ASSET(n) {#n, n, sizeof(n)},
+static const asset assets[] = {
+#include "asset_list.h"
+};
+#undef ASSET
+
+#define ENTRY_OFFSET(i)                                                        \
+  (sizeof(GUI_ASSETPACK_HEADER) + (size_t)(i) * sizeof(GUI_ASSETPACK_ENTRY))
+
+static char pak_path[] = "/tmp/assetpack-XXXXXX";
+
+static bool check_lookups(const char *path) {
+  GUI_ASSETPACK pack;
+  const size_t count = sizeof(assets) / sizeof(assets[0]);
+  bool ok = true;
+
+  if (GUI_AssetPack_Open(&pack, path) != 0) {
+    fprintf(stderr, "assetpack: cannot open %s\n", path);
+    return false;
+  }
+  if (pack.Count != count) {
+    fprintf(stderr, "assetpack: %u assets in %s, %zu in the sources\n",
+            pack.Count, path, count);
+    ok = false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    UDOUBLE size = 0;
+    const UBYTE *data = GUI_AssetPack_Find(&pack, assets[i].name, &size);
+    if (data == NULL || size != assets[i].size ||
+        memcmp(data, assets[i].data, size) != 0) {
+      fprintf(stderr, "assetpack: %s %s\n", assets[i].name,
+              data == NULL ? "missing" : "differs from its array");
+      ok = false;
+    }
+  }
+  const char *unknown[] = {"", "gImage_", "gImage_2in13_3", "zzz"};
+  for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); ++i) {
+    if (GUI_AssetPack_Find(&pack, unknown[i], NULL) != NULL) {
+      fprintf(stderr, "assetpack: found unknown asset \"%s\"\n", unknown[i]);
+      ok = false;
+    }
+  }
+  GUI_AssetPack_Close(&pack);
+  return ok;
+}
+
+static GUI_ASSETPACK_ENTRY *entry(UBYTE *buf, int i) {
+  return (GUI_ASSETPACK_ENTRY *)(buf + ENTRY_OFFSET(i));
+}
+
+static void bad_magic(UBYTE *buf, size_t *len) {
+  (void)len;
+  buf[0] = 'X';
+}
+
+static void bad_version(UBYTE *buf, size_t *len) {
+  (void)len;
+  ((GUI_ASSETPACK_HEADER *)buf)->Version = GUI_ASSETPACK_VERSION + 1;
+}
+
+static void count_past_eof(UBYTE *buf, size_t *len) {
+  (void)len;
+  ((GUI_ASSETPACK_HEADER *)buf)->Count = 0xFFFF;
+}
+
+static void cut_header(UBYTE *buf, size_t *len) {
+  (void)buf;
+  *len = sizeof(GUI_ASSETPACK_HEADER) - 1;
+}
+
+static void cut_index(UBYTE *buf, size_t *len) {
+  *len = ENTRY_OFFSET(((GUI_ASSETPACK_HEADER *)buf)->Count) - 1;
+}
+
+static void cut_last_byte(UBYTE *buf, size_t *len) {
+  (void)buf;
+  *len -= 1;
+}
+
+static void size_past_eof(UBYTE *buf, size_t *len) {
+  GUI_ASSETPACK_ENTRY *e = entry(buf, 0);
+  e->Size = *len - e->Offset + 1;
+}
+
+static void offset_past_eof(UBYTE *buf, size_t *len) {
+  entry(buf, 1)->Offset = *len + 1;
+  entry(buf, 1)->Size = 0;
+}
+
+static void offset_wraps(UBYTE *buf, size_t *len) {
+  (void)len;
+  entry(buf, 1)->Offset = 0xFFFFFFF0;
+  entry(buf, 1)->Size = 0x20;
+}
+
+static void unsorted(UBYTE *buf, size_t *len) {
+  (void)len;
+  GUI_ASSETPACK_ENTRY tmp = *entry(buf, 1);
+  *entry(buf, 1) = *entry(buf, 2);
+  *entry(buf, 2) = tmp;
+}
+
+static void duplicate(UBYTE *buf, size_t *len) {
+  (void)len;
+  memcpy(entry(buf, 2)->Name, entry(buf, 1)->Name, GUI_ASSETPACK_NAME_LEN);
+}
+
+static void unterminated(UBYTE *buf, size_t *len) {
+  (void)len;
+  // Still sorts last, so only the missing NUL is wrong
+  int last = ((GUI_ASSETPACK_HEADER *)buf)->Count - 1;
+  memset(entry(buf, last)->Name, 'z', GUI_ASSETPACK_NAME_LEN);
+}
+
+static const struct {
+  const char *name;
+  void (*edit)(UBYTE *buf, size_t *len);
+} corruptions[] = {
+    {"bad magic", bad_magic},
+    {"bad version", bad_version},
+    {"count past EOF", count_past_eof},
+    {"cut in the header", cut_header},
+    {"cut in the index", cut_index},
+    {"cut in the last asset", cut_last_byte},
+    {"size past EOF", size_past_eof},
+    {"offset past EOF", offset_past_eof},
+    {"offset + size wraps", offset_wraps},
+    {"unsorted index", unsorted},
+    {"duplicate name", duplicate},
+    {"unterminated name", unterminated},
+};
+
+static UBYTE *read_file(const char *path, size_t *len) {
+  FILE *f = fopen(path, "rb");
+  UBYTE *buf = NULL;
+  long size;
+  if (f == NULL)
+    return NULL;
+  if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 &&
+      fseek(f, 0, SEEK_SET) == 0 && (buf = malloc(size)) != NULL &&
+      fread(buf, 1, size, f) != (size_t)size) {
+    free(buf);
+    buf = NULL;
+  }
+  if (buf != NULL)
+    *len = size;
+  fclose(f);
+  return buf;
+}
+
+static bool write_file(const char *path, const UBYTE *buf, size_t len) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+  bool ok = fwrite(buf, 1, len, f) == len;
+  return fclose(f) == 0 && ok;
+}
+
+static bool check_corrupt(const char *path) {
+  size_t len = 0;
+  UBYTE *good = read_file(path, &len);
+  if (good == NULL || len < ENTRY_OFFSET(3)) {
+    fprintf(stderr, "assetpack: cannot read %s\n", path);
+    free(good);
+    return false;
+  }
+  UBYTE *buf = malloc(len);
+  bool ok = true;
+
+  // The unmodified copy opens, so a rejection below is down to the edit
+  for (size_t i = 0; i <= sizeof(corruptions) / sizeof(corruptions[0]); ++i) {
+    const char *name = i == 0 ? "copy" : corruptions[i - 1].name;
+    size_t n = len;
+    memcpy(buf, good, len);
+    if (i > 0)
+      corruptions[i - 1].edit(buf, &n);
+    if (!write_file(pak_path, buf, n)) {
+      fprintf(stderr, "assetpack: cannot write %s\n", pak_path);
+      ok = false;
+      break;
+    }
+    GUI_ASSETPACK pack;
+    bool opened = GUI_AssetPack_Open(&pack, pak_path) == 0;
+    if (opened)
+      GUI_AssetPack_Close(&pack);
+    if (opened != (i == 0)) {
+      fprintf(stderr, "assetpack: %s %s\n", name,
+              opened ? "accepted" : "rejected");
+      ok = false;
+    }
+  }
+  free(buf);
+  free(good);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s assets.pak\n", argv[0]);
+    return 2;
+  }
+  int fd = mkstemp(pak_path);
+  if (fd < 0 || close(fd) != 0) {
+    fprintf(stderr, "assetpack: cannot create %s\n", pak_path);
+    return 1;
+  }
+
+  bool ok = check_lookups(argv[1]);
+  ok = check_corrupt(argv[1]) && ok;
+  unlink(pak_path);
+  if (!ok)
+    return 1;
+  printf("ok   %zu assets, %zu corrupt packs rejected\n",
+         sizeof(assets) / sizeof(assets[0]),
+         sizeof(corruptions) / sizeof(corruptions[0]));
+  return 0;
+}
@@ -0,0 +1,290 @@
+// Microbenchmarks for the rendering and upload paths, built against the
+// simulated panel (make bench). Results are printed in the Go benchmark
+// format so benchstat can compare runs.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Config/DEV_Config.h"
+#include "EPD_2in13_V4.h"
+#include "Fonts/fonts.h"
+#include "GUI/GUI_BMPfile.h"
+#include "GUI/GUI_Cache.h"
+#include "GUI/GUI_Paint.h"
+#include "screen.h"
+#include "testbmp.h"
+
+#define BENCH_TARGET_NS 500000000ULL // per benchmark, like -benchtime=0.5s
+
+typedef void (*bench_fn)(long n, void *arg);
+
+static UBYTE frame[SCREEN_FRAME_BYTES];
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Grows n until a run takes BENCH_TARGET_NS, the same way testing.B does.
+// Benchmarks that drive the panel also report the SPI throughput and the
+// GPIO writes per op, which is what the transfer framing costs on the Pi,
+// where each GPIO write is a register access the simulator skips.
+static void run(const char *name, bench_fn fn, void *arg) {
+  long n = 1;
+  uint64_t elapsed;
+  DEV_STATS before;
+  for (;;) {
+    before = DEV_Stats_Get();
+    uint64_t start = now_ns();
+    fn(n, arg);
+    elapsed = now_ns() - start;
+    if (elapsed >= BENCH_TARGET_NS || n >= 1000000000L) {
+      break;
+    }
+    uint64_t per_op = elapsed / (uint64_t)n + 1;
+    uint64_t next = BENCH_TARGET_NS / per_op * 6 / 5;
+    if (next > (uint64_t)n * 100) {
+      next = (uint64_t)n * 100;
+    }
+    if (next <= (uint64_t)n) {
+      next = (uint64_t)n + 1;
+    }
+    n = (long)next;
+  }
+  printf("Benchmark%s\t%10ld\t%12.1f ns/op", name, n,
+         (double)elapsed / (double)n);
+  DEV_STATS after = DEV_Stats_Get();
+  uint64_t spi = after.SpiBytes - before.SpiBytes;
+  uint64_t gpio = after.GpioWrites - before.GpioWrites;
+  if (spi > 0) {
+    printf("\t%8.2f MB/s", (double)spi * 1e3 / (double)elapsed);
+  }
+  if (gpio > 0) {
+    printf("\t%10.1f gpio-writes/op", (double)gpio / (double)n);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+static void select_frame(void) {
+  Paint_NewImage(frame, EPD_2in13_V4_WIDTH, EPD_2in13_V4_HEIGHT, ROTATE_90,
+                 WHITE);
+  Paint_SelectImage(frame);
+}
+
+static void bench_clear(long n, void *arg) {
+  (void)arg;
+  for (long i = 0; i < n; ++i) {
+    Paint_Clear(i & 1 ? BLACK : WHITE);
+  }
+}
+
+// One op sets every pixel of the landscape frame.
+static void bench_set_pixel_frame(long n, void *arg) {
+  (void)arg;
+  for (long i = 0; i < n; ++i) {
+    UWORD color = i & 1 ? BLACK : WHITE;
+    for (UWORD y = 0; y < Paint.Height; ++y) {
+      for (UWORD x = 0; x < Paint.Width; ++x) {
+        Paint_SetPixel(x, y, color);
+      }
+    }
+  }
+}
+
+static void bench_draw_char(long n, void *arg) {
+  sFONT *font = arg;
+  for (long i = 0; i < n; ++i) {
+    Paint_DrawChar(0, 0, (char)('A' + i % 26), font, BLACK, WHITE);
+  }
+}
+
+// One op draws a line of text as wide as the panel allows.
+static void bench_draw_string(long n, void *arg) {
+  sFONT *font = arg;
+  char text[64];
+  int len = EPD_2in13_V4_HEIGHT / font->Width;
+  if (len >= (int)sizeof(text)) {
+    len = sizeof(text) - 1;
+  }
+  for (int i = 0; i < len; ++i) {
+    text[i] = (char)('a' + i % 26);
+  }
+  text[len] = '\0';
+  for (long i = 0; i < n; ++i) {
+    Paint_DrawString_EN(0, 0, text, font, BLACK, WHITE);
+  }
+}
+
+static void bench_read_bmp(long n, void *arg) {
+  const char *path = arg;
+  for (long i = 0; i < n; ++i) {
+    if (GUI_ReadBmp(path, 0, 0) != GUI_BMP_OK) {
+      fprintf(stderr, "bench: GUI_ReadBmp(%s) failed\n", path);
+      exit(1);
+    }
+  }
+}
+
+// Every op after the first is a cache hit: a stat and a paste.
+static void bench_draw_bmp_cached(long n, void *arg) {
+  const char *path = arg;
+  for (long i = 0; i < n; ++i) {
+    if (GUI_DrawBmp_Cached(path, 0, 0) != GUI_BMP_OK) {
+      fprintf(stderr, "bench: GUI_DrawBmp_Cached(%s) failed\n", path);
+      exit(1);
+    }
+  }
+}
+
+typedef struct {
+  const char *path;
+  DITHER_MODE mode;
+} dither_arg;
+
+static void bench_read_bmp_dither(long n, void *arg) {
+  const dither_arg *d = arg;
+  for (long i = 0; i < n; ++i) {
+    if (GUI_ReadBmp_Dither(d->path, 0, 0, d->mode) != GUI_BMP_OK) {
+      fprintf(stderr, "bench: GUI_ReadBmp_Dither(%s) failed\n", d->path);
+      exit(1);
+    }
+  }
+}
+
+static void bench_display(long n, void *arg) {
+  void (*display)(UBYTE *) = (void (*)(UBYTE *))arg;
+  for (long i = 0; i < n; ++i) {
+    display(frame);
+  }
+}
+
+// The register sequence sent on every wake: a stream of short commands,
+// where the framing dominates.
+static void bench_init_wake(long n, void *arg) {
+  (void)arg;
+  for (long i = 0; i < n; ++i) {
+    EPD_2in13_V4_Init_Wake();
+  }
+}
+
+// Alternates two texts so the duplicate-frame check never kicks in.
+static void bench_screen_paint(long n, void *arg) {
+  bool changed = arg != NULL;
+  const char *a[] = {"The quick brown fox", "jumps over", "the lazy dog"};
+  const char *b[] = {"Pack my box with", "five dozen", "liquor jugs"};
+  for (long i = 0; i < n; ++i) {
+    const char **lines = changed && (i & 1) ? b : a;
+    if (!screen_paint(lines, 3, 16)) {
+      fprintf(stderr, "bench: screen_paint failed\n");
+      exit(1);
+    }
+  }
+}
+
+int main(void) {
+  struct {
+    const char *name;
+    sFONT *font;
+  } fonts[] = {{"Font8", &Font8},
+               {"Font12", &Font12},
+               {"Font16", &Font16},
+               {"Font20", &Font20},
+               {"Font24", &Font24}};
+  char name[64];
+
+  // The fast start skips the DEV banner, which would land in the results
+  if (!screen_start()) {
+    fprintf(stderr, "bench: screen_start failed\n");
+    return 1;
+  }
+
+  char bmp_path[] = "/tmp/jarvis-bench-XXXXXX";
+  int fd = mkstemp(bmp_path);
+  if (fd < 0 || close(fd) != 0 || !write_test_bmp(bmp_path, EPD_2in13_V4_HEIGHT, EPD_2in13_V4_WIDTH)) {
+    fprintf(stderr, "bench: cannot write %s\n", bmp_path);
+    return 1;
+  }
+
+  // Full screen gradients for the dithering modes
+  char gray_path[] = "/tmp/jarvis-bench-XXXXXX";
+  char bgr_path[] = "/tmp/jarvis-bench-XXXXXX";
+  fd = mkstemp(gray_path);
+  if (fd < 0 || close(fd) != 0 ||
+      !write_gradient_bmp(gray_path, EPD_2in13_V4_HEIGHT, EPD_2in13_V4_WIDTH, 8)) {
+    fprintf(stderr, "bench: cannot write %s\n", gray_path);
+    return 1;
+  }
+  fd = mkstemp(bgr_path);
+  if (fd < 0 || close(fd) != 0 ||
+      !write_gradient_bmp(bgr_path, EPD_2in13_V4_HEIGHT, EPD_2in13_V4_WIDTH, 24)) {
+    fprintf(stderr, "bench: cannot write %s\n", bgr_path);
+    return 1;
+  }
+  struct {
+    const char *name;
+    DITHER_MODE mode;
+  } dithers[] = {{"Threshold", DITHER_THRESHOLD},
+                 {"Bayer", DITHER_BAYER},
+                 {"FloydSteinberg", DITHER_FLOYD_STEINBERG},
+                 {"Atkinson", DITHER_ATKINSON}};
+
+  printf("goos: linux\npkg: jarvis/lib\n");
+
+  run("ScreenPaint/Changed", bench_screen_paint, (void *)1);
+  run("ScreenPaint/Unchanged", bench_screen_paint, NULL);
+  screen_set_paint_layout(SCREEN_LAYOUT_PAGES);
+  run("ScreenPaint/Changed/Pages", bench_screen_paint, (void *)1);
+  screen_set_paint_layout(SCREEN_LAYOUT_ROWS);
+
+  select_frame();
+  run("PaintClear", bench_clear, NULL);
+  run("PaintSetPixelFrame", bench_set_pixel_frame, NULL);
+  for (size_t i = 0; i < sizeof(fonts) / sizeof(fonts[0]); ++i) {
+    snprintf(name, sizeof(name), "PaintDrawChar/%s", fonts[i].name);
+    run(name, bench_draw_char, fonts[i].font);
+  }
+  for (size_t i = 0; i < sizeof(fonts) / sizeof(fonts[0]); ++i) {
+    snprintf(name, sizeof(name), "PaintDrawStringEN/%s", fonts[i].name);
+    run(name, bench_draw_string, fonts[i].font);
+  }
+  // Same strings into the controller's page order, see Paint_SetLayout
+  Paint_SetLayout(PAINT_LAYOUT_PAGES);
+  for (size_t i = 0; i < sizeof(fonts) / sizeof(fonts[0]); ++i) {
+    snprintf(name, sizeof(name), "PaintDrawStringEN/Pages/%s", fonts[i].name);
+    run(name, bench_draw_string, fonts[i].font);
+  }
+  Paint_SetLayout(PAINT_LAYOUT_ROWS);
+  run("GUIReadBmp/1bit", bench_read_bmp, bmp_path);
+  run("GUIReadBmp/1bit/Cached", bench_draw_bmp_cached, bmp_path);
+  // Unrotated, a cache hit pastes whole bytes instead of setting pixels
+  Paint_NewImage(frame, EPD_2in13_V4_HEIGHT, EPD_2in13_V4_WIDTH, ROTATE_0,
+                 WHITE);
+  run("GUIReadBmp/1bit/Rotate0", bench_read_bmp, bmp_path);
+  run("GUIReadBmp/1bit/Rotate0/Cached", bench_draw_bmp_cached, bmp_path);
+  GUI_Cache_Clear();
+  select_frame();
+  for (size_t i = 0; i < sizeof(dithers) / sizeof(dithers[0]); ++i) {
+    dither_arg gray = {gray_path, dithers[i].mode};
+    dither_arg bgr = {bgr_path, dithers[i].mode};
+    snprintf(name, sizeof(name), "GUIReadBmpDither/%s/8bit", dithers[i].name);
+    run(name, bench_read_bmp_dither, &gray);
+    snprintf(name, sizeof(name), "GUIReadBmpDither/%s/24bit", dithers[i].name);
+    run(name, bench_read_bmp_dither, &bgr);
+  }
+
+  run("EPDInitWake", bench_init_wake, NULL);
+  run("EPDDisplay", bench_display, (void *)EPD_2in13_V4_Display);
+  run("EPDDisplayPartial", bench_display, (void *)EPD_2in13_V4_Display_Partial);
+  run("EPDDisplayBase", bench_display, (void *)EPD_2in13_V4_Display_Base);
+
+  unlink(bmp_path);
+  unlink(gray_path);
+  unlink(bgr_path);
+  return 0;
+}
@@ -0,0 +1,842 @@
+// Golden-image regression harness for the Paint rasteriser, built against the
+// simulated panel (make golden). Every scene is drawn in all four rotations
+// and mirrors, tiled into one image and compared against the PBM/PGM files in
+// lib/bench/golden. Scenes that draw through render_ops are also drawn with
+// the per-pixel reference implementations below; both must match the golden
+// image, and the harness reports how much faster the library paths are.
+// 2 color scenes are drawn once more into a page layout canvas, which must
+// match the same golden image. The bitmap cache is checked on its own after
+// the scenes.
+//
+//   golden [-u] [-g golden_dir] [-o out_dir]
+//
+// -u rewrites the golden images instead of comparing against them. On a
+// mismatch the actual image and a diff (black = differing pixel) are written
+// to out_dir and a crop of the diff is printed.
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Config/DEV_Config.h"
+#include "Fonts/fonts.h"
+#include "GUI/GUI_BMPfile.h"
+#include "GUI/GUI_Cache.h"
+#include "GUI/GUI_Paint.h"
+#include "testbmp.h"
+
+#define CANVAS_W 64
+#define CANVAS_H 48
+#define CANVAS_BYTES (CANVAS_W * CANVAS_H / 2) // enough for 4 bits per pixel
+
+#define TILES 4 // rotations across, mirrors down
+#define SHEET_W (TILES * CANVAS_W + TILES + 1)
+#define SHEET_H (TILES * CANVAS_H + TILES + 1)
+
+#define SPEED_TARGET_NS 50000000ULL // per scene and implementation
+#define DIFF_CROP_W 96
+#define DIFF_CROP_H 48
+#define DIFF_MARGIN 3
+
+typedef struct {
+  void (*clear)(UWORD color);
+  void (*draw_char)(UWORD x, UWORD y, char c, sFONT *font, UWORD fg, UWORD bg);
+  void (*draw_string)(UWORD x, UWORD y, const char *s, sFONT *font, UWORD fg,
+                      UWORD bg);
+  void (*paste)(const unsigned char *bits, UWORD x, UWORD y, UWORD width,
+                UWORD height, UBYTE flip);
+  UBYTE (*draw_bmp)(const char *path, UWORD x, UWORD y);
+  UBYTE (*draw_dither)(const char *path, UWORD x, UWORD y, DITHER_MODE mode);
+} render_ops;
+
+typedef struct {
+  UWORD fg;
+  UWORD bg;
+} palette;
+
+typedef struct {
+  const char *name;
+  UBYTE scale;
+  palette colors;
+  bool uses_ops; // draws through render_ops, so the reference path differs
+  void (*draw)(const render_ops *ops, const palette *c);
+} scene;
+
+static const UWORD rotations[TILES] = {ROTATE_0, ROTATE_90, ROTATE_180,
+                                       ROTATE_270};
+static const UBYTE mirrors[TILES] = {MIRROR_NONE, MIRROR_HORIZONTAL,
+                                     MIRROR_VERTICAL, MIRROR_ORIGIN};
+
+static UBYTE canvas[CANVAS_BYTES];
+static char bmp_path[] = "/tmp/jarvis-golden-XXXXXX";
+static char gray_path[] = "/tmp/jarvis-golden-XXXXXX";
+static char bgr_path[] = "/tmp/jarvis-golden-XXXXXX";
+
+// 19x11 arrow with a ragged last byte, so pastes cover the partial-byte paths.
+static const unsigned char arrow_bits[] = {
+    0x00, 0x40, 0x00, 0x00, 0x60, 0x00, 0x00, 0x70, 0x00, 0xFF, 0xF8, 0x00,
+    0xFF, 0xFC, 0x00, 0xFF, 0xFE, 0x00, 0xFF, 0xFC, 0x00, 0xFF, 0xF8, 0x00,
+    0x00, 0x70, 0x00, 0x00, 0x60, 0x00, 0x00, 0x40, 0x00,
+};
+#define ARROW_W 19
+#define ARROW_H 11
+
+/** Reference implementations **/
+
+// Straight from the rotation and mirror definitions, one pixel at a time,
+// without any of the library's shortcuts.
+static bool ref_locate(UWORD x, UWORD y, UWORD *mx, UWORD *my) {
+  if (x >= Paint.Width || y >= Paint.Height) {
+    return false;
+  }
+  const UWORD w = Paint.WidthMemory, h = Paint.HeightMemory;
+  UWORD X = x, Y = y;
+  switch (Paint.Rotate) {
+  case ROTATE_90:
+    X = w - 1 - y;
+    Y = x;
+    break;
+  case ROTATE_180:
+    X = w - 1 - x;
+    Y = h - 1 - y;
+    break;
+  case ROTATE_270:
+    X = y;
+    Y = h - 1 - x;
+    break;
+  }
+  if (Paint.Mirror & MIRROR_HORIZONTAL) {
+    X = w - 1 - X;
+  }
+  if (Paint.Mirror & MIRROR_VERTICAL) {
+    Y = h - 1 - Y;
+  }
+  *mx = X;
+  *my = Y;
+  return true;
+}
+
+static unsigned bits_per_pixel(UBYTE scale) {
+  return scale == 2 ? 1 : scale == 4 ? 2 : 4;
+}
+
+static void ref_store(UWORD X, UWORD Y, UWORD color) {
+  const unsigned bpp = bits_per_pixel(Paint.Scale);
+  const unsigned per_byte = 8 / bpp;
+  const UBYTE mask = (1u << bpp) - 1;
+  UBYTE value = Paint.Scale == 2 ? (color != BLACK) : (color & mask);
+  unsigned shift = 8 - bpp * (X % per_byte + 1);
+  UBYTE *p = &Paint.Image[X / per_byte + Y * Paint.WidthByte];
+  *p = (*p & ~(mask << shift)) | (value << shift);
+}
+
+static void ref_set_pixel(UWORD x, UWORD y, UWORD color) {
+  UWORD X, Y;
+  if (ref_locate(x, y, &X, &Y)) {
+    ref_store(X, Y, color);
+  }
+}
+
+static void ref_clear(UWORD color) {
+  for (UWORD Y = 0; Y < Paint.HeightMemory; ++Y) {
+    for (UWORD X = 0; X < Paint.WidthMemory; ++X) {
+      ref_store(X, Y, color);
+    }
+  }
+}
+
+static bool font_bit(const sFONT *font, char c, UWORD col, UWORD row) {
+  const UWORD stride = (font->Width + 7) / 8;
+  const uint8_t *glyph = &font->table[(c - ' ') * font->Height * stride];
+  return glyph[row * stride + col / 8] & (0x80 >> (col % 8));
+}
+
+static void ref_draw_char(UWORD x, UWORD y, char c, sFONT *font, UWORD fg,
+                          UWORD bg) {
+  if (x > Paint.Width || y > Paint.Height) {
+    return;
+  }
+  for (UWORD row = 0; row < font->Height; ++row) {
+    for (UWORD col = 0; col < font->Width; ++col) {
+      if (font_bit(font, c, col, row)) {
+        ref_set_pixel(x + col, y + row, fg);
+      } else if (bg != FONT_BACKGROUND) {
+        ref_set_pixel(x + col, y + row, bg);
+      }
+    }
+  }
+}
+
+// Same wrapping rules as Paint_DrawString_EN, including its swapped colours.
+static void ref_draw_string(UWORD x, UWORD y, const char *s, sFONT *font,
+                            UWORD fg, UWORD bg) {
+  if (x > Paint.Width || y > Paint.Height) {
+    return;
+  }
+  UWORD cx = x, cy = y;
+  for (; *s; ++s, cx += font->Width) {
+    if (cx + font->Width > Paint.Width) {
+      cx = x;
+      cy += font->Height;
+    }
+    if (cy + font->Height > Paint.Height) {
+      cx = x;
+      cy = y;
+    }
+    ref_draw_char(cx, cy, *s, font, bg, fg);
+  }
+}
+
+static void ref_paste(const unsigned char *bits, UWORD x, UWORD y, UWORD width,
+                      UWORD height, UBYTE flip) {
+  const UWORD stride = (width + 7) / 8;
+  for (UWORD row = 0; row < height; ++row) {
+    for (UWORD col = 0; col < width; ++col) {
+      bool set = bits[row * stride + col / 8] & (0x80 >> (col % 8));
+      if (x + col < Paint.Width && y + row < Paint.Height) {
+        ref_set_pixel(x + col, y + row, set != (flip != 0) ? WHITE : BLACK);
+      }
+    }
+  }
+}
+
+static uint32_t le32(const UBYTE *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Textbook dithering of the whole picture held in memory: every pixel's gray
+// is worked out from the file on its own, errors go into a full-size array
+// and whatever falls outside the picture is dropped. The error terms are
+// integers in 1/16 (Floyd-Steinberg) and 1/8 (Atkinson) units, rounded the
+// same way as the library, so the results match bit for bit.
+static UBYTE ref_read_dither(const char *path, UWORD x, UWORD y,
+                             DITHER_MODE mode) {
+  static UBYTE file[1 << 16];
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return GUI_BMP_ERR_OPEN;
+  }
+  const size_t len = fread(file, 1, sizeof(file), fp);
+  fclose(fp);
+  if (len < 54) {
+    return GUI_BMP_ERR_HEADER;
+  }
+  const uint32_t offset = le32(file + 10), width = le32(file + 18);
+  const int32_t height = (int32_t)le32(file + 22);
+  const unsigned bits = file[28];
+  const uint32_t stride = (width * bits + 31) / 32 * 4;
+  const uint32_t h = height < 0 ? -height : height;
+  if (width > CANVAS_W || h > CANVAS_H ||
+      offset + (size_t)stride * h > len) {
+    return GUI_BMP_ERR_HEADER;
+  }
+
+  static int err[CANVAS_H + 2][CANVAS_W + 2];
+  memset(err, 0, sizeof(err));
+  for (uint32_t row = 0; row < h; ++row) {
+    const UBYTE *line =
+        file + offset + (height < 0 ? row : h - 1 - row) * stride;
+    for (uint32_t col = 0; col < width; ++col) {
+      const UBYTE *bgr = bits == 8 ? file + 54 + 4 * line[col] : line + 3 * col;
+      const int gray = (bgr[0] * 29 + bgr[1] * 150 + bgr[2] * 77) >> 8;
+      int v = gray;
+      bool white;
+      switch (mode) {
+      case DITHER_BAYER: {
+        static const int bayer[8][8] = {
+            {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+            {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+            {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+            {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21},
+        };
+        // Threshold in the middle of the index's 1/64 of the gray range
+        white = gray * 64 >= (bayer[row % 8][col % 8] * 2 + 1) * 128;
+        break;
+      }
+      case DITHER_FLOYD_STEINBERG:
+      case DITHER_ATKINSON: {
+        const bool fs = mode == DITHER_FLOYD_STEINBERG;
+        const int shift = fs ? 4 : 3;
+        v += (err[row][col] + (1 << (shift - 1))) >> shift;
+        v = v < 0 ? 0 : v > 255 ? 255 : v;
+        white = v >= 128;
+        const int e = white ? v - 255 : v;
+        const struct {
+          int dx, dy, parts;
+        } fs_kernel[] = {{1, 0, 7}, {-1, 1, 3}, {0, 1, 5}, {1, 1, 1}},
+          atkinson_kernel[] = {{1, 0, 1},  {2, 0, 1}, {-1, 1, 1},
+                               {0, 1, 1},  {1, 1, 1}, {0, 2, 1}};
+        const size_t n = fs ? 4 : 6;
+        for (size_t k = 0; k < n; ++k) {
+          const int dx = fs ? fs_kernel[k].dx : atkinson_kernel[k].dx;
+          const int dy = fs ? fs_kernel[k].dy : atkinson_kernel[k].dy;
+          const int parts = fs ? fs_kernel[k].parts : atkinson_kernel[k].parts;
+          if ((int)col + dx >= 0 && col + dx < width && row + dy < h) {
+            err[row + dy][col + dx] += e * parts;
+          }
+        }
+        break;
+      }
+      default:
+        white = gray >= 128;
+        break;
+      }
+      if (x + col < Paint.Width && y + row < Paint.Height) {
+        ref_set_pixel(x + col, y + row, white ? WHITE : BLACK);
+      }
+    }
+  }
+  return GUI_BMP_OK;
+}
+
+static void lib_draw_char(UWORD x, UWORD y, char c, sFONT *font, UWORD fg,
+                          UWORD bg) {
+  Paint_DrawChar(x, y, c, font, fg, bg);
+}
+
+// BMP files are drawn through the cache, and the reference streams them from
+// disk with GUI_ReadBmp every time.
+static const render_ops fast_ops = {
+    Paint_Clear,          lib_draw_char,     Paint_DrawString_EN,
+    Paint_DrawBitMap_Paste, GUI_DrawBmp_Cached, GUI_ReadBmp_Dither,
+};
+
+static const render_ops ref_ops = {
+    ref_clear,   ref_draw_char, ref_draw_string,
+    ref_paste,   GUI_ReadBmp,   ref_read_dither,
+};
+
+/** Scenes **/
+
+static void draw_text_small(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  ops->draw_string(1, 1, "Ag0", &Font8, c->bg, c->fg);
+  ops->draw_string(1, 10, "Ag0", &Font12, c->bg, c->fg);
+  ops->draw_string(1, 23, "Ag0", &Font16, c->bg, c->fg);
+}
+
+static void draw_text_large(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  ops->draw_string(0, 0, "Ag", &Font20, c->bg, c->fg);
+  ops->draw_string(2, 21, "W1", &Font24, c->bg, c->fg);
+}
+
+static void draw_text_wrap(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  ops->draw_string(2, 2, "wrap this text", &Font8, c->bg, c->fg);
+  // Opaque glyphs paint their background too.
+  ops->draw_char(30, 28, 'Q', &Font12, c->bg, c->fg);
+}
+
+static void draw_lines(const render_ops *ops, const palette *c) {
+  const UWORD w = Paint.Width - 1, h = Paint.Height - 1;
+  ops->clear(c->bg);
+  Paint_DrawLine(0, 0, w, h, c->fg, DOT_PIXEL_1X1, LINE_STYLE_SOLID);
+  Paint_DrawLine(0, h, w, 0, c->fg, DOT_PIXEL_1X1, LINE_STYLE_DOTTED);
+  Paint_DrawLine(4, 6, w - 4, 6, c->fg, DOT_PIXEL_2X2, LINE_STYLE_SOLID);
+  Paint_DrawLine(8, 10, 8, h - 4, c->fg, DOT_PIXEL_3X3, LINE_STYLE_SOLID);
+  Paint_DrawPoint(w - 6, h - 6, c->fg, DOT_PIXEL_4X4, DOT_FILL_AROUND);
+  Paint_DrawPoint(w - 14, h - 6, c->fg, DOT_PIXEL_3X3, DOT_FILL_RIGHTUP);
+}
+
+static void draw_rectangles(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  Paint_DrawRectangle(2, 2, 20, 15, c->fg, DOT_PIXEL_1X1, DRAW_FILL_EMPTY);
+  Paint_DrawRectangle(24, 4, 40, 20, c->fg, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+  Paint_DrawRectangle(5, 25, 30, 40, c->fg, DOT_PIXEL_2X2, DRAW_FILL_EMPTY);
+}
+
+static void draw_circles(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  Paint_DrawCircle(16, 16, 12, c->fg, DOT_PIXEL_1X1, DRAW_FILL_EMPTY);
+  Paint_DrawCircle(34, 34, 7, c->fg, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+  Paint_DrawCircle(14, 36, 6, c->fg, DOT_PIXEL_2X2, DRAW_FILL_EMPTY);
+}
+
+static void draw_bitmap(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  ops->paste(arrow_bits, 3, 5, ARROW_W, ARROW_H, 0);
+  ops->paste(arrow_bits, 20, 25, ARROW_W, ARROW_H, 1);
+  // Clipped against the right and bottom edges.
+  ops->paste(arrow_bits, Paint.Width - 9, Paint.Height - 5, ARROW_W, ARROW_H,
+             0);
+}
+
+static void draw_numbers_time(const render_ops *ops, const palette *c) {
+  PAINT_TIME t = {2026, 10, 19, 12, 34, 56};
+  ops->clear(c->bg);
+  Paint_DrawNum(2, 2, 1234, &Font12, c->bg, c->fg);
+  Paint_DrawNumDecimals(2, 16, 3.25, &Font12, 2, c->bg, c->fg);
+  Paint_DrawTime(1, 32, &t, &Font8, c->bg, c->fg);
+}
+
+static void draw_bmp(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  GUI_ReadBmp(bmp_path, 3, 2);
+}
+
+// The second draw, clipped against the edges in every rotation, is a cache hit.
+static void draw_bmp_cached(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  ops->draw_bmp(bmp_path, 3, 2);
+  ops->draw_bmp(bmp_path, 30, 28);
+}
+
+// Both pictures are 37 pixels wide, so rows end mid word and mid byte, and
+// the 24 bit one is clipped against the right edge when rotated.
+static void draw_dither(const render_ops *ops, const palette *c,
+                        DITHER_MODE mode) {
+  ops->clear(c->bg);
+  ops->draw_dither(gray_path, 1, 1, mode);
+  ops->draw_dither(bgr_path, 20, 24, mode);
+}
+
+static void draw_dither_threshold(const render_ops *ops, const palette *c) {
+  draw_dither(ops, c, DITHER_THRESHOLD);
+}
+
+static void draw_dither_bayer(const render_ops *ops, const palette *c) {
+  draw_dither(ops, c, DITHER_BAYER);
+}
+
+static void draw_dither_floyd(const render_ops *ops, const palette *c) {
+  draw_dither(ops, c, DITHER_FLOYD_STEINBERG);
+}
+
+static void draw_dither_atkinson(const render_ops *ops, const palette *c) {
+  draw_dither(ops, c, DITHER_ATKINSON);
+}
+
+static void draw_gray(const render_ops *ops, const palette *c) {
+  ops->clear(c->bg);
+  ops->draw_string(2, 2, "Gy", &Font16, c->bg, c->fg);
+  ops->draw_char(30, 4, 'k', &Font12, c->fg, c->bg);
+  Paint_DrawRectangle(4, 24, 24, 40, c->fg, DOT_PIXEL_1X1, DRAW_FILL_EMPTY);
+  Paint_DrawCircle(34, 32, 8, c->fg, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+  Paint_DrawLine(0, 20, Paint.Width - 1, 20, c->fg, DOT_PIXEL_1X1,
+                 LINE_STYLE_DOTTED);
+}
+
+static const scene scenes[] = {
+    {"text_small", 2, {BLACK, WHITE}, true, draw_text_small},
+    {"text_large", 2, {BLACK, WHITE}, true, draw_text_large},
+    {"text_wrap", 2, {BLACK, WHITE}, true, draw_text_wrap},
+    {"lines", 2, {BLACK, WHITE}, false, draw_lines},
+    {"rectangles", 2, {BLACK, WHITE}, false, draw_rectangles},
+    {"circles", 2, {BLACK, WHITE}, false, draw_circles},
+    {"bitmap", 2, {BLACK, WHITE}, true, draw_bitmap},
+    {"numbers_time", 2, {BLACK, WHITE}, false, draw_numbers_time},
+    {"bmp", 2, {BLACK, WHITE}, false, draw_bmp},
+    {"bmp_cached", 2, {BLACK, WHITE}, true, draw_bmp_cached},
+    {"dither_threshold", 2, {BLACK, WHITE}, true, draw_dither_threshold},
+    {"dither_bayer", 2, {BLACK, WHITE}, true, draw_dither_bayer},
+    {"dither_floyd", 2, {BLACK, WHITE}, true, draw_dither_floyd},
+    {"dither_atkinson", 2, {BLACK, WHITE}, true, draw_dither_atkinson},
+    {"gray4", 4, {GRAY1, GRAY4}, true, draw_gray},
+    {"color7", 7, {0x2, 0x1}, true, draw_gray},
+};
+
+/** Sheets **/
+
+static UBYTE canvas_pixel(UBYTE scale, UBYTE layout, UWORD X, UWORD Y) {
+  if (layout == PAINT_LAYOUT_PAGES) {
+    return (canvas[(X / 8) * CANVAS_H + Y] >> (7 - X % 8)) & 1;
+  }
+  const unsigned bpp = bits_per_pixel(scale);
+  const unsigned per_byte = 8 / bpp;
+  const unsigned shift = 8 - bpp * (X % per_byte + 1);
+  const UWORD width_byte = (CANVAS_W + per_byte - 1) / per_byte;
+  return (canvas[X / per_byte + Y * width_byte] >> shift) & ((1u << bpp) - 1);
+}
+
+static void render_tile(const scene *s, const render_ops *ops, UBYTE layout,
+                        int r, int m) {
+  Paint_NewImage(canvas, CANVAS_W, CANVAS_H, rotations[r], WHITE);
+  Paint_SetScale(s->scale);
+  Paint_SetLayout(layout);
+  Paint_SetMirroring(mirrors[m]);
+  s->draw(ops, &s->colors);
+}
+
+// One byte per pixel holding the raw canvas value, so 1 is white at scale 2.
+static void render_sheet(const scene *s, const render_ops *ops, UBYTE layout,
+                         UBYTE *sheet) {
+  const UBYTE border = s->scale == 2 ? 0 : (1u << bits_per_pixel(s->scale)) - 1;
+  memset(sheet, border, SHEET_W * SHEET_H);
+  for (int m = 0; m < TILES; ++m) {
+    for (int r = 0; r < TILES; ++r) {
+      render_tile(s, ops, layout, r, m);
+      UBYTE *tile = sheet + (1 + m * (CANVAS_H + 1)) * SHEET_W +
+                    1 + r * (CANVAS_W + 1);
+      for (UWORD Y = 0; Y < CANVAS_H; ++Y) {
+        for (UWORD X = 0; X < CANVAS_W; ++X) {
+          tile[Y * SHEET_W + X] = canvas_pixel(s->scale, layout, X, Y);
+        }
+      }
+    }
+  }
+}
+
+static void sheet_path(char *buf, size_t len, const char *dir, const scene *s,
+                       const char *suffix) {
+  snprintf(buf, len, "%s/%s%s.%s", dir, s->name, suffix,
+           s->scale == 2 ? "pbm" : "pgm");
+}
+
+// Scale 2 sheets are PBM (1 is black there), deeper ones PGM holding the raw
+// palette index.
+static bool write_sheet(const char *path, UBYTE scale, const UBYTE *sheet) {
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    return false;
+  }
+  if (scale == 2) {
+    fprintf(fp, "P4\n%d %d\n", SHEET_W, SHEET_H);
+    for (int y = 0; y < SHEET_H; ++y) {
+      for (int x = 0; x < SHEET_W; x += 8) {
+        UBYTE b = 0;
+        for (int i = 0; i < 8 && x + i < SHEET_W; ++i) {
+          if (!sheet[y * SHEET_W + x + i]) {
+            b |= 0x80 >> i;
+          }
+        }
+        fputc(b, fp);
+      }
+    }
+  } else {
+    fprintf(fp, "P5\n%d %d\n%u\n", SHEET_W, SHEET_H,
+            (1u << bits_per_pixel(scale)) - 1);
+    fwrite(sheet, 1, SHEET_W * SHEET_H, fp);
+  }
+  return fclose(fp) == 0;
+}
+
+static bool read_sheet(const char *path, UBYTE scale, UBYTE *sheet) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return false;
+  }
+  char magic[3] = {0};
+  int w, h;
+  unsigned maxval = 1;
+  bool ok = fscanf(fp, "%2s %d %d", magic, &w, &h) == 3 && w == SHEET_W &&
+            h == SHEET_H;
+  if (ok && scale != 2) {
+    ok = fscanf(fp, "%u", &maxval) == 1;
+  }
+  ok = ok && fgetc(fp) != EOF &&
+       strcmp(magic, scale == 2 ? "P4" : "P5") == 0;
+  if (ok && scale == 2) {
+    for (int y = 0; ok && y < SHEET_H; ++y) {
+      for (int x = 0; ok && x < SHEET_W; x += 8) {
+        int b = fgetc(fp);
+        ok = b != EOF;
+        for (int i = 0; ok && i < 8 && x + i < SHEET_W; ++i) {
+          sheet[y * SHEET_W + x + i] = !(b & (0x80 >> i));
+        }
+      }
+    }
+  } else if (ok) {
+    ok = fread(sheet, 1, SHEET_W * SHEET_H, fp) == SHEET_W * SHEET_H;
+  }
+  fclose(fp);
+  return ok;
+}
+
+/** Comparison **/
+
+typedef struct {
+  long count;
+  int x0, y0, x1, y1; // bounding box of the differing pixels
+} sheet_diff;
+
+static sheet_diff compare_sheets(const UBYTE *want, const UBYTE *got,
+                                 UBYTE *diff) {
+  sheet_diff d = {0, SHEET_W, SHEET_H, -1, -1};
+  for (int y = 0; y < SHEET_H; ++y) {
+    for (int x = 0; x < SHEET_W; ++x) {
+      const int i = y * SHEET_W + x;
+      diff[i] = want[i] == got[i]; // white where equal
+      if (!diff[i]) {
+        ++d.count;
+        d.x0 = x < d.x0 ? x : d.x0;
+        d.y0 = y < d.y0 ? y : d.y0;
+        d.x1 = x > d.x1 ? x : d.x1;
+        d.y1 = y > d.y1 ? y : d.y1;
+      }
+    }
+  }
+  return d;
+}
+
+// Prints the top-left corner of the differing region with a little context:
+// X differs, # and . are matching dark and light pixels.
+static void print_diff(const UBYTE *want, const UBYTE *diff,
+                       const sheet_diff *d) {
+  const int tx = d->x0 / (CANVAS_W + 1), ty = d->y0 / (CANVAS_H + 1);
+  fprintf(stderr, "  %ld pixels differ, first in rotation %d mirror %d\n",
+          d->count, rotations[tx < TILES ? tx : TILES - 1],
+          ty < TILES ? ty : TILES - 1);
+  const int x0 = d->x0 > DIFF_MARGIN ? d->x0 - DIFF_MARGIN : 0;
+  const int y0 = d->y0 > DIFF_MARGIN ? d->y0 - DIFF_MARGIN : 0;
+  int x1 = d->x1 + DIFF_MARGIN, y1 = d->y1 + DIFF_MARGIN;
+  x1 = x1 < x0 + DIFF_CROP_W ? x1 : x0 + DIFF_CROP_W - 1;
+  y1 = y1 < y0 + DIFF_CROP_H ? y1 : y0 + DIFF_CROP_H - 1;
+  x1 = x1 < SHEET_W ? x1 : SHEET_W - 1;
+  y1 = y1 < SHEET_H ? y1 : SHEET_H - 1;
+  for (int y = y0; y <= y1; ++y) {
+    fputs("  ", stderr);
+    for (int x = x0; x <= x1; ++x) {
+      const int i = y * SHEET_W + x;
+      fputc(!diff[i] ? 'X' : want[i] ? '.' : '#', stderr);
+    }
+    fputc('\n', stderr);
+  }
+}
+
+static bool report_mismatch(const scene *s, const char *what,
+                            const UBYTE *want, const UBYTE *got,
+                            const char *out_dir) {
+  static UBYTE diff[SHEET_W * SHEET_H];
+  sheet_diff d = compare_sheets(want, got, diff);
+  if (d.count == 0) {
+    return true;
+  }
+  char path[512];
+  fprintf(stderr, "FAIL %s: %s\n", s->name, what);
+  print_diff(want, diff, &d);
+  sheet_path(path, sizeof(path), out_dir, s, ".actual");
+  write_sheet(path, s->scale, got);
+  fprintf(stderr, "  actual: %s\n", path);
+  snprintf(path, sizeof(path), "%s/%s.diff.pbm", out_dir, s->name);
+  write_sheet(path, 2, diff);
+  fprintf(stderr, "  diff:   %s\n", path);
+  return false;
+}
+
+/** Bitmap cache **/
+
+static bool cache_expect(const char *what, bool ok) {
+  if (!ok) {
+    fprintf(stderr, "FAIL cache: %s\n", what);
+  }
+  return ok;
+}
+
+static bool cache_get(const char *path, const GUI_BITMAP **bitmap) {
+  return GUI_Cache_Get(path, bitmap) == GUI_BMP_OK;
+}
+
+// Hits, invalidation when the file changes, least recently used eviction at
+// the byte limit, and the fallback for pictures larger than the limit.
+static bool check_cache(void) {
+  char paths[3][32];
+  for (int i = 0; i < 3; ++i) {
+    snprintf(paths[i], sizeof(paths[i]), "/tmp/jarvis-cache-XXXXXX");
+    int fd = mkstemp(paths[i]);
+    if (fd < 0 || close(fd) != 0 || !write_test_bmp(paths[i], 24, 16)) {
+      fprintf(stderr, "golden: cannot write %s\n", paths[i]);
+      return false;
+    }
+  }
+
+  const GUI_BITMAP *first, *again;
+  GUI_CACHE_STATS st;
+  bool ok = true;
+  GUI_Cache_Clear();
+  GUI_Cache_SetLimit(GUI_CACHE_LIMIT_DFT);
+  GUI_Cache_Stats(&st);
+  const UDOUBLE hits = st.Hits, misses = st.Misses, evictions = st.Evictions;
+
+  ok &= cache_expect("first lookup", cache_get(paths[0], &first));
+  ok &= cache_expect("second lookup", cache_get(paths[0], &again));
+  GUI_Cache_Stats(&st);
+  ok &= cache_expect("second lookup is a hit",
+                     again == first && st.Hits == hits + 1 &&
+                         st.Misses == misses + 1 && st.Entries == 1);
+  const UDOUBLE entry_bytes = st.Bytes;
+
+  // A new size, then the same size with a new modification time
+  ok &= cache_expect("rewrite", write_test_bmp(paths[0], 40, 16));
+  ok &= cache_expect("lookup after resize", cache_get(paths[0], &again));
+  ok &= cache_expect("resized file is decoded again", again->Width == 40);
+  ok &= cache_expect("rewrite", write_test_bmp(paths[0], 24, 16));
+  struct timespec times[2] = {{.tv_sec = 1000000000}, {.tv_sec = 1000000000}};
+  ok &= cache_expect("set mtime", utimensat(AT_FDCWD, paths[0], times, 0) == 0);
+  ok &= cache_expect("lookup after touch", cache_get(paths[0], &again));
+  GUI_Cache_Stats(&st);
+  ok &= cache_expect("changed files miss",
+                     st.Misses == misses + 3 && st.Entries == 1 &&
+                         again->Width == 24);
+
+  // Room for two: a is used again after b, so c evicts b
+  GUI_Cache_SetLimit(2 * entry_bytes);
+  ok &= cache_expect("b", cache_get(paths[1], &again));
+  ok &= cache_expect("a", cache_get(paths[0], &again));
+  ok &= cache_expect("c", cache_get(paths[2], &again));
+  GUI_Cache_Stats(&st);
+  ok &= cache_expect("one eviction at the limit",
+                     st.Evictions == evictions + 1 && st.Entries == 2 &&
+                         st.Bytes <= 2 * entry_bytes);
+  const UDOUBLE before = st.Misses;
+  ok &= cache_expect("a kept", cache_get(paths[0], &again));
+  GUI_Cache_Stats(&st);
+  ok &= cache_expect("recently used entry survives", st.Misses == before);
+  ok &= cache_expect("b evicted", cache_get(paths[1], &again));
+  GUI_Cache_Stats(&st);
+  ok &= cache_expect("least recently used entry is evicted",
+                     st.Misses == before + 1);
+
+  // Over the limit: not cached, but still drawn
+  static UBYTE image[24 * 16 / 8];
+  GUI_Cache_SetLimit(entry_bytes - 1);
+  ok &= cache_expect("shrinking evicts", (GUI_Cache_Stats(&st), st.Entries == 0));
+  ok &= cache_expect("oversized not cached",
+                     GUI_Cache_Get(paths[0], &again) == GUI_BMP_ERR_NOMEM);
+  Paint_NewImage(image, 24, 16, ROTATE_0, WHITE);
+  ok &= cache_expect("oversized drawn",
+                     GUI_DrawBmp_Cached(paths[0], 0, 0) == GUI_BMP_OK);
+
+  GUI_Cache_Clear();
+  GUI_Cache_SetLimit(GUI_CACHE_LIMIT_DFT);
+  for (int i = 0; i < 3; ++i) {
+    unlink(paths[i]);
+  }
+  return ok;
+}
+
+/** Speed **/
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Nanoseconds per sheet, growing the run until it takes SPEED_TARGET_NS.
+static double time_sheet(const scene *s, const render_ops *ops, UBYTE layout,
+                         UBYTE *sheet) {
+  long n = 1;
+  for (;;) {
+    uint64_t start = now_ns();
+    for (long i = 0; i < n; ++i) {
+      render_sheet(s, ops, layout, sheet);
+    }
+    uint64_t elapsed = now_ns() - start;
+    if (elapsed >= SPEED_TARGET_NS) {
+      return (double)elapsed / n;
+    }
+    n *= 2;
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *golden_dir = "lib/bench/golden";
+  const char *out_dir = ".";
+  bool update = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "ug:o:")) != -1) {
+    switch (opt) {
+    case 'u':
+      update = true;
+      break;
+    case 'g':
+      golden_dir = optarg;
+      break;
+    case 'o':
+      out_dir = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-u] [-g golden_dir] [-o out_dir]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  int fd = mkstemp(bmp_path);
+  if (fd < 0 || close(fd) != 0 || !write_test_bmp(bmp_path, 40, 30)) {
+    fprintf(stderr, "golden: cannot write %s\n", bmp_path);
+    return 1;
+  }
+  fd = mkstemp(gray_path);
+  if (fd < 0 || close(fd) != 0 || !write_gradient_bmp(gray_path, 37, 22, 8)) {
+    fprintf(stderr, "golden: cannot write %s\n", gray_path);
+    return 1;
+  }
+  fd = mkstemp(bgr_path);
+  if (fd < 0 || close(fd) != 0 || !write_gradient_bmp(bgr_path, 37, 23, 24)) {
+    fprintf(stderr, "golden: cannot write %s\n", bgr_path);
+    return 1;
+  }
+
+  static UBYTE fast[SHEET_W * SHEET_H], ref[SHEET_W * SHEET_H],
+      pages[SHEET_W * SHEET_H], want[SHEET_W * SHEET_H];
+  const size_t count = sizeof(scenes) / sizeof(scenes[0]);
+  int failed = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const scene *s = &scenes[i];
+    char path[512];
+    sheet_path(path, sizeof(path), golden_dir, s, "");
+    render_sheet(s, &fast_ops, PAINT_LAYOUT_ROWS, fast);
+    render_sheet(s, &ref_ops, PAINT_LAYOUT_ROWS, ref);
+    bool ok = report_mismatch(s, "library differs from reference", ref, fast,
+                              out_dir);
+    if (s->scale == 2) {
+      render_sheet(s, &fast_ops, PAINT_LAYOUT_PAGES, pages);
+      ok = report_mismatch(s, "page layout differs from rows", fast, pages,
+                           out_dir) &&
+           ok;
+    }
+    if (update) {
+      if (ok && !write_sheet(path, s->scale, fast)) {
+        fprintf(stderr, "golden: cannot write %s\n", path);
+        ok = false;
+      }
+    } else if (!read_sheet(path, s->scale, want)) {
+      fprintf(stderr, "FAIL %s: cannot read %s\n", s->name, path);
+      ok = false;
+    } else {
+      ok = report_mismatch(s, "library differs from golden", want, fast,
+                           out_dir) &&
+           ok;
+    }
+    if (!ok) {
+      ++failed;
+      continue;
+    }
+    if (update || !s->uses_ops) {
+      printf("ok   %s\n", s->name);
+      continue;
+    }
+    const double fast_ns = time_sheet(s, &fast_ops, PAINT_LAYOUT_ROWS, fast);
+    const double ref_ns = time_sheet(s, &ref_ops, PAINT_LAYOUT_ROWS, ref);
+    printf("ok   %-16s fast %9.0f ns  reference %9.0f ns  x%.2f", s->name,
+           fast_ns, ref_ns, ref_ns / fast_ns);
+    if (s->scale == 2) {
+      const double pages_ns =
+          time_sheet(s, &fast_ops, PAINT_LAYOUT_PAGES, pages);
+      printf("  pages %9.0f ns  x%.2f", pages_ns, ref_ns / pages_ns);
+    }
+    printf("\n");
+  }
+  unlink(bmp_path);
+  unlink(gray_path);
+  unlink(bgr_path);
+
+  if (check_cache()) {
+    printf("ok   cache\n");
+  } else {
+    ++failed;
+  }
+
+  if (failed) {
+    fprintf(stderr, "golden: %d of %zu checks failed\n", failed, count + 1);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+
+#include "testbmp.h"
+
+static void put_le16(FILE *fp, uint16_t v) {
+  fputc(v & 0xFF, fp);
+  fputc(v >> 8, fp);
+}
+
+static void put_le32(FILE *fp, uint32_t v) {
+  put_le16(fp, v & 0xFFFF);
+  put_le16(fp, v >> 16);
+}
+
+bool write_test_bmp(const char *path, uint32_t width, uint32_t height) {
+  const uint32_t stride = (width + 31) / 32 * 4;
+  const uint32_t data_offset = 14 + 40 + 8;
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    return false;
+  }
+  fputs("BM", fp);
+  put_le32(fp, data_offset + stride * height);
+  put_le32(fp, 0);
+  put_le32(fp, data_offset);
+  put_le32(fp, 40);
+  put_le32(fp, width);
+  put_le32(fp, height);
+  put_le16(fp, 1);
+  put_le16(fp, 1);
+  put_le32(fp, 0);
+  put_le32(fp, stride * height);
+  put_le32(fp, 2835);
+  put_le32(fp, 2835);
+  put_le32(fp, 2);
+  put_le32(fp, 0);
+  put_le32(fp, 0x00000000); // black
+  put_le32(fp, 0x00FFFFFF); // white
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < stride; ++x) {
+      fputc((x + y) & 4 ? 0xF0 : 0x3C, fp);
+    }
+  }
+  return fclose(fp) == 0;
+}
+
+bool write_gradient_bmp(const char *path, uint32_t width, uint32_t height,
+                        uint16_t bits) {
+  const uint32_t colors = bits == 8 ? 256 : 0;
+  const uint32_t stride = (width * bits + 31) / 32 * 4;
+  const uint32_t data_offset = 14 + 40 + 4 * colors;
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    return false;
+  }
+  fputs("BM", fp);
+  put_le32(fp, data_offset + stride * height);
+  put_le32(fp, 0);
+  put_le32(fp, data_offset);
+  put_le32(fp, 40);
+  put_le32(fp, width);
+  put_le32(fp, height);
+  put_le16(fp, 1);
+  put_le16(fp, bits);
+  put_le32(fp, 0);
+  put_le32(fp, stride * height);
+  put_le32(fp, 2835);
+  put_le32(fp, 2835);
+  put_le32(fp, colors);
+  put_le32(fp, 0);
+  // Blue rises and red falls with the index, so the luma weights matter
+  for (uint32_t i = 0; i < colors; ++i) {
+    put_le32(fp, i | (i << 8) | ((255 - i) << 16));
+  }
+  // Stored bottom up: dark at the top left, light at the bottom right
+  for (uint32_t n = 0; n < height; ++n) {
+    const uint32_t y = height - 1 - n;
+    uint32_t written = 0;
+    for (uint32_t x = 0; x < width; ++x) {
+      const uint32_t across = width > 1 ? x * 255 / (width - 1) : 0;
+      const uint32_t down = height > 1 ? y * 255 / (height - 1) : 0;
+      const uint32_t level = (3 * across + down) / 4;
+      if (bits == 8) {
+        fputc(level, fp);
+        written += 1;
+      } else {
+        fputc(level, fp);             // blue
+        fputc(across, fp);            // green
+        fputc(255 - down, fp);        // red
+        written += 3;
+      }
+    }
+    for (; written < stride; ++written) {
+      fputc(0, fp);
+    }
+  }
+  return fclose(fp) == 0;
+}
@@ -0,0 +1,16 @@
+#ifndef TESTBMP_H
+#define TESTBMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Writes a deterministic 1-bit BMP of width x height with a stripe pattern,
+// for benchmarking and checking the BMP loaders.
+bool write_test_bmp(const char *path, uint32_t width, uint32_t height);
+
+// Writes a diagonal gradient BMP of 8 bits (a tinted 256 entry palette) or
+// 24 bits per pixel, for the dithering paths.
+bool write_gradient_bmp(const char *path, uint32_t width, uint32_t height,
+                        uint16_t bits);
+
+#endif // TESTBMP_H
@@ -28,6 +28,8 @@
 #
 ******************************************************************************/
 #include "DEV_Config.h"
+#include <time.h>
+#include <pthread.h>
 
 #if USE_LGPIO_LIB
 int GPIO_Handle;
@@ -45,11 +47,61 @@ int EPD_PWR_PIN;
 int EPD_MOSI_PIN;
 int EPD_SCLK_PIN;
 
+/**
+ * Every GPIO write and SPI byte is counted, so the counters are relaxed
+ * atomics rather than a lock: each total is exact, but a snapshot may
+ * catch one counter a transfer ahead of another.
+**/
+DEV_STATS DEV_Stats;
+
+void DEV_Stats_Add(uint64_t *Counter, uint64_t N)
+{
+	__atomic_fetch_add(Counter, N, __ATOMIC_RELAXED);
+}
+
+DEV_STATS DEV_Stats_Get(void)
+{
+	DEV_STATS Stats;
+	Stats.SpiBytes = __atomic_load_n(&DEV_Stats.SpiBytes, __ATOMIC_RELAXED);
+	Stats.BusyWaits = __atomic_load_n(&DEV_Stats.BusyWaits, __ATOMIC_RELAXED);
+	Stats.BusyUs = __atomic_load_n(&DEV_Stats.BusyUs, __ATOMIC_RELAXED);
+	Stats.DelayUs = __atomic_load_n(&DEV_Stats.DelayUs, __ATOMIC_RELAXED);
+	Stats.GpioWrites = __atomic_load_n(&DEV_Stats.GpioWrites, __ATOMIC_RELAXED);
+	return Stats;
+}
+
+/**
+ * Panels share SPI and usually DC, so a command or data frame, from CS
+ * low to CS high, holds the bus lock. Resets and BUSY waits run outside
+ * it, concurrently across panels.
+ * bcm2835 hands GPIO 8 and 7 to the SPI block as CE0 and CE1, which it
+ * drives on every transfer, so the lock also points the hardware chip
+ * select at the panel's CS; any other CS pin is driven by software alone.
+**/
+static pthread_mutex_t Bus_Lock = PTHREAD_MUTEX_INITIALIZER;
+
+void DEV_Bus_Lock(UWORD Cs)
+{
+	pthread_mutex_lock(&Bus_Lock);
+#if defined(RPI) && USE_BCM2835_LIB
+	bcm2835_spi_chipSelect(Cs == 8 ? BCM2835_SPI_CS0 :
+	                       Cs == 7 ? BCM2835_SPI_CS1 : BCM2835_SPI_CS_NONE);
+#else
+	(void)Cs;
+#endif
+}
+
+void DEV_Bus_Unlock(void)
+{
+	pthread_mutex_unlock(&Bus_Lock);
+}
+
 /**
  * GPIO read and write
 **/
 void DEV_Digital_Write(UWORD Pin, UBYTE Value)
 {
+	DEV_Stats_Add(&DEV_Stats.GpioWrites, 1);
 #ifdef RPI
 #ifdef USE_BCM2835_LIB
 	bcm2835_gpio_write(Pin, Value);
@@ -59,6 +111,8 @@ void DEV_Digital_Write(UWORD Pin, UBYTE Value)
     lgGpioWrite(GPIO_Handle, Pin, Value);
 #elif USE_DEV_LIB
 	GPIOD_Write(Pin, Value);
+#elif USE_GPIOD2_LIB
+	GPIOD2_Write(Pin, Value);
 #endif
 #endif
 
@@ -71,9 +125,13 @@ void DEV_Digital_Write(UWORD Pin, UBYTE Value)
 #endif
 }
 
-UBYTE DEV_Digital_Read(UWORD Pin)
+/**
+ * Level of Pin, negative when the backend cannot read it (gpiod v2 and
+ * lgpio report errors that way)
+**/
+static int DEV_Read_Level(UWORD Pin)
 {
-	UBYTE Read_value = 0;
+	int Read_value = 0;
 #ifdef RPI
 #ifdef USE_BCM2835_LIB
 	Read_value = bcm2835_gpio_lev(Pin);
@@ -83,6 +141,8 @@ UBYTE DEV_Digital_Read(UWORD Pin)
     Read_value = lgGpioRead(GPIO_Handle,Pin);
 #elif USE_DEV_LIB
 	Read_value = GPIOD_Read(Pin);
+#elif USE_GPIOD2_LIB
+	Read_value = GPIOD2_Read(Pin);
 #endif
 #endif
 
@@ -96,11 +156,81 @@ UBYTE DEV_Digital_Read(UWORD Pin)
 	return Read_value;
 }
 
+UBYTE DEV_Digital_Read(UWORD Pin)
+{
+	return DEV_Read_Level(Pin);
+}
+
+/**
+ * Write two pins in one operation, DC and CS when framing a transfer.
+ * bcm2835 updates both through the set/clear registers with one mask,
+ * gpiod v2 with one multi-line set; the other backends write them in
+ * order. The simulated panel counts it as one write like bcm2835.
+**/
+void DEV_Digital_Write2(UWORD Pin1, UBYTE Value1, UWORD Pin2, UBYTE Value2)
+{
+#if defined(RPI) && (USE_BCM2835_LIB || USE_GPIOD2_LIB || USE_SIM_LIB)
+	DEV_Stats_Add(&DEV_Stats.GpioWrites, 1);
+#if USE_BCM2835_LIB
+	bcm2835_gpio_write_mask((Value1 ? 1u << Pin1 : 0) | (Value2 ? 1u << Pin2 : 0),
+	                        (1u << Pin1) | (1u << Pin2));
+#elif USE_GPIOD2_LIB
+	GPIOD2_Write2(Pin1, Value1, Pin2, Value2);
+#endif
+#else
+	DEV_Digital_Write(Pin1, Value1);
+	DEV_Digital_Write(Pin2, Value2);
+#endif
+}
+
+/**
+ * Longest sleep on BUSY edges before reading the level again, so a lost
+ * edge costs at most this much
+**/
+#define DEV_EDGE_TIMEOUT_NS 100000000LL
+
+/**
+ * Wait until Pin reads Level, for at most Timeout_us. The gpiod v2 backend
+ * sleeps on edge events; the others sample every Poll_us against chained
+ * deadlines. Returns 0 once the level is read, 1 when the pin cannot be
+ * read or the timeout passes, so a panel that is gone or never releases
+ * BUSY fails the operation instead of hanging it.
+**/
+UBYTE DEV_Wait_Level(UWORD Pin, UBYTE Level, UDOUBLE Poll_us, UDOUBLE Timeout_us)
+{
+	uint64_t Start = DEV_Time_us();
+#if !(defined(RPI) && USE_GPIOD2_LIB)
+	uint64_t Next = Start;
+#endif
+	int Value;
+	while((Value = DEV_Read_Level(Pin)) != Level) {
+		if(Value < 0 || Value > 1) {
+			printf("DEV: cannot read pin %d\r\n", Pin);
+			return 1;
+		}
+		uint64_t Now = DEV_Time_us();
+		if(Now - Start >= Timeout_us) {
+			printf("DEV: pin %d still not %d after %lu ms\r\n", Pin, Level, (unsigned long)Timeout_us / 1000);
+			return 1;
+		}
+#if defined(RPI) && USE_GPIOD2_LIB
+		int64_t Left_ns = (int64_t)(Start + Timeout_us - Now) * 1000;
+		if(GPIOD2_Wait_Edge(Pin, Left_ns < DEV_EDGE_TIMEOUT_NS ? Left_ns : DEV_EDGE_TIMEOUT_NS) < 0)
+			DEV_Delay_us(Poll_us);
+#else
+		Next += Poll_us;
+		DEV_Sleep_Until_us(Next);
+#endif
+	}
+	return 0;
+}
+
 /**
  * SPI
 **/
 void DEV_SPI_WriteByte(uint8_t Value)
 {
+	DEV_Stats_Add(&DEV_Stats.SpiBytes, 1);
 #ifdef RPI
 #ifdef USE_BCM2835_LIB
 	bcm2835_spi_transfer(Value);
@@ -108,7 +238,7 @@ void DEV_SPI_WriteByte(uint8_t Value)
 	wiringPiSPIDataRW(0,&Value,1);
 #elif  USE_LGPIO_LIB 
     lgSpiWrite(SPI_Handle,(char*)&Value, 1);
-#elif USE_DEV_LIB
+#elif USE_DEV_LIB || USE_GPIOD2_LIB
 	DEV_HARDWARE_SPI_TransferByte(Value);
 #endif
 #endif
@@ -124,15 +254,15 @@ void DEV_SPI_WriteByte(uint8_t Value)
 
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
 {
+	DEV_Stats_Add(&DEV_Stats.SpiBytes, Len);
 #ifdef RPI
 #ifdef USE_BCM2835_LIB
-	char rData[Len];
-	bcm2835_spi_transfernb((char *)pData,rData,Len);
+	bcm2835_spi_writenb((const char *)pData, Len);
 #elif USE_WIRINGPI_LIB
 	wiringPiSPIDataRW(0, pData, Len);
 #elif  USE_LGPIO_LIB 
     lgSpiWrite(SPI_Handle,(char*)pData, Len);
-#elif USE_DEV_LIB
+#elif USE_DEV_LIB || USE_GPIOD2_LIB
 	DEV_HARDWARE_SPI_Transfer(pData, Len);
 #endif
 #endif
@@ -186,6 +316,8 @@ void DEV_GPIO_Mode(UWORD Pin, UWORD Mode)
         GPIOD_Direction(Pin, GPIOD_OUT);
         // Debug("OUT Pin = %d\r\n",Pin);
     }
+#elif USE_GPIOD2_LIB
+	// Directions are set when DEV_Module_Init requests all lines at once
 #endif
 #endif
 
@@ -204,29 +336,51 @@ void DEV_GPIO_Mode(UWORD Pin, UWORD Mode)
 **/
 void DEV_Delay_ms(UDOUBLE xms)
 {
-#ifdef RPI
-#ifdef USE_BCM2835_LIB
-	bcm2835_delay(xms);
-#elif USE_WIRINGPI_LIB
-	delay(xms);
-#elif  USE_LGPIO_LIB  
-    lguSleep(xms/1000.0);
-#elif USE_DEV_LIB
-	UDOUBLE i;
-	for(i=0; i < xms; i++) {
-		usleep(1000);
-	}
-#endif
-#endif
+	DEV_Delay_us(xms * 1000);
+}
 
-#ifdef JETSON
-	UDOUBLE i;
-	for(i=0; i < xms; i++) {
-		usleep(1000);
-	}
+/**
+ * delay x us, against an absolute deadline so an interrupted sleep
+ * resumes instead of starting over
+**/
+void DEV_Delay_us(UDOUBLE xus)
+{
+	DEV_Sleep_Until_us(DEV_Time_us() + xus);
+}
+
+/**
+ * sleep until the monotonic clock reaches deadline_us (see DEV_Time_us).
+ * Chaining deadlines keeps a sequence of delays from drifting by the time
+ * spent between them.
+**/
+void DEV_Sleep_Until_us(uint64_t deadline_us)
+{
+	uint64_t now = DEV_Time_us();
+	if(deadline_us <= now)
+		return;
+	DEV_Stats_Add(&DEV_Stats.DelayUs, deadline_us - now);
+#ifdef USE_SIM_LIB
+	// Simulated panel: nothing to wait for
+#else
+	struct timespec ts;
+	ts.tv_sec = deadline_us / 1000000;
+	ts.tv_nsec = (deadline_us % 1000000) * 1000;
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
 #endif
 }
 
+/**
+ * monotonic time in microseconds, for timing the panel phases
+**/
+uint64_t DEV_Time_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#ifndef USE_SIM_LIB
 static int DEV_Equipment_Testing(void)
 {
 	FILE *fp;
@@ -274,8 +428,7 @@ static int DEV_Equipment_Testing(void)
 #endif
 	return 0;
 }
-
-
+#endif
 
 void DEV_GPIO_Init(void)
 {
@@ -310,6 +463,37 @@ void DEV_GPIO_Init(void)
     
 }
 
+/******************************************************************************
+function:	Set up the lines of an additional panel
+parameter:
+	Rst, Dc, Cs : output lines, Dc may be the shared EPD_DC_PIN
+	Busy        : input line
+Info:
+	The panel shares SPI with the first one and is selected by its own CS:
+	CE1 (GPIO 7), left to the SPI block, or any free GPIO driven by
+	software (see DEV_Bus_Lock). Returns 0 on success. Not supported by
+	the gpiod v2 backend, whose line request and spidev chip select cover
+	the first panel only.
+******************************************************************************/
+UBYTE DEV_Panel_Init(int Rst, int Dc, int Cs, int Busy)
+{
+#if defined(RPI) && USE_GPIOD2_LIB
+	printf("gpiod: additional panels need the bcm2835 backend\r\n");
+	return 1;
+#else
+	DEV_GPIO_Mode(Busy, 0);
+	DEV_GPIO_Mode(Rst, 1);
+	DEV_GPIO_Mode(Dc, 1);
+#if defined(RPI) && USE_BCM2835_LIB
+	if(Cs == 7 || Cs == 8)
+		return 0;
+#endif
+	DEV_GPIO_Mode(Cs, 1);
+	DEV_Digital_Write(Cs, 1);
+	return 0;
+#endif
+}
+
 void DEV_SPI_SendnData(UBYTE *Reg)
 {
     UDOUBLE size;
@@ -368,24 +552,39 @@ UBYTE DEV_SPI_ReadData()
 	return j;
 }
 
+/**
+ * Progress banners of DEV_Module_Init, left out of the fast start.
+ * Failures are always printed.
+**/
+static UBYTE Banners = 1;
+#define DEV_Banner(...) do { if (Banners) printf(__VA_ARGS__); } while (0)
+
 /******************************************************************************
-function:	Module Initialize, the library and initialize the pins, SPI protocol
+function:	Start the library, pins and SPI
 parameter:
+	Checks : Non zero runs the environment check and prints banners
 Info:
 ******************************************************************************/
-UBYTE DEV_Module_Init(void)
+static UBYTE DEV_Module_Start(UBYTE Checks)
 {
-    printf("/***********************************/ \r\n");
-	if(DEV_Equipment_Testing() < 0) {
+	Banners = Checks;
+    DEV_Banner("/***********************************/ \r\n");
+#ifndef USE_SIM_LIB
+	if(Checks && DEV_Equipment_Testing() < 0) {
 		return 1;
 	}
+#endif
 #ifdef RPI
-#ifdef USE_BCM2835_LIB
+#ifdef USE_SIM_LIB
+	// No hardware: GPIO and SPI calls are no-ops and BUSY always reads idle
+	DEV_Banner("simulated panel\r\n");
+	DEV_GPIO_Init();
+#elif USE_BCM2835_LIB
 	if(!bcm2835_init()) {
 		printf("bcm2835 init failed  !!! \r\n");
 		return 1;
 	} else {
-		printf("bcm2835 init success !!! \r\n");
+		DEV_Banner("bcm2835 init success !!! \r\n");
 	}
 
 	// GPIO Config
@@ -401,6 +600,7 @@ UBYTE DEV_Module_Init(void)
 	bcm2835_spi_setClockDivider(BCM2835_SPI_CLOCK_DIVIDER_128);  //Frequency
 	bcm2835_spi_chipSelect(BCM2835_SPI_CS0);                     //set CE0
 	bcm2835_spi_setChipSelectPolarity(BCM2835_SPI_CS0, LOW);     //enable cs0
+	bcm2835_spi_setChipSelectPolarity(BCM2835_SPI_CS1, LOW);     //CE1, for a second panel
 
 #elif USE_WIRINGPI_LIB
 	//if(wiringPiSetup() < 0)//use wiringpi Pin number table
@@ -408,7 +608,7 @@ UBYTE DEV_Module_Init(void)
 		printf("set wiringPi lib failed	!!! \r\n");
 		return 1;
 	} else {
-		printf("set wiringPi lib success !!! \r\n");
+		DEV_Banner("set wiringPi lib success !!! \r\n");
 	}
 
 	// GPIO Config
@@ -445,32 +645,67 @@ UBYTE DEV_Module_Init(void)
     SPI_Handle = lgSpiOpen(0, 0, 10000000, 0);
     DEV_GPIO_Init();
 #elif USE_DEV_LIB
-	printf("Write and read /dev/spidev0.0 \r\n");
+	DEV_Banner("Write and read /dev/spidev0.0 \r\n");
     GPIOD_Export();
 	DEV_GPIO_Init();
 	DEV_HARDWARE_SPI_begin("/dev/spidev0.0");
     DEV_HARDWARE_SPI_setSpeed(10000000);
+#elif USE_GPIOD2_LIB
+	DEV_Banner("gpiod v2 lines, write /dev/spidev0.0 \r\n");
+	DEV_GPIO_Init();
+	// One request for every line, held until DEV_Module_Exit
+	int Outputs[] = {EPD_RST_PIN, EPD_DC_PIN, EPD_CS_PIN, EPD_PWR_PIN};
+	if(GPIOD2_Open(Outputs, 4, EPD_BUSY_PIN) < 0) {
+		printf("gpiod line request failed (no access to /dev/gpiochip*?)\r\n");
+		return 1;
+	}
+	DEV_Digital_Write(EPD_CS_PIN, 1);
+	DEV_Digital_Write(EPD_PWR_PIN, 1);
+	DEV_HARDWARE_SPI_begin("/dev/spidev0.0");
+	DEV_HARDWARE_SPI_setSpeed(10000000);
 #endif
 
 #elif JETSON
 #ifdef USE_DEV_LIB
 	DEV_GPIO_Init();
-	printf("Software spi\r\n");
+	DEV_Banner("Software spi\r\n");
 	SYSFS_software_spi_begin();
 	SYSFS_software_spi_setBitOrder(SOFTWARE_SPI_MSBFIRST);
 	SYSFS_software_spi_setDataMode(SOFTWARE_SPI_Mode0);
 	SYSFS_software_spi_setClockDivider(SOFTWARE_SPI_CLOCK_DIV4);
 #elif USE_HARDWARE_LIB
-	printf("Write and read /dev/spidev0.0 \r\n");
+	DEV_Banner("Write and read /dev/spidev0.0 \r\n");
 	DEV_GPIO_Init();
 	DEV_HARDWARE_SPI_begin("/dev/spidev0.0");
 #endif
 
 #endif
-    printf("/***********************************/ \r\n");
+    DEV_Banner("/***********************************/ \r\n");
 	return 0;
 }
 
+/******************************************************************************
+function:	Module Initialize, the library and initialize the pins, SPI protocol
+parameter:
+Info:
+******************************************************************************/
+UBYTE DEV_Module_Init(void)
+{
+	return DEV_Module_Start(1);
+}
+
+/******************************************************************************
+function:	Module Initialize for a fast cold start
+parameter:
+Info:
+	Same as DEV_Module_Init without reading /etc/issue to check the build
+	target and without the banners.
+******************************************************************************/
+UBYTE DEV_Module_Init_Fast(void)
+{
+	return DEV_Module_Start(0);
+}
+
 /******************************************************************************
 function:	Module exits, closes SPI and BCM2835 library
 parameter:
@@ -510,6 +745,13 @@ void DEV_Module_Exit(void)
     GPIOD_Unexport(EPD_RST_PIN);
     GPIOD_Unexport(EPD_BUSY_PIN);
     GPIOD_Unexport_GPIO();
+#elif USE_GPIOD2_LIB
+	DEV_HARDWARE_SPI_end();
+	DEV_Digital_Write(EPD_CS_PIN, 0);
+    DEV_Digital_Write(EPD_PWR_PIN, 0);
+	DEV_Digital_Write(EPD_DC_PIN, 0);
+	DEV_Digital_Write(EPD_RST_PIN, 0);
+	GPIOD2_Close();
 #endif
 
 #elif JETSON
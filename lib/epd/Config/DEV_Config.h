@@ -57,7 +57,9 @@
 #include "Debug.h"
 
 #ifdef RPI
-    #ifdef USE_BCM2835_LIB
+    #ifdef USE_SIM_LIB
+        // Host build without hardware, for benchmarks and tests
+    #elif USE_BCM2835_LIB
         #include <bcm2835.h>
     #elif USE_WIRINGPI_LIB
         #include <wiringPi.h>
@@ -69,6 +71,9 @@
     #elif USE_DEV_LIB
         #include "RPI_gpiod.h"
         #include "dev_hardware_SPI.h"
+    #elif USE_GPIOD2_LIB
+        #include "RPI_gpiod2.h"
+        #include "dev_hardware_SPI.h"
     #endif
 #endif
 
@@ -100,19 +105,47 @@ extern int EPD_PWR_PIN;
 extern int EPD_MOSI_PIN;
 extern int EPD_SCLK_PIN;
 
+/**
+ * Statistics, totals since start. Panels refreshing on their own threads
+ * update them concurrently, so they are changed through DEV_Stats_Add and
+ * read with DEV_Stats_Get.
+**/
+typedef struct {
+    uint64_t SpiBytes;   // bytes clocked out over SPI
+    uint64_t BusyWaits;  // number of BUSY waits
+    uint64_t BusyUs;     // microseconds spent waiting on BUSY
+    uint64_t DelayUs;    // microseconds spent in fixed delays
+    uint64_t GpioWrites; // GPIO write operations, a masked write of several pins counting once
+} DEV_STATS;
+
+extern DEV_STATS DEV_Stats;
+
+void DEV_Stats_Add(uint64_t *Counter, uint64_t N);
+DEV_STATS DEV_Stats_Get(void);
+
 /*------------------------------------------------------------------------------------------------------*/
 void DEV_Digital_Write(UWORD Pin, UBYTE Value);
 UBYTE DEV_Digital_Read(UWORD Pin);
+void DEV_Digital_Write2(UWORD Pin1, UBYTE Value1, UWORD Pin2, UBYTE Value2);
+UBYTE DEV_Wait_Level(UWORD Pin, UBYTE Level, UDOUBLE Poll_us, UDOUBLE Timeout_us);
+UBYTE DEV_Panel_Init(int Rst, int Dc, int Cs, int Busy);
+
+void DEV_Bus_Lock(UWORD Cs);
+void DEV_Bus_Unlock(void);
 
 void DEV_SPI_WriteByte(UBYTE Value);
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len);
 void DEV_Delay_ms(UDOUBLE xms);
+void DEV_Delay_us(UDOUBLE xus);
+void DEV_Sleep_Until_us(uint64_t deadline_us);
+uint64_t DEV_Time_us(void);
 
 void DEV_SPI_SendData(UBYTE Reg);
 void DEV_SPI_SendnData(UBYTE *Reg);
 UBYTE DEV_SPI_ReadData();
 
 UBYTE DEV_Module_Init(void);
+UBYTE DEV_Module_Init_Fast(void);
 void DEV_Module_Exit(void);
 
 
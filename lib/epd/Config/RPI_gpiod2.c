@@ -0,0 +1,248 @@
+/*****************************************************************************
+* | File        :   RPI_gpiod2.c
+* | Function    :   Drive GPIO through the libgpiod v2 character device API
+* | Info        :   See RPI_gpiod2.h
+*----------------
+* |	This version:   V1.0
+* | Info        :   Basic version
+*
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documnetation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to  whom the Software is
+# furished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS OR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+******************************************************************************/
+#include "RPI_gpiod2.h"
+#include <stdio.h>
+#include <string.h>
+
+static struct gpiod_chip *Chip;
+static struct gpiod_line_request *Request;
+static struct gpiod_edge_event_buffer *Events;
+
+/**
+ * Lines held by the request. Output lines already used by a kernel driver
+ * (CS0 while spidev drives it) are left out and writes to them ignored.
+**/
+static unsigned int Lines[GPIOD2_MAX_LINES];
+static int LineCount;
+static int BusyPin = -1;
+
+static int GPIOD2_Held(int Pin)
+{
+    for(int i = 0; i < LineCount; i++) {
+        if(Lines[i] == (unsigned int)Pin)
+            return 1;
+    }
+    return 0;
+}
+
+/******************************************************************************
+function:	Open the chip driving the 40-pin header
+Info:
+	The header is on the chip labelled pinctrl-*: pinctrl-bcm2835 or
+	pinctrl-bcm2711 up to the Pi 4, pinctrl-rp1 on the Pi 5, whose number
+	depends on the kernel. Falls back to gpiochip0.
+******************************************************************************/
+static struct gpiod_chip *GPIOD2_Open_Chip(void)
+{
+    char path[32];
+    for(int i = 0; i < 16; i++) {
+        snprintf(path, sizeof(path), "/dev/gpiochip%d", i);
+        struct gpiod_chip *chip = gpiod_chip_open(path);
+        if(chip == NULL)
+            continue;
+        struct gpiod_chip_info *info = gpiod_chip_get_info(chip);
+        int header = info != NULL && strncmp(gpiod_chip_info_get_label(info), "pinctrl-", 8) == 0;
+        gpiod_chip_info_free(info);
+        if(header) {
+            GPIOD2_Debug("using %s\r\n", path);
+            return chip;
+        }
+        gpiod_chip_close(chip);
+    }
+    return gpiod_chip_open("/dev/gpiochip0");
+}
+
+static int GPIOD2_Line_Used(unsigned int Offset)
+{
+    struct gpiod_line_info *info = gpiod_chip_get_line_info(Chip, Offset);
+    if(info == NULL)
+        return 0;
+    int used = gpiod_line_info_is_used(info);
+    gpiod_line_info_free(info);
+    return used;
+}
+
+/******************************************************************************
+function:	Request the panel lines
+parameter:
+	Outputs : output lines, driven low initially
+	Count   : number of output lines
+	Busy    : input line, with edge detection on both edges
+Info:
+	Returns 0 on success. Fails when BUSY is held by another consumer or
+	cannot be read back, since every wait on the panel depends on it.
+******************************************************************************/
+int GPIOD2_Open(const int *Outputs, int Count, int Busy)
+{
+    struct gpiod_line_settings *out = NULL, *in = NULL;
+    struct gpiod_line_config *lines = NULL;
+    struct gpiod_request_config *config = NULL;
+    int ret = -1;
+
+    if(Count + 1 > GPIOD2_MAX_LINES)
+        return -1;
+    Chip = GPIOD2_Open_Chip();
+    if(Chip == NULL) {
+        printf("gpiod: no GPIO chip\r\n");
+        return -1;
+    }
+
+    if(GPIOD2_Line_Used(Busy)) {
+        printf("gpiod: BUSY line %d is in use\r\n", Busy);
+        goto done;
+    }
+
+    LineCount = 0;
+    for(int i = 0; i < Count; i++) {
+        if(GPIOD2_Line_Used(Outputs[i])) {
+            GPIOD2_Debug("line %d in use, left to its driver\r\n", Outputs[i]);
+            continue;
+        }
+        Lines[LineCount++] = Outputs[i];
+    }
+
+    out = gpiod_line_settings_new();
+    in = gpiod_line_settings_new();
+    lines = gpiod_line_config_new();
+    config = gpiod_request_config_new();
+    if(out == NULL || in == NULL || lines == NULL || config == NULL)
+        goto done;
+
+    gpiod_line_settings_set_direction(out, GPIOD_LINE_DIRECTION_OUTPUT);
+    gpiod_line_settings_set_output_value(out, GPIOD_LINE_VALUE_INACTIVE);
+    gpiod_line_settings_set_direction(in, GPIOD_LINE_DIRECTION_INPUT);
+    gpiod_line_settings_set_edge_detection(in, GPIOD_LINE_EDGE_BOTH);
+
+    unsigned int busy = Busy;
+    if(gpiod_line_config_add_line_settings(lines, Lines, LineCount, out) < 0 ||
+       gpiod_line_config_add_line_settings(lines, &busy, 1, in) < 0)
+        goto done;
+    gpiod_request_config_set_consumer(config, "epd");
+
+    Request = gpiod_chip_request_lines(Chip, config, lines);
+    if(Request == NULL) {
+        printf("gpiod: line request failed\r\n");
+        goto done;
+    }
+    if(gpiod_line_request_get_value(Request, busy) < 0) {
+        printf("gpiod: cannot read BUSY line %d\r\n", Busy);
+        goto done;
+    }
+    Events = gpiod_edge_event_buffer_new(4);
+    if(Events == NULL)
+        goto done;
+    Lines[LineCount++] = busy;
+    BusyPin = Busy;
+    ret = 0;
+
+done:
+    gpiod_request_config_free(config);
+    gpiod_line_config_free(lines);
+    gpiod_line_settings_free(in);
+    gpiod_line_settings_free(out);
+    if(ret < 0)
+        GPIOD2_Close();
+    return ret;
+}
+
+void GPIOD2_Close(void)
+{
+    if(Events != NULL)
+        gpiod_edge_event_buffer_free(Events);
+    if(Request != NULL)
+        gpiod_line_request_release(Request);
+    if(Chip != NULL)
+        gpiod_chip_close(Chip);
+    Events = NULL;
+    Request = NULL;
+    Chip = NULL;
+    LineCount = 0;
+    BusyPin = -1;
+}
+
+int GPIOD2_Write(int Pin, int Value)
+{
+    if(!GPIOD2_Held(Pin))
+        return 0;
+    return gpiod_line_request_set_value(Request, Pin,
+        Value ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE);
+}
+
+/******************************************************************************
+function:	Set two lines in one call
+Info:
+	Both values are applied by a single GPIO_V2_LINE_SET_VALUES ioctl, so
+	DC and CS change together.
+******************************************************************************/
+int GPIOD2_Write2(int Pin1, int Value1, int Pin2, int Value2)
+{
+    unsigned int offsets[2];
+    enum gpiod_line_value values[2];
+    size_t n = 0;
+
+    if(GPIOD2_Held(Pin1)) {
+        offsets[n] = Pin1;
+        values[n++] = Value1 ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+    }
+    if(GPIOD2_Held(Pin2)) {
+        offsets[n] = Pin2;
+        values[n++] = Value2 ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+    }
+    if(n == 0)
+        return 0;
+    return gpiod_line_request_set_values_subset(Request, n, offsets, values);
+}
+
+int GPIOD2_Read(int Pin)
+{
+    if(!GPIOD2_Held(Pin))
+        return -1;
+    return gpiod_line_request_get_value(Request, Pin);
+}
+
+/******************************************************************************
+function:	Wait for an edge on the BUSY line
+parameter:
+	Pin        : the line passed as Busy to GPIOD2_Open
+	Timeout_ns : longest wait
+Info:
+	Returns 1 after an edge, 0 on timeout, -1 on error. Queued events are
+	consumed, so the caller reads the level afterwards instead of trusting
+	the edge direction.
+******************************************************************************/
+int GPIOD2_Wait_Edge(int Pin, int64_t Timeout_ns)
+{
+    if(Pin != BusyPin)
+        return -1;
+    int ret = gpiod_line_request_wait_edge_events(Request, Timeout_ns);
+    if(ret <= 0)
+        return ret;
+    if(gpiod_line_request_read_edge_events(Request, Events, 4) < 0)
+        return -1;
+    return 1;
+}
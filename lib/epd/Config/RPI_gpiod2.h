@@ -0,0 +1,55 @@
+/*****************************************************************************
+* | File        :   RPI_gpiod2.h
+* | Function    :   Drive GPIO through the libgpiod v2 character device API
+* | Info        :
+*                All panel lines are requested once and the request is kept
+*                open, so a toggle is one ioctl on an open file descriptor
+*                instead of a sysfs open/write/close, and no root or /dev/mem
+*                access is needed. BUSY is requested with edge detection so
+*                waiting on it sleeps in the kernel instead of polling.
+*----------------
+* |	This version:   V1.0
+* | Info        :   Basic version
+*
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documnetation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to  whom the Software is
+# furished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS OR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+******************************************************************************/
+#ifndef __GPIOD2_
+#define __GPIOD2_
+
+#include <stdint.h>
+#include <gpiod.h>
+
+#define GPIOD2_MAX_LINES 8
+
+#define GPIOD2_DEBUG 0
+#if GPIOD2_DEBUG
+	#define GPIOD2_Debug(__info,...) printf("Debug: " __info,##__VA_ARGS__)
+#else
+	#define GPIOD2_Debug(__info,...)
+#endif
+
+int GPIOD2_Open(const int *Outputs, int Count, int Busy);
+void GPIOD2_Close(void);
+int GPIOD2_Write(int Pin, int Value);
+int GPIOD2_Write2(int Pin1, int Value1, int Pin2, int Value2);
+int GPIOD2_Read(int Pin);
+int GPIOD2_Wait_Edge(int Pin, int64_t Timeout_ns);
+
+#endif
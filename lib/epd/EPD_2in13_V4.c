@@ -31,18 +31,107 @@
 #include "EPD_2in13_V4.h"
 #include "Debug.h"
 
+/**
+ * Timing profiles, in microseconds
+**/
+// The delays of the original Waveshare driver
+const EPD_2in13_V4_TIMING EPD_2in13_V4_Timing_Waveshare = {
+    .ResetHighUs   = 20000,
+    .ResetLowUs    = 2000,
+    .ResetSettleUs = 20000,
+    .WakeLowUs     = 1000,
+    .SleepSettleUs = 100000,
+    .BusyPollUs    = 10000,
+    .BusyReleaseUs = 10000,
+    .BusyTimeoutUs = 10000000,
+};
+
+// Trimmed to the SSD1680 datasheet: RES# needs 10us low, the controller
+// raises BUSY for the reset itself, so beyond a short margin only the BUSY
+// line is waited on, and it is sampled often enough to catch the release
+// within a millisecond.
+const EPD_2in13_V4_TIMING EPD_2in13_V4_Timing_Datasheet = {
+    .ResetHighUs   = 0,
+    .ResetLowUs    = 200,
+    .ResetSettleUs = 1000,
+    .WakeLowUs     = 200,
+    .SleepSettleUs = 1000,
+    .BusyPollUs    = 500,
+    .BusyReleaseUs = 0,
+    .BusyTimeoutUs = 10000000,
+};
+
+static const EPD_2in13_V4_TIMING *DefaultTiming = &EPD_2in13_V4_Timing_Waveshare;
+
+/******************************************************************************
+function :	Select the default timing profile
+parameter:
+	Profile : Delays used by reset, wake, sleep and BUSY polling of panels
+	          without a profile of their own
+******************************************************************************/
+void EPD_2in13_V4_SetTiming(const EPD_2in13_V4_TIMING *Profile)
+{
+    DefaultTiming = Profile;
+}
+
+/**
+ * Panel driven by the calling thread. Without one the EPD_*_PIN globals
+ * are used, as for a single panel.
+**/
+static _Thread_local EPD_2in13_V4_PANEL *Panel;
+
+#define EPD_PANEL_PIN(Field, Default) (Panel != NULL ? Panel->Field : (Default))
+#define EPD_PANEL_RST   EPD_PANEL_PIN(RstPin, EPD_RST_PIN)
+#define EPD_PANEL_DC    EPD_PANEL_PIN(DcPin, EPD_DC_PIN)
+#define EPD_PANEL_CS    EPD_PANEL_PIN(CsPin, EPD_CS_PIN)
+#define EPD_PANEL_BUSY  EPD_PANEL_PIN(BusyPin, EPD_BUSY_PIN)
+#define EPD_PANEL_TIMING \
+    (Panel != NULL && Panel->Timing != NULL ? Panel->Timing : DefaultTiming)
+
+/******************************************************************************
+function :	Select the panel the calling thread drives
+parameter:
+	Selected : Its lines, or NULL for the EPD_*_PIN globals
+info:
+	The selection is per thread, so one thread per panel can run the
+	init, display and sleep sequences at the same time: SPI frames take
+	turns on the bus (DEV_Bus_Lock) while resets and BUSY waits overlap.
+******************************************************************************/
+void EPD_2in13_V4_Select(EPD_2in13_V4_PANEL *Selected)
+{
+    Panel = Selected;
+}
+
+/******************************************************************************
+function :	Hold RST high for High_us and low for Low_us, then release it
+			and wait Settle_us
+parameter:
+info:
+	The delays run against absolute deadlines, so the time spent toggling
+	the pin is not added on top.
+******************************************************************************/
+static void EPD_2in13_V4_PulseReset(UDOUBLE High_us, UDOUBLE Low_us, UDOUBLE Settle_us)
+{
+    uint64_t Deadline = DEV_Time_us();
+    DEV_Digital_Write(EPD_PANEL_RST, 1);
+    Deadline += High_us;
+    DEV_Sleep_Until_us(Deadline);
+    DEV_Digital_Write(EPD_PANEL_RST, 0);
+    Deadline += Low_us;
+    DEV_Sleep_Until_us(Deadline);
+    DEV_Digital_Write(EPD_PANEL_RST, 1);
+    Deadline += Settle_us;
+    DEV_Sleep_Until_us(Deadline);
+}
+
 /******************************************************************************
 function :	Software reset
 parameter:
 ******************************************************************************/
 static void EPD_2in13_V4_Reset(void)
 {
-    DEV_Digital_Write(EPD_RST_PIN, 1);
-    DEV_Delay_ms(20);
-    DEV_Digital_Write(EPD_RST_PIN, 0);
-    DEV_Delay_ms(2);
-    DEV_Digital_Write(EPD_RST_PIN, 1);
-    DEV_Delay_ms(20);
+    const EPD_2in13_V4_TIMING *Timing = EPD_PANEL_TIMING;
+    EPD_2in13_V4_PulseReset(Timing->ResetHighUs, Timing->ResetLowUs, Timing->ResetSettleUs);
 }
 
 /******************************************************************************
@@ -52,39 +141,105 @@ parameter:
 ******************************************************************************/
 static void EPD_2in13_V4_SendCommand(UBYTE Reg)
 {
-    DEV_Digital_Write(EPD_DC_PIN, 0);
-    DEV_Digital_Write(EPD_CS_PIN, 0);
+    DEV_Bus_Lock(EPD_PANEL_CS);
+    DEV_Digital_Write2(EPD_PANEL_DC, 0, EPD_PANEL_CS, 0);
     DEV_SPI_WriteByte(Reg);
-    DEV_Digital_Write(EPD_CS_PIN, 1);
+    DEV_Digital_Write(EPD_PANEL_CS, 1);
+    DEV_Bus_Unlock();
 }
 
 /******************************************************************************
-function :	send data
+function :	send a command and its parameters
 parameter:
-    Data : Write data
+     Reg  : Command register
+     Data : Parameter bytes
+     Len  : Number of parameter bytes
+info:
+	CS stays low from the command byte to the last parameter and only DC
+	changes in between, so a register write costs three GPIO writes
+	whatever its length, instead of three per byte.
 ******************************************************************************/
-static void EPD_2in13_V4_SendData(UBYTE Data)
+static void EPD_2in13_V4_WriteReg(UBYTE Reg, const UBYTE *Data, UDOUBLE Len)
 {
-    DEV_Digital_Write(EPD_DC_PIN, 1);
-    DEV_Digital_Write(EPD_CS_PIN, 0);
-    DEV_SPI_WriteByte(Data);
-    DEV_Digital_Write(EPD_CS_PIN, 1);
+    DEV_Bus_Lock(EPD_PANEL_CS);
+    DEV_Digital_Write2(EPD_PANEL_DC, 0, EPD_PANEL_CS, 0);
+    DEV_SPI_WriteByte(Reg);
+    if(Len > 0) {
+        DEV_Digital_Write(EPD_PANEL_DC, 1);
+        DEV_SPI_Write_nByte((UBYTE *)Data, Len);
+    }
+    DEV_Digital_Write(EPD_PANEL_CS, 1);
+    DEV_Bus_Unlock();
+}
+
+/**
+ * Register write with literal parameters:
+ * EPD_2in13_V4_Reg(0x01, 0xF9, 0x00, 0x00) sends 0x01 with three bytes
+**/
+#define EPD_2in13_V4_Reg(Reg, ...) do { \
+        const UBYTE Params_[] = {__VA_ARGS__}; \
+        EPD_2in13_V4_WriteReg(Reg, Params_, sizeof(Params_)); \
+    } while(0)
+
+/******************************************************************************
+function :	write a whole frame to a RAM register
+parameter:
+     Reg   : 0x24 (BW RAM) or 0x26 (RED RAM, the previous image for partial refresh)
+     Image : Frame of EPD_2in13_V4_WIDTH/8 rounded up by EPD_2in13_V4_HEIGHT bytes,
+             or NULL to send Fill everywhere
+info:
+	Same framing as EPD_2in13_V4_WriteReg: the frame goes out in one CS
+	frame, as one SPI transfer when Image is given.
+******************************************************************************/
+static void EPD_2in13_V4_WriteRam(UBYTE Reg, const UBYTE *Image, UBYTE Fill)
+{
+	UWORD Width, Height;
+    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
+    Height = EPD_2in13_V4_HEIGHT;
+
+    DEV_Bus_Lock(EPD_PANEL_CS);
+    DEV_Digital_Write2(EPD_PANEL_DC, 0, EPD_PANEL_CS, 0);
+    DEV_SPI_WriteByte(Reg);
+    DEV_Digital_Write(EPD_PANEL_DC, 1);
+    if(Image != NULL) {
+        DEV_SPI_Write_nByte((UBYTE *)Image, (UDOUBLE)Width * Height);
+    } else {
+        UBYTE Row[(EPD_2in13_V4_WIDTH + 7) / 8];
+        memset(Row, Fill, sizeof(Row));
+        for (UWORD j = 0; j < Height; j++) {
+            DEV_SPI_Write_nByte(Row, Width);
+        }
+    }
+    DEV_Digital_Write(EPD_PANEL_CS, 1);
+    DEV_Bus_Unlock();
 }
 
 /******************************************************************************
 function :	Wait until the busy_pin goes LOW
 parameter:
+info:
+	A wait that times out or cannot read the line sets BusyFailed on the
+	selected panel. Later waits on it then return at once, so a sequence
+	on a panel that is gone costs one timeout rather than one per step.
 ******************************************************************************/
 void EPD_2in13_V4_ReadBusy(void)
 {
+    if(Panel != NULL && Panel->BusyFailed)
+        return;
+    uint64_t Start = DEV_Time_us();
     Debug("e-Paper busy\r\n");
-	while(1)
-	{	 //=1 BUSY
-		if(DEV_Digital_Read(EPD_BUSY_PIN)==0) 
-			break;
-		DEV_Delay_ms(10);
-	}
-	DEV_Delay_ms(10);
+	if(DEV_Wait_Level(EPD_PANEL_BUSY, 0, EPD_PANEL_TIMING->BusyPollUs,
+	                  EPD_PANEL_TIMING->BusyTimeoutUs) != 0) { //=1 BUSY
+        if(Panel != NULL)
+            Panel->BusyFailed = 1;
+    } else {
+        DEV_Delay_us(EPD_PANEL_TIMING->BusyReleaseUs);
+    }
+    uint64_t Waited = DEV_Time_us() - Start;
+    DEV_Stats_Add(&DEV_Stats.BusyWaits, 1);
+    DEV_Stats_Add(&DEV_Stats.BusyUs, Waited);
+    if(Panel != NULL)
+        Panel->BusyUs += Waited;
     Debug("e-Paper busy release\r\n");
 }
 
@@ -98,15 +253,9 @@ parameter:
 ******************************************************************************/
 static void EPD_2in13_V4_SetWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
 {
-    EPD_2in13_V4_SendCommand(0x44); // SET_RAM_X_ADDRESS_START_END_POSITION
-    EPD_2in13_V4_SendData((Xstart>>3) & 0xFF);
-    EPD_2in13_V4_SendData((Xend>>3) & 0xFF);
+    EPD_2in13_V4_Reg(0x44, (Xstart>>3) & 0xFF, (Xend>>3) & 0xFF); // SET_RAM_X_ADDRESS_START_END_POSITION
 	
-    EPD_2in13_V4_SendCommand(0x45); // SET_RAM_Y_ADDRESS_START_END_POSITION
-    EPD_2in13_V4_SendData(Ystart & 0xFF);
-    EPD_2in13_V4_SendData((Ystart >> 8) & 0xFF);
-    EPD_2in13_V4_SendData(Yend & 0xFF);
-    EPD_2in13_V4_SendData((Yend >> 8) & 0xFF);
+    EPD_2in13_V4_Reg(0x45, Ystart & 0xFF, (Ystart >> 8) & 0xFF, Yend & 0xFF, (Yend >> 8) & 0xFF); // SET_RAM_Y_ADDRESS_START_END_POSITION
 }
 
 /******************************************************************************
@@ -117,12 +266,35 @@ parameter:
 ******************************************************************************/
 static void EPD_2in13_V4_SetCursor(UWORD Xstart, UWORD Ystart)
 {
-    EPD_2in13_V4_SendCommand(0x4E); // SET_RAM_X_ADDRESS_COUNTER
-    EPD_2in13_V4_SendData(Xstart & 0xFF);
+    EPD_2in13_V4_Reg(0x4E, Xstart & 0xFF); // SET_RAM_X_ADDRESS_COUNTER
 
-    EPD_2in13_V4_SendCommand(0x4F); // SET_RAM_Y_ADDRESS_COUNTER
-    EPD_2in13_V4_SendData(Ystart & 0xFF);
-    EPD_2in13_V4_SendData((Ystart >> 8) & 0xFF);
+    EPD_2in13_V4_Reg(0x4F, Ystart & 0xFF, (Ystart >> 8) & 0xFF); // SET_RAM_Y_ADDRESS_COUNTER
+}
+
+/******************************************************************************
+function :	write a whole frame in either layout to a RAM register
+parameter:
+     Reg    : 0x24 or 0x26, see EPD_2in13_V4_WriteRam
+     Image  : Frame in Layout
+     Layout : EPD_2in13_V4_LAYOUT_ROWS or EPD_2in13_V4_LAYOUT_PAGES
+info:
+	The window is the same in both layouts. For pages the address counter
+	is switched to move along Y first (data entry mode 0x07), so each
+	byte of a page goes one row further down, and the page after it
+	starts at the next X address. Mode 0x03 is put back afterwards, which
+	the rest of the driver assumes.
+******************************************************************************/
+static void EPD_2in13_V4_WriteFrame(UBYTE Reg, const UBYTE *Image, UBYTE Layout)
+{
+    if(Layout != EPD_2in13_V4_LAYOUT_PAGES) {
+        EPD_2in13_V4_WriteRam(Reg, Image, 0);
+        return;
+    }
+	EPD_2in13_V4_Reg(0x11, 0x07); //data entry mode, Y first
+	EPD_2in13_V4_SetCursor(0, 0);
+    EPD_2in13_V4_WriteRam(Reg, Image, 0);
+	EPD_2in13_V4_Reg(0x11, 0x03); //data entry mode
+	EPD_2in13_V4_SetCursor(0, 0);
 }
 
 /******************************************************************************
@@ -131,24 +303,21 @@ parameter:
 ******************************************************************************/
 static void EPD_2in13_V4_TurnOnDisplay(void)
 {
-	EPD_2in13_V4_SendCommand(0x22); // Display Update Control
-	EPD_2in13_V4_SendData(0xf7);
+	EPD_2in13_V4_Reg(0x22, 0xf7); // Display Update Control
 	EPD_2in13_V4_SendCommand(0x20); // Activate Display Update Sequence
 	EPD_2in13_V4_ReadBusy();
 }
 
 static void EPD_2in13_V4_TurnOnDisplay_Fast(void)
 {
-	EPD_2in13_V4_SendCommand(0x22); // Display Update Control
-	EPD_2in13_V4_SendData(0xc7);	// fast:0x0c, quality:0x0f, 0xcf
+	EPD_2in13_V4_Reg(0x22, 0xc7); // Display Update Control (fast:0x0c, quality:0x0f, 0xcf)
 	EPD_2in13_V4_SendCommand(0x20); // Activate Display Update Sequence
 	EPD_2in13_V4_ReadBusy();
 }
 
 static void EPD_2in13_V4_TurnOnDisplay_Partial(void)
 {
-	EPD_2in13_V4_SendCommand(0x22); // Display Update Control
-	EPD_2in13_V4_SendData(0xff);	// fast:0x0c, quality:0x0f, 0xcf
+	EPD_2in13_V4_Reg(0x22, 0xff); // Display Update Control (fast:0x0c, quality:0x0f, 0xcf)
 	EPD_2in13_V4_SendCommand(0x20); // Activate Display Update Sequence
 	EPD_2in13_V4_ReadBusy();
 }
@@ -165,26 +334,18 @@ void EPD_2in13_V4_Init(void)
 	EPD_2in13_V4_SendCommand(0x12);  //SWRESET
 	EPD_2in13_V4_ReadBusy();   
 		
-	EPD_2in13_V4_SendCommand(0x01); //Driver output control      
-	EPD_2in13_V4_SendData(0xF9);
-	EPD_2in13_V4_SendData(0x00);
-	EPD_2in13_V4_SendData(0x00);
+	EPD_2in13_V4_Reg(0x01, 0xF9, 0x00, 0x00); //Driver output control
 
-	EPD_2in13_V4_SendCommand(0x11); //data entry mode       
-	EPD_2in13_V4_SendData(0x03);
+	EPD_2in13_V4_Reg(0x11, 0x03); //data entry mode
 
 	EPD_2in13_V4_SetWindows(0, 0, EPD_2in13_V4_WIDTH-1, EPD_2in13_V4_HEIGHT-1);
 	EPD_2in13_V4_SetCursor(0, 0);
 
-	EPD_2in13_V4_SendCommand(0x3C); //BorderWavefrom
-	EPD_2in13_V4_SendData(0x05);	
+	EPD_2in13_V4_Reg(0x3C, 0x05); //BorderWavefrom
 		
-	EPD_2in13_V4_SendCommand(0x21); //  Display update control
-	EPD_2in13_V4_SendData(0x00);		
-	EPD_2in13_V4_SendData(0x80);	
+	EPD_2in13_V4_Reg(0x21, 0x00, 0x80); //  Display update control
 		
-	EPD_2in13_V4_SendCommand(0x18); //Read built-in temperature sensor
-	EPD_2in13_V4_SendData(0x80);	
+	EPD_2in13_V4_Reg(0x18, 0x80); //Read built-in temperature sensor
 	EPD_2in13_V4_ReadBusy();  
 }
 
@@ -195,62 +356,64 @@ void EPD_2in13_V4_Init_Fast(void)
 	EPD_2in13_V4_SendCommand(0x12);  //SWRESET
 	EPD_2in13_V4_ReadBusy();   
 
-	EPD_2in13_V4_SendCommand(0x18); //Read built-in temperature sensor
-	EPD_2in13_V4_SendData(0x80);
+	EPD_2in13_V4_Reg(0x18, 0x80); //Read built-in temperature sensor
 
-	EPD_2in13_V4_SendCommand(0x11); //data entry mode       
-	EPD_2in13_V4_SendData(0x03);
+	EPD_2in13_V4_Reg(0x11, 0x03); //data entry mode
 
 	EPD_2in13_V4_SetWindows(0, 0, EPD_2in13_V4_WIDTH-1, EPD_2in13_V4_HEIGHT-1);
 	EPD_2in13_V4_SetCursor(0, 0);	
 		
-	EPD_2in13_V4_SendCommand(0x22); // Load temperature value
-	EPD_2in13_V4_SendData(0xB1);		
+	EPD_2in13_V4_Reg(0x22, 0xB1); // Load temperature value
 	EPD_2in13_V4_SendCommand(0x20);	
 	EPD_2in13_V4_ReadBusy();   
 
-	EPD_2in13_V4_SendCommand(0x1A); // Write to temperature register
-	EPD_2in13_V4_SendData(0x64);		
-	EPD_2in13_V4_SendData(0x00);	
+	EPD_2in13_V4_Reg(0x1A, 0x64, 0x00); // Write to temperature register
 					
-	EPD_2in13_V4_SendCommand(0x22); // Load temperature value
-	EPD_2in13_V4_SendData(0x91);		
+	EPD_2in13_V4_Reg(0x22, 0x91); // Load temperature value
 	EPD_2in13_V4_SendCommand(0x20);	
 	EPD_2in13_V4_ReadBusy();   
 }
 
+/******************************************************************************
+function :	Wake the e-Paper from deep sleep
+parameter:
+info:
+	Deep sleep mode 1 keeps the RAM, so the previous image the partial
+	refresh compares against survives. A hardware reset wakes the controller
+	and puts the registers back to their defaults; only the ones the display
+	functions rely on are written again. No SWRESET and no clear.
+******************************************************************************/
+void EPD_2in13_V4_Init_Wake(void)
+{
+    EPD_2in13_V4_PulseReset(0, EPD_PANEL_TIMING->WakeLowUs, 0);
+	EPD_2in13_V4_ReadBusy();
+
+	EPD_2in13_V4_Reg(0x01, 0xF9, 0x00, 0x00); //Driver output control
+
+	EPD_2in13_V4_Reg(0x11, 0x03); //data entry mode
+
+	EPD_2in13_V4_SetWindows(0, 0, EPD_2in13_V4_WIDTH-1, EPD_2in13_V4_HEIGHT-1);
+	EPD_2in13_V4_SetCursor(0, 0);
+
+	EPD_2in13_V4_Reg(0x3C, 0x05); //BorderWavefrom
+
+	EPD_2in13_V4_Reg(0x18, 0x80); //Read built-in temperature sensor
+}
+
 /******************************************************************************
 function :	Clear screen
 parameter:
 ******************************************************************************/
 void EPD_2in13_V4_Clear(void)
 {
-	UWORD Width, Height;
-    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
-    Height = EPD_2in13_V4_HEIGHT;
-	
-    EPD_2in13_V4_SendCommand(0x24);
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {
-            EPD_2in13_V4_SendData(0XFF);
-        }
-    }	
+    EPD_2in13_V4_WriteRam(0x24, NULL, 0XFF);
 
 	EPD_2in13_V4_TurnOnDisplay();
 }
 
 void EPD_2in13_V4_Clear_Black(void)
 {
-	UWORD Width, Height;
-    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
-    Height = EPD_2in13_V4_HEIGHT;
-	
-    EPD_2in13_V4_SendCommand(0x24);
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {
-            EPD_2in13_V4_SendData(0X00);
-        }
-    }	
+    EPD_2in13_V4_WriteRam(0x24, NULL, 0X00);
 
 	EPD_2in13_V4_TurnOnDisplay();
 }
@@ -262,32 +425,14 @@ parameter:
 ******************************************************************************/
 void EPD_2in13_V4_Display(UBYTE *Image)
 {
-	UWORD Width, Height;
-    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
-    Height = EPD_2in13_V4_HEIGHT;
-	
-    EPD_2in13_V4_SendCommand(0x24);
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {
-            EPD_2in13_V4_SendData(Image[i + j * Width]);
-        }
-    }	
+    EPD_2in13_V4_WriteRam(0x24, Image, 0);
 	
 	EPD_2in13_V4_TurnOnDisplay();	
 }
 
 void EPD_2in13_V4_Display_Fast(UBYTE *Image)
 {
-	UWORD Width, Height;
-    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
-    Height = EPD_2in13_V4_HEIGHT;
-	
-    EPD_2in13_V4_SendCommand(0x24);
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {
-            EPD_2in13_V4_SendData(Image[i + j * Width]);
-        }
-    }	
+    EPD_2in13_V4_WriteRam(0x24, Image, 0);
 	
 	EPD_2in13_V4_TurnOnDisplay_Fast();	
 }
@@ -300,23 +445,14 @@ parameter:
 ******************************************************************************/
 void EPD_2in13_V4_Display_Base(UBYTE *Image)
 {  
-	UWORD Width, Height;
-    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
-    Height = EPD_2in13_V4_HEIGHT;
-	
-	EPD_2in13_V4_SendCommand(0x24);   //Write Black and White image to RAM
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {        
-			EPD_2in13_V4_SendData(Image[i + j * Width]);
-		}
-	}
-	EPD_2in13_V4_SendCommand(0x26);   //Write Black and White image to RAM
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {
-			EPD_2in13_V4_SendData(Image[i + j * Width]);
-		}
-	}
-	EPD_2in13_V4_TurnOnDisplay();	
+	EPD_2in13_V4_Display_Base_Layout(Image, EPD_2in13_V4_LAYOUT_ROWS);
+}
+
+void EPD_2in13_V4_Display_Base_Layout(UBYTE *Image, UBYTE Layout)
+{
+	EPD_2in13_V4_WriteFrame(0x24, Image, Layout); //Write Black and White image to RAM
+	EPD_2in13_V4_WriteFrame(0x26, Image, Layout); //Write Black and White image to RAM
+	EPD_2in13_V4_TurnOnDisplay();
 }
 
 /******************************************************************************
@@ -326,35 +462,24 @@ parameter:
 ******************************************************************************/
 void EPD_2in13_V4_Display_Partial(UBYTE *Image)
 {
-	UWORD Width, Height;
-    Width = (EPD_2in13_V4_WIDTH % 8 == 0)? (EPD_2in13_V4_WIDTH / 8 ): (EPD_2in13_V4_WIDTH / 8 + 1);
-    Height = EPD_2in13_V4_HEIGHT;
-	
+	EPD_2in13_V4_Display_Partial_Layout(Image, EPD_2in13_V4_LAYOUT_ROWS);
+}
+
+void EPD_2in13_V4_Display_Partial_Layout(UBYTE *Image, UBYTE Layout)
+{
 	//Reset
-    DEV_Digital_Write(EPD_RST_PIN, 0);
-    DEV_Delay_ms(1);
-    DEV_Digital_Write(EPD_RST_PIN, 1);
+    EPD_2in13_V4_PulseReset(0, EPD_PANEL_TIMING->WakeLowUs, 0);
 
-	EPD_2in13_V4_SendCommand(0x3C); //BorderWavefrom
-	EPD_2in13_V4_SendData(0x80);	
+	EPD_2in13_V4_Reg(0x3C, 0x80); //BorderWavefrom
 
-	EPD_2in13_V4_SendCommand(0x01); //Driver output control      
-	EPD_2in13_V4_SendData(0xF9);
-	EPD_2in13_V4_SendData(0x00);
-	EPD_2in13_V4_SendData(0x00);
+	EPD_2in13_V4_Reg(0x01, 0xF9, 0x00, 0x00); //Driver output control
 	
-	EPD_2in13_V4_SendCommand(0x11); //data entry mode       
-	EPD_2in13_V4_SendData(0x03);
+	EPD_2in13_V4_Reg(0x11, 0x03); //data entry mode
 
 	EPD_2in13_V4_SetWindows(0, 0, EPD_2in13_V4_WIDTH-1, EPD_2in13_V4_HEIGHT-1);
 	EPD_2in13_V4_SetCursor(0, 0);
 
-	EPD_2in13_V4_SendCommand(0x24);   //Write Black and White image to RAM
-    for (UWORD j = 0; j < Height; j++) {
-        for (UWORD i = 0; i < Width; i++) {
-			EPD_2in13_V4_SendData(Image[i + j * Width]);
-		}
-	}
+	EPD_2in13_V4_WriteFrame(0x24, Image, Layout); //Write Black and White image to RAM
 	EPD_2in13_V4_TurnOnDisplay_Partial();
 }
 
@@ -364,7 +489,6 @@ parameter:
 ******************************************************************************/
 void EPD_2in13_V4_Sleep(void)
 {
-	EPD_2in13_V4_SendCommand(0x10); //enter deep sleep
-	EPD_2in13_V4_SendData(0x01); 
-	DEV_Delay_ms(100);
+	EPD_2in13_V4_Reg(0x10, 0x01); //enter deep sleep
+	DEV_Delay_us(EPD_PANEL_TIMING->SleepSettleUs);
 }
@@ -38,15 +38,54 @@
 #define EPD_2in13_V4_WIDTH       122
 #define EPD_2in13_V4_HEIGHT      250
 
+// Delays of the reset, wake and sleep sequences and of BUSY polling, and the
+// longest BUSY wait, in microseconds
+typedef struct {
+    UDOUBLE ResetHighUs;   // RST high before the reset pulse
+    UDOUBLE ResetLowUs;    // reset pulse width
+    UDOUBLE ResetSettleUs; // after the reset pulse, before the first command
+    UDOUBLE WakeLowUs;     // reset pulse waking from deep sleep or before a partial refresh
+    UDOUBLE SleepSettleUs; // after the deep sleep command
+    UDOUBLE BusyPollUs;    // BUSY sampling interval, unless the GPIO backend has edge events
+    UDOUBLE BusyReleaseUs; // after BUSY goes low
+    UDOUBLE BusyTimeoutUs; // longest BUSY wait before the panel is given up on
+} EPD_2in13_V4_TIMING;
+
+extern const EPD_2in13_V4_TIMING EPD_2in13_V4_Timing_Waveshare;
+extern const EPD_2in13_V4_TIMING EPD_2in13_V4_Timing_Datasheet;
+
+void EPD_2in13_V4_SetTiming(const EPD_2in13_V4_TIMING *Profile);
+
+// Lines of one panel, its delays and its time on BUSY. Panels share SPI and
+// may share DC; each needs its own CS, RST and BUSY.
+typedef struct {
+    int RstPin;
+    int DcPin;
+    int CsPin;
+    int BusyPin;
+    const EPD_2in13_V4_TIMING *Timing; // NULL uses the EPD_2in13_V4_SetTiming profile
+    uint64_t BusyUs; // microseconds spent waiting on this panel's BUSY
+    UBYTE BusyFailed; // a BUSY wait timed out or could not read the line; cleared by the caller
+} EPD_2in13_V4_PANEL;
+
+void EPD_2in13_V4_Select(EPD_2in13_V4_PANEL *Panel);
+
+// Frame layouts of the *_Layout display functions
+#define EPD_2in13_V4_LAYOUT_ROWS   0 // HEIGHT rows of WIDTH/8 bytes, data entry mode 0x03
+#define EPD_2in13_V4_LAYOUT_PAGES  1 // WIDTH/8 pages of HEIGHT bytes, data entry mode 0x07 (PAINT_LAYOUT_PAGES)
+
 void EPD_2in13_V4_Init(void);
 void EPD_2in13_V4_Init_Fast(void);
 void EPD_2in13_V4_Init_GUI(void);
+void EPD_2in13_V4_Init_Wake(void);
 void EPD_2in13_V4_Clear(void);
 void EPD_2in13_V4_Clear_Black(void);
 void EPD_2in13_V4_Display(UBYTE *Image);
 void EPD_2in13_V4_Display_Fast(UBYTE *Image);
 void EPD_2in13_V4_Display_Base(UBYTE *Image);
 void EPD_2in13_V4_Display_Partial(UBYTE *Image);
+void EPD_2in13_V4_Display_Base_Layout(UBYTE *Image, UBYTE Layout);
+void EPD_2in13_V4_Display_Partial_Layout(UBYTE *Image, UBYTE Layout);
 void EPD_2in13_V4_Sleep(void);
 
 
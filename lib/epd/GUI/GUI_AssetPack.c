@@ -0,0 +1,111 @@
+/*****************************************************************************
+* | File      	:   GUI_AssetPack.c
+* | Function    :   Read only images mapped from an asset pack
+* | Info        :
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :
+******************************************************************************/
+#include "GUI_AssetPack.h"
+#include "Debug.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/******************************************************************************
+function:	Map an asset pack and check its index
+parameter:
+    Pack : Filled in on success, release with GUI_AssetPack_Close()
+    path : Pack file, usually assets.pak
+return:
+    0 on success, 1 if the file cannot be mapped or is not a valid pack
+******************************************************************************/
+UBYTE GUI_AssetPack_Open(GUI_ASSETPACK *Pack, const char *path)
+{
+    const GUI_ASSETPACK_HEADER *Header;
+    struct stat st;
+    UWORD i;
+    int fd;
+
+    memset(Pack, 0, sizeof(GUI_ASSETPACK));
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        Debug("Cann't open asset pack %s\r\n", path);
+        return 1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(GUI_ASSETPACK_HEADER)) {
+        close(fd);
+        return 1;
+    }
+
+    void *Map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); //The mapping keeps the file referenced
+    if (Map == MAP_FAILED) {
+        Debug("asset pack mmap failed\r\n");
+        return 1;
+    }
+    Pack->Base = (const UBYTE *)Map;
+    Pack->Length = st.st_size;
+
+    Header = (const GUI_ASSETPACK_HEADER *)Pack->Base;
+    Pack->Count = Header->Count;
+    Pack->Index = (const GUI_ASSETPACK_ENTRY *)(Pack->Base + sizeof(GUI_ASSETPACK_HEADER));
+    if (memcmp(Header->Magic, GUI_ASSETPACK_MAGIC, 4) != 0 || Header->Version != GUI_ASSETPACK_VERSION ||
+        sizeof(GUI_ASSETPACK_HEADER) + (size_t)Pack->Count * sizeof(GUI_ASSETPACK_ENTRY) > Pack->Length) {
+        Debug("%s is not an asset pack\r\n", path);
+        GUI_AssetPack_Close(Pack);
+        return 1;
+    }
+
+    // Validate once here so lookups can trust every entry
+    for (i = 0; i < Pack->Count; i++) {
+        const GUI_ASSETPACK_ENTRY *Entry = &Pack->Index[i];
+        if (Entry->Name[GUI_ASSETPACK_NAME_LEN - 1] != '\0' ||
+            Entry->Offset > Pack->Length || Entry->Size > Pack->Length - Entry->Offset ||
+            (i > 0 && strcmp(Pack->Index[i - 1].Name, Entry->Name) >= 0)) {
+            Debug("asset pack entry %d is corrupt\r\n", i);
+            GUI_AssetPack_Close(Pack);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************
+function:	Find an asset by name
+parameter:
+    Pack : Open pack
+    name : C identifier the image had in ImageData.c, e.g. "gImage_2in13"
+    Size : Optional, receives the asset size in bytes
+return:
+    Pointer into the mapping, valid until GUI_AssetPack_Close(), or NULL
+******************************************************************************/
+const UBYTE *GUI_AssetPack_Find(const GUI_ASSETPACK *Pack, const char *name, UDOUBLE *Size)
+{
+    int Low = 0, High = (int)Pack->Count - 1;
+
+    while (Low <= High) {
+        int Mid = (Low + High) / 2;
+        int Cmp = strcmp(name, Pack->Index[Mid].Name);
+        if (Cmp == 0) {
+            if (Size != NULL)
+                *Size = Pack->Index[Mid].Size;
+            return Pack->Base + Pack->Index[Mid].Offset;
+        }
+        if (Cmp < 0)
+            High = Mid - 1;
+        else
+            Low = Mid + 1;
+    }
+    return NULL;
+}
+
+void GUI_AssetPack_Close(GUI_ASSETPACK *Pack)
+{
+    if (Pack->Base != NULL)
+        munmap((void *)Pack->Base, Pack->Length);
+    memset(Pack, 0, sizeof(GUI_ASSETPACK));
+}
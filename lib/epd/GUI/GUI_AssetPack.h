@@ -0,0 +1,48 @@
+/*****************************************************************************
+* | File      	:   GUI_AssetPack.h
+* | Function    :   Read only images mapped from an asset pack
+* | Info        :
+*   The sample images of ImageData.c are no longer linked in, `make assets`
+*   packs them into assets.pak instead. Opening the pack maps it read only;
+*   lookups return pointers straight into the mapping, so nothing is copied
+*   and only the pages of images actually drawn are ever read from disk.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :
+******************************************************************************/
+#ifndef __GUI_ASSETPACK_H
+#define __GUI_ASSETPACK_H
+
+#include <stddef.h>
+#include "DEV_Config.h"
+
+#define GUI_ASSETPACK_MAGIC     "EPDA"
+#define GUI_ASSETPACK_VERSION   1
+#define GUI_ASSETPACK_NAME_LEN  40
+
+/*On disk layout, little-endian; written by tools/mkassets*/
+typedef struct {
+    char Magic[4];
+    UWORD Version;
+    UWORD Count;        //Index entries that follow
+} __attribute__ ((packed)) GUI_ASSETPACK_HEADER;
+
+typedef struct {
+    char Name[GUI_ASSETPACK_NAME_LEN];  //NUL padded, entries sorted by name
+    UDOUBLE Offset;                     //From the start of the file
+    UDOUBLE Size;
+} __attribute__ ((packed)) GUI_ASSETPACK_ENTRY;
+
+typedef struct {
+    const UBYTE *Base;
+    size_t Length;
+    UWORD Count;
+    const GUI_ASSETPACK_ENTRY *Index;
+} GUI_ASSETPACK;
+
+UBYTE GUI_AssetPack_Open(GUI_ASSETPACK *Pack, const char *path);
+const UBYTE *GUI_AssetPack_Find(const GUI_ASSETPACK *Pack, const char *name, UDOUBLE *Size);
+void GUI_AssetPack_Close(GUI_ASSETPACK *Pack);
+
+#endif
@@ -6,10 +6,14 @@
 *                Used to shield the underlying layers of each master
 *                and enhance portability
 *----------------
-* |	This version:   V2.3
-* | Date        :   2022-07-27
+* |	This version:   V2.4
+* | Date        :   2026-10-19
 * | Info        :   
 * -----------------------------------------------------------------------------
+* V2.4(2026-10-19):
+* 1.Read pixel data a whole row at a time and paste rows into the image
+*   instead of staging the full picture on the stack
+* 2.Return GUI_BMP_ERR_* codes instead of calling exit()
 * V2.3(2022-07-27):
 * 1.Add GUI_ReadBmp_RGB_4Color()
 * V2.2(2020-07-08):
@@ -50,480 +54,473 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
-#include <stdlib.h>	//exit()
+#include <stdlib.h>	//malloc()
 #include <string.h> //memset()
-#include <math.h> //memset()
 #include <stdio.h>
 
-UBYTE GUI_ReadBmp(const char *path, UWORD Xstart, UWORD Ystart)
+/*An open bitmap: geometry, palette and one stored row of scratch space*/
+typedef struct {
+    FILE *fp;
+    UWORD Width;
+    UWORD Height;
+    UWORD BitCount;
+    UBYTE TopDown;              //biHeight < 0: rows are stored top to bottom
+    UDOUBLE Offset;             //File offset of the first stored row
+    UDOUBLE Stride;             //Bytes per stored row, padded to 4
+    UDOUBLE RowBytes;           //Bytes per stored row that carry pixels
+    UDOUBLE NextRow;            //Stored row the file pointer is sitting on
+    BMPRGBQUAD Palette[256];
+    UBYTE *Row;                 //Stride bytes, one stored row
+} BMP_READER;
+
+static void BMP_Close(BMP_READER *bmp)
+{
+    if(bmp->fp != NULL) {
+        fclose(bmp->fp);
+        bmp->fp = NULL;
+    }
+    free(bmp->Row);
+    bmp->Row = NULL;
+}
+
+/******************************************************************************
+function:	Open a bitmap and validate it against the expected bit depth
+parameter:
+    bmp      : Reader to fill in
+    path     : File path
+    BitCount : Required bits per pixel
+info:
+    Only the headers and palette are read here, pixel rows are pulled one at
+    a time by BMP_ReadRow() so memory stays at one row whatever the image size.
+******************************************************************************/
+static UBYTE BMP_Open(BMP_READER *bmp, const char *path, UWORD BitCount)
 {
-    FILE *fp;                     //Define a file pointer
     BMPFILEHEADER bmpFileHeader;  //Define a bmp file header structure
     BMPINFOHEADER bmpInfoHeader;  //Define a bmp info header structure
+    int32_t Width, Height;
 
+    memset(bmp, 0, sizeof(BMP_READER));
 
     // Binary file open
-    if((fp = fopen(path, "rb")) == NULL) {
+    if((bmp->fp = fopen(path, "rb")) == NULL) {
         Debug("Cann't open the file!\n");
-        exit(0);
+        return GUI_BMP_ERR_OPEN;
     }
 
-    // Set the file pointer from the beginning
-    fseek(fp, 0, SEEK_SET);
-    fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 14
-    fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 50
-    printf("pixel = %d * %d\r\n", bmpInfoHeader.biWidth, bmpInfoHeader.biHeight);
-
-    UWORD Image_Width_Byte = (bmpInfoHeader.biWidth % 8 == 0)? (bmpInfoHeader.biWidth / 8): (bmpInfoHeader.biWidth / 8 + 1);
-    UWORD Bmp_Width_Byte = (Image_Width_Byte % 4 == 0) ? Image_Width_Byte: ((Image_Width_Byte / 4 + 1) * 4);
-    UBYTE Image[Image_Width_Byte * bmpInfoHeader.biHeight];
-    memset(Image, 0xFF, Image_Width_Byte * bmpInfoHeader.biHeight);
-
-    // Determine if it is a monochrome bitmap
-    int readbyte = bmpInfoHeader.biBitCount;
-    if(readbyte != 1) {
-        Debug("the bmp Image is not a monochrome bitmap!\n");
-        exit(0);
+    if(fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, bmp->fp) != 1 ||
+       fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, bmp->fp) != 1 ||
+       bmpFileHeader.bType != 0x4D42) { //"BM"
+        Debug("the file is not a bmp image!\n");
+        BMP_Close(bmp);
+        return GUI_BMP_ERR_HEADER;
     }
 
-    // Determine black and white based on the palette
-    UWORD i;
-    UWORD Bcolor, Wcolor;
-    UWORD bmprgbquadsize = pow(2, bmpInfoHeader.biBitCount);// 2^1 = 2
-    BMPRGBQUAD bmprgbquad[bmprgbquadsize];        //palette
-    // BMPRGBQUAD bmprgbquad[2];        //palette
-
-    for(i = 0; i < bmprgbquadsize; i++){
-    // for(i = 0; i < 2; i++) {
-        fread(&bmprgbquad[i], sizeof(BMPRGBQUAD), 1, fp);
+    Width = (int32_t)bmpInfoHeader.biWidth;
+    Height = (int32_t)bmpInfoHeader.biHeight;
+    Debug("pixel = %d * %d\r\n", Width, Height);
+    if(Height < 0) {
+        bmp->TopDown = 1;
+        Height = -Height;
     }
-    if(bmprgbquad[0].rgbBlue == 0xff && bmprgbquad[0].rgbGreen == 0xff && bmprgbquad[0].rgbRed == 0xff) {
-        Bcolor = BLACK;
-        Wcolor = WHITE;
-    } else {
-        Bcolor = WHITE;
-        Wcolor = BLACK;
+    if(Width <= 0 || Width > 0xFFFF || Height == 0 || Height > 0xFFFF) {
+        Debug("bmp size out of range!\n");
+        BMP_Close(bmp);
+        return GUI_BMP_ERR_HEADER;
     }
 
-    // Read image data into the cache
-    UWORD x, y;
-    UBYTE Rdata;
-    fseek(fp, bmpFileHeader.bOffset, SEEK_SET);
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {//Total display column
-        for(x = 0; x < Bmp_Width_Byte; x++) {//Show a line in the line
-            if(fread((char *)&Rdata, 1, readbyte, fp) != readbyte) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-            if(x < Image_Width_Byte) { //bmp
-                Image[x + (bmpInfoHeader.biHeight - y - 1) * Image_Width_Byte] =  Rdata;
-                // printf("rdata = %d\r\n", Rdata);
-            }
-        }
+    if(bmpInfoHeader.biBitCount != BitCount || bmpInfoHeader.biCompression != 0) {
+        Debug("the bmp Image is not an uncompressed %d bit bitmap!\n", BitCount);
+        BMP_Close(bmp);
+        return GUI_BMP_ERR_FORMAT;
     }
-    fclose(fp);
-
-    // Refresh the image to the display buffer based on the displayed orientation
-    UBYTE color, temp;
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {
-        for(x = 0; x < bmpInfoHeader.biWidth; x++) {
-            if(x > Paint.Width || y > Paint.Height) {
-                break;
-            }
-            temp = Image[(x / 8) + (y * Image_Width_Byte)];
-            color = (((temp << (x%8)) & 0x80) == 0x80) ?Bcolor:Wcolor;
-            Paint_SetPixel(Xstart + x, Ystart + y, color);
+
+    bmp->Width = Width;
+    bmp->Height = Height;
+    bmp->BitCount = BitCount;
+    bmp->Offset = bmpFileHeader.bOffset;
+    bmp->RowBytes = ((UDOUBLE)bmp->Width * BitCount + 7) / 8;
+    bmp->Stride = (((UDOUBLE)bmp->Width * BitCount + 31) / 32) * 4;
+
+    // The palette follows the info header, whatever size that header is
+    if(BitCount <= 8) {
+        UDOUBLE Colors = bmpInfoHeader.biClrUsed ? bmpInfoHeader.biClrUsed : (1u << BitCount);
+        if(Colors > 256)
+            Colors = 256;
+        if(fseek(bmp->fp, sizeof(BMPFILEHEADER) + bmpInfoHeader.biInfoSize, SEEK_SET) != 0 ||
+           fread(bmp->Palette, sizeof(BMPRGBQUAD), Colors, bmp->fp) != Colors) {
+            Debug("get bmp palette failed!\n");
+            BMP_Close(bmp);
+            return GUI_BMP_ERR_HEADER;
         }
     }
-    return 0;
+
+    bmp->Row = (UBYTE *)malloc(bmp->Stride);
+    if(bmp->Row == NULL) {
+        Debug("bmp row buffer malloc failed!\n");
+        BMP_Close(bmp);
+        return GUI_BMP_ERR_NOMEM;
+    }
+    bmp->NextRow = (UDOUBLE)-1;
+    return GUI_BMP_OK;
 }
-/*************************************************************************
 
-*************************************************************************/
-UBYTE GUI_ReadBmp_4Gray(const char *path, UWORD Xstart, UWORD Ystart)
+/*Display row (0 = top) of the Index-th row in file order*/
+static UWORD BMP_StoredRowY(const BMP_READER *bmp, UWORD Index)
 {
-    FILE *fp;                     //Define a file pointer
-    BMPFILEHEADER bmpFileHeader;  //Define a bmp file header structure
-    BMPINFOHEADER bmpInfoHeader;  //Define a bmp info header structure
-    
-    // Binary file open
-    if((fp = fopen(path, "rb")) == NULL) {
-        Debug("Cann't open the file!\n");
-        exit(0);
+    return bmp->TopDown ? Index : bmp->Height - 1 - Index;
+}
+
+/******************************************************************************
+function:	Read one row of pixel data into bmp->Row
+parameter:
+    bmp : Open reader
+    Y   : Display row, 0 is the top of the image
+info:
+    Reading rows in file order (see BMP_StoredRowY) never seeks.
+******************************************************************************/
+static UBYTE BMP_ReadRow(BMP_READER *bmp, UWORD Y)
+{
+    UDOUBLE Stored = bmp->TopDown ? Y : (UDOUBLE)bmp->Height - 1 - Y;
+
+    if(Stored != bmp->NextRow) {
+        if(fseek(bmp->fp, bmp->Offset + Stored * bmp->Stride, SEEK_SET) != 0) {
+            perror("get bmpdata:\r\n");
+            return GUI_BMP_ERR_READ;
+        }
     }
- 
-    // Set the file pointer from the beginning
-    fseek(fp, 0, SEEK_SET);
-    fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 14
-    fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 50
-    printf("pixel = %d * %d\r\n", bmpInfoHeader.biWidth, bmpInfoHeader.biHeight);
-
-    UWORD Image_Width_Byte = (bmpInfoHeader.biWidth % 4 == 0)? (bmpInfoHeader.biWidth / 4): (bmpInfoHeader.biWidth / 4 + 1);
-    UWORD Bmp_Width_Byte = (bmpInfoHeader.biWidth % 2 == 0)? (bmpInfoHeader.biWidth / 2): (bmpInfoHeader.biWidth / 2 + 1);
-    UBYTE Image[Image_Width_Byte * bmpInfoHeader.biHeight * 2];
-    memset(Image, 0xFF, Image_Width_Byte * bmpInfoHeader.biHeight * 2);
-
-    // Determine if it is a monochrome bitmap
-    int readbyte = bmpInfoHeader.biBitCount;
-    printf("biBitCount = %d\r\n",readbyte);
-    if(readbyte != 4){
-        Debug("Bmp image is not a 4-color bitmap!\n");
-        exit(0);
+    // Some encoders drop the padding of the last row, only pixels are required
+    if(fread(bmp->Row, 1, bmp->Stride, bmp->fp) < bmp->RowBytes) {
+        perror("get bmpdata:\r\n");
+        bmp->NextRow = (UDOUBLE)-1;
+        return GUI_BMP_ERR_READ;
     }
-    // Read image data into the cache
-    UWORD x, y;
-    UBYTE Rdata;
-    fseek(fp, bmpFileHeader.bOffset, SEEK_SET);
-    
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {//Total display column
-        for(x = 0; x < Bmp_Width_Byte; x++) {//Show a line in the line
-            if(fread((char *)&Rdata, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-            if(x < Image_Width_Byte*2) { //bmp
-                Image[x + (bmpInfoHeader.biHeight - y - 1) * Image_Width_Byte*2] =  Rdata;
-            }
+    bmp->NextRow = Stored + 1;
+    return GUI_BMP_OK;
+}
+
+/*A palette entry counts as white when its luma is in the upper half*/
+static UBYTE BMP_IsWhite(const BMPRGBQUAD *Quad)
+{
+    return (Quad->rgbRed * 77 + Quad->rgbGreen * 150 + Quad->rgbBlue * 29) >= (128 << 8);
+}
+
+/******************************************************************************
+function:	Build the table that turns 8 stored 1bpp pixels into panel bits
+parameter:
+    Palette : The two palette entries of a monochrome bitmap
+    Lut     : 256 entries, stored byte -> panel byte (1 = white, 0 = black)
+******************************************************************************/
+static void BMP_BuildMonoLut(const BMPRGBQUAD *Palette, UBYTE *Lut)
+{
+    UBYTE White0 = BMP_IsWhite(&Palette[0]) ? 0xFF : 0x00;
+    UBYTE White1 = BMP_IsWhite(&Palette[1]) ? 0xFF : 0x00;
+    UWORD i;
+
+    for(i = 0; i < 256; i++) {
+        Lut[i] = (i & White1) | (~i & White0);
+    }
+}
+
+UBYTE GUI_ReadBmp(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    BMP_READER bmp;
+    UBYTE Lut[256];
+    UDOUBLE i;
+    UWORD n, y;
+
+    UBYTE ret = BMP_Open(&bmp, path, 1);
+    if(ret != GUI_BMP_OK)
+        return ret;
+
+    // Determine black and white based on the palette
+    BMP_BuildMonoLut(bmp.Palette, Lut);
+
+    // Convert each row to panel bits and paste it straight into the image
+    for(n = 0; n < bmp.Height; n++) {
+        y = BMP_StoredRowY(&bmp, n);
+        if((UDOUBLE)Ystart + y >= Paint.Height)
+            continue;
+        if((ret = BMP_ReadRow(&bmp, y)) != GUI_BMP_OK)
+            break;
+        for(i = 0; i < bmp.RowBytes; i++) {
+            bmp.Row[i] = Lut[bmp.Row[i]];
         }
+        Paint_DrawBitMap_Paste(bmp.Row, Xstart, Ystart + y, bmp.Width, 1, 0);
     }
-    fclose(fp);
-    
-    // Refresh the image to the display buffer based on the displayed orientation
-    UBYTE color, temp;
-    printf("bmpInfoHeader.biWidth = %d\r\n",bmpInfoHeader.biWidth);
-    printf("bmpInfoHeader.biHeight = %d\r\n",bmpInfoHeader.biHeight);
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {
-        for(x = 0; x < bmpInfoHeader.biWidth; x++) {
-            if(x > Paint.Width || y > Paint.Height) {
-                break;
-            }
-            temp = Image[x/2 + y * bmpInfoHeader.biWidth/2] >> ((x%2)? 0:4);//0xf 0x8 0x7 0x0 
-            color = temp>>2;                           //11  10  01  00  
-            Paint_SetPixel(Xstart + x, Ystart + y, color);
+
+    BMP_Close(&bmp);
+    return ret;
+}
+/******************************************************************************
+function:	Decode a monochrome bitmap into memory in panel format
+parameter:
+    path   : File path
+    Bitmap : Filled in on success, release with GUI_FreeBmp()
+info:
+    Nothing is drawn, the result can be pasted any number of times with
+    Paint_DrawBitMap_Paste().
+******************************************************************************/
+UBYTE GUI_DecodeBmp(const char *path, GUI_BITMAP *Bitmap)
+{
+    BMP_READER bmp;
+    UBYTE Lut[256];
+    UDOUBLE i;
+    UWORD n, y;
+
+    memset(Bitmap, 0, sizeof(GUI_BITMAP));
+    UBYTE ret = BMP_Open(&bmp, path, 1);
+    if(ret != GUI_BMP_OK)
+        return ret;
+
+    Bitmap->Width = bmp.Width;
+    Bitmap->Height = bmp.Height;
+    Bitmap->WidthByte = bmp.RowBytes;
+    Bitmap->Data = (UBYTE *)malloc((UDOUBLE)Bitmap->WidthByte * Bitmap->Height);
+    if(Bitmap->Data == NULL) {
+        Debug("bmp image malloc failed!\n");
+        BMP_Close(&bmp);
+        return GUI_BMP_ERR_NOMEM;
+    }
+
+    BMP_BuildMonoLut(bmp.Palette, Lut);
+    for(n = 0; n < bmp.Height; n++) {
+        y = BMP_StoredRowY(&bmp, n);
+        if((ret = BMP_ReadRow(&bmp, y)) != GUI_BMP_OK)
+            break;
+        UBYTE *dst = Bitmap->Data + (UDOUBLE)y * Bitmap->WidthByte;
+        for(i = 0; i < bmp.RowBytes; i++) {
+            dst[i] = Lut[bmp.Row[i]];
         }
     }
-    return 0;
+
+    BMP_Close(&bmp);
+    if(ret != GUI_BMP_OK)
+        GUI_FreeBmp(Bitmap);
+    return ret;
 }
 
-UBYTE GUI_ReadBmp_16Gray(const char *path, UWORD Xstart, UWORD Ystart)
+void GUI_FreeBmp(GUI_BITMAP *Bitmap)
 {
-    FILE *fp;                     //Define a file pointer
-    BMPFILEHEADER bmpFileHeader;  //Define a bmp file header structure
-    BMPINFOHEADER bmpInfoHeader;  //Define a bmp info header structure
+    free(Bitmap->Data);
+    memset(Bitmap, 0, sizeof(GUI_BITMAP));
+}
 
-    // Binary file open
-    if((fp = fopen(path, "rb")) == NULL) {
-        Debug("Cann't open the file!\n");
-        exit(0);
-    }
+/*************************************************************************
 
-    // Set the file pointer from the beginning
-    fseek(fp, 0, SEEK_SET);
-    fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 14
-    fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 50
-    printf("pixel = %d * %d\r\n", bmpInfoHeader.biWidth, bmpInfoHeader.biHeight);
-
-    // They are both the same width in bytes
-    // round up to the next byte
-    UWORD Width_Byte = (bmpInfoHeader.biWidth + 1) / 2;
-    UBYTE Image[Width_Byte * bmpInfoHeader.biHeight];
-    memset(Image, 0xFF, Width_Byte * bmpInfoHeader.biHeight);
-
-    // Determine if it is a monochrome bitmap
-    int readbyte = bmpInfoHeader.biBitCount;
-    printf("biBitCount = %d\r\n",readbyte);
-    if(readbyte != 4) {
-        Debug("Bmp image is not a 4-bit bitmap!\n");
-        exit(0);
+*************************************************************************/
+UBYTE GUI_ReadBmp_4Gray(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    BMP_READER bmp;
+    UWORD n, x, y;
+    UBYTE color;
+
+    UBYTE ret = BMP_Open(&bmp, path, 4);
+    if(ret != GUI_BMP_OK)
+        return ret;
+
+    for(n = 0; n < bmp.Height; n++) {
+        y = BMP_StoredRowY(&bmp, n);
+        if((UDOUBLE)Ystart + y >= Paint.Height)
+            continue;
+        if((ret = BMP_ReadRow(&bmp, y)) != GUI_BMP_OK)
+            break;
+        for(x = 0; x < bmp.Width && (UDOUBLE)Xstart + x < Paint.Width; x++) {
+            color = (bmp.Row[x / 2] >> ((x % 2)? 0:4)) & 0x0F;   //0xf 0x8 0x7 0x0
+            Paint_SetPixel(Xstart + x, Ystart + y, color >> 2);  //11  10  01  00
+        }
     }
 
-    // Determine colors based on the palette
+    BMP_Close(&bmp);
+    return ret;
+}
 
-    // A map from palette entry to color
-    UBYTE colors[16];
-    UBYTE i;
-    BMPRGBQUAD rgbData;
+UBYTE GUI_ReadBmp_16Gray(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    BMP_READER bmp;
+    UBYTE colors[16];   // A map from palette entry to color
+    UWORD n, x, y;
+    UBYTE i, coloridx;
 
-    for (i = 0; i < 16; i++){
-        fread(&rgbData, sizeof(BMPRGBQUAD), 1, fp);
+    UBYTE ret = BMP_Open(&bmp, path, 4);
+    if(ret != GUI_BMP_OK)
+        return ret;
 
+    for (i = 0; i < 16; i++) {
         // Work out the closest colour
         // 16 colours over 0-255 => 0-8 => 0, 9-25 => 1 (17), 26-42 => 2 (34), etc
 
         // Base it on red
-        colors[i] = (rgbData.rgbRed + 8) / 17;
+        colors[i] = (bmp.Palette[i].rgbRed + 8) / 17;
     }
 
-    // Read image data into the cache
-    UWORD x, y;
-    UBYTE Rdata;
-    fseek(fp, bmpFileHeader.bOffset, SEEK_SET);
-
-    for (y = 0; y < bmpInfoHeader.biHeight; y++) {//Total display column
-        for (x = 0; x < Width_Byte; x++) {//Show a line in the line
-            if (fread((char *) &Rdata, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-            Image[x + (bmpInfoHeader.biHeight - y - 1) * Width_Byte] = Rdata;
-        }
-    }
-    fclose(fp);
-
-    // Refresh the image to the display buffer based on the displayed orientation
-    UBYTE coloridx;
-    printf("bmpInfoHeader.biWidth = %d\r\n", bmpInfoHeader.biWidth);
-    printf("bmpInfoHeader.biHeight = %d\r\n", bmpInfoHeader.biHeight);
-    for (y = 0; y < bmpInfoHeader.biHeight; y++) {
-        for (x = 0; x < bmpInfoHeader.biWidth; x++) {
-            if (Xstart + x > Paint.Width || Ystart + y > Paint.Height)
-                break;
-
-            coloridx = (Image[x / 2 + y * Width_Byte] >> ((x % 2) ? 0 : 4)) & 15;
+    for (n = 0; n < bmp.Height; n++) {
+        y = BMP_StoredRowY(&bmp, n);
+        if ((UDOUBLE)Ystart + y >= Paint.Height)
+            continue;
+        if ((ret = BMP_ReadRow(&bmp, y)) != GUI_BMP_OK)
+            break;
+        for (x = 0; x < bmp.Width && (UDOUBLE)Xstart + x < Paint.Width; x++) {
+            coloridx = (bmp.Row[x / 2] >> ((x % 2) ? 0 : 4)) & 15;
             Paint_SetPixel(Xstart + x, Ystart + y, colors[coloridx]);
         }
     }
-    return 0;
+
+    BMP_Close(&bmp);
+    return ret;
 }
 
-UBYTE GUI_ReadBmp_RGB_7Color(const char *path, UWORD Xstart, UWORD Ystart)
+/******************************************************************************
+function:	Draw an 8 bit palette or 24 bit bitmap in black and white
+parameter:
+    path   : File path
+    Xstart : X coordinate of the top left corner
+    Ystart : Y coordinate of the top left corner
+    Mode   : Dithering used to reach two colors
+info:
+    Rows are read top to bottom, turned into gray, dithered and pasted one
+    at a time, so memory use is a few rows whatever the picture size.
+******************************************************************************/
+UBYTE GUI_ReadBmp_Dither(const char *path, UWORD Xstart, UWORD Ystart, DITHER_MODE Mode)
 {
-    FILE *fp;                     //Define a file pointer
-    BMPFILEHEADER bmpFileHeader;  //Define a bmp file header structure
-    BMPINFOHEADER bmpInfoHeader;  //Define a bmp info header structure
-    
-    // Binary file open
-    if((fp = fopen(path, "rb")) == NULL) {
-        Debug("Cann't open the file!\n");
-        exit(0);
+    BMP_READER bmp;
+    GUI_DITHER Dither;
+    UBYTE Luma[256];
+    UWORD i, x, y;
+
+    UBYTE ret = BMP_Open(&bmp, path, 24);
+    if(ret == GUI_BMP_ERR_FORMAT)
+        ret = BMP_Open(&bmp, path, 8);
+    if(ret != GUI_BMP_OK)
+        return ret;
+
+    UWORD Width_Byte = (bmp.Width % 8 == 0)? (bmp.Width / 8): (bmp.Width / 8 + 1);
+    UBYTE *Gray = (UBYTE *)malloc((UDOUBLE)bmp.Width + Width_Byte);
+    if(Gray == NULL || GUI_Dither_Begin(&Dither, bmp.Width, Mode) != 0) {
+        free(Gray);
+        BMP_Close(&bmp);
+        return GUI_BMP_ERR_NOMEM;
     }
+    UBYTE *Bits = Gray + bmp.Width;
 
-    // Set the file pointer from the beginning
-    fseek(fp, 0, SEEK_SET);
-    fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 14
-    fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 50
-    printf("pixel = %d * %d\r\n", bmpInfoHeader.biWidth, bmpInfoHeader.biHeight);
-	
-    UDOUBLE Image_Byte = bmpInfoHeader.biWidth * bmpInfoHeader.biHeight * 3;
-    UBYTE Image[Image_Byte];
-    memset(Image, 0xFF, Image_Byte);
-
-    // Determine if it is a monochrome bitmap
-    int readbyte = bmpInfoHeader.biBitCount;
-    if(readbyte != 24){
-        Debug("Bmp image is not 24 bitmap!\n");
-        exit(0);
-    }
-    // Read image data into the cache
-    UWORD x, y;
-    UBYTE Rdata[3];
-    fseek(fp, bmpFileHeader.bOffset, SEEK_SET);
-    
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {//Total display column
-        for(x = 0; x < bmpInfoHeader.biWidth ; x++) {//Show a line in the line
-            if(fread((char *)Rdata, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(fread((char *)Rdata+1, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(fread((char *)Rdata+2, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-
-			if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 0){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  0;//Black
-			}else if(Rdata[0] == 255 && Rdata[1] == 255 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  1;//White
-			}else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 0){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  2;//Green
-			}else if(Rdata[0] == 255 && Rdata[1] == 0 && Rdata[2] == 0){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  3;//Blue
-			}else if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  4;//Red
-			}else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  5;//Yellow
-			}else if(Rdata[0] == 0 && Rdata[1] == 128 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  6;//Orange
-			}
+    if(bmp.BitCount == 8) {
+        for(i = 0; i < 256; i++) {
+            Luma[i] = (bmp.Palette[i].rgbBlue * 29 + bmp.Palette[i].rgbGreen * 150 +
+                       bmp.Palette[i].rgbRed * 77) >> 8;
         }
     }
-    fclose(fp);
-   
-    // Refresh the image to the display buffer based on the displayed orientation
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {
-        for(x = 0; x < bmpInfoHeader.biWidth; x++) {
-            if(x > Paint.Width || y > Paint.Height) {
-                break;
+
+    for(y = 0; y < bmp.Height && (UDOUBLE)Ystart + y < Paint.Height; y++) {
+        if((ret = BMP_ReadRow(&bmp, y)) != GUI_BMP_OK)
+            break;
+        if(bmp.BitCount == 8) {
+            for(x = 0; x < bmp.Width; x++) {
+                Gray[x] = Luma[bmp.Row[x]];
             }
-            Paint_SetPixel(Xstart + x, Ystart + y, Image[bmpInfoHeader.biHeight *  bmpInfoHeader.biWidth - 1 -(bmpInfoHeader.biWidth-x-1+(y* bmpInfoHeader.biWidth))]);
-		}
+        } else {
+            GUI_Dither_BGRToGray(bmp.Row, Gray, bmp.Width);
+        }
+        GUI_Dither_Row(&Dither, Gray, Bits);
+        Paint_DrawBitMap_Paste(Bits, Xstart, Ystart + y, bmp.Width, 1, 0);
     }
-    return 0;
+
+    GUI_Dither_End(&Dither);
+    free(Gray);
+    BMP_Close(&bmp);
+    return ret;
 }
 
-UBYTE GUI_ReadBmp_RGB_4Color(const char *path, UWORD Xstart, UWORD Ystart)
-{
-    FILE *fp;                     //Define a file pointer
-    BMPFILEHEADER bmpFileHeader;  //Define a bmp file header structure
-    BMPINFOHEADER bmpInfoHeader;  //Define a bmp info header structure
-    
-    // Binary file open
-    if((fp = fopen(path, "rb")) == NULL) {
-        Debug("Cann't open the file!\n");
-        exit(0);
-    }
+/*Palette index of a 24 bit pixel (B, G, R), 0xFF when it matches no color*/
+typedef UBYTE (*BMP_CLASSIFY)(const UBYTE *Rdata);
 
-    // Set the file pointer from the beginning
-    fseek(fp, 0, SEEK_SET);
-    fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 14
-    fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 50
-    printf("pixel = %d * %d\r\n", bmpInfoHeader.biWidth, bmpInfoHeader.biHeight);
-	
-    UDOUBLE Image_Byte = bmpInfoHeader.biWidth * bmpInfoHeader.biHeight * 3;
-    UBYTE Image[Image_Byte];
-    memset(Image, 0xFF, Image_Byte);
-
-    // Determine if it is a monochrome bitmap
-    int readbyte = bmpInfoHeader.biBitCount;
-    if(readbyte != 24){
-        Debug("Bmp image is not 24 bitmap!\n");
-        exit(0);
-    }
-    // Read image data into the cache
-    UWORD x, y;
-    UBYTE Rdata[3];
-    fseek(fp, bmpFileHeader.bOffset, SEEK_SET);
-    
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {//Total display column
-        for(x = 0; x < bmpInfoHeader.biWidth ; x++) {//Show a line in the line
-            if(fread((char *)Rdata, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(fread((char *)Rdata+1, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(fread((char *)Rdata+2, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(Rdata[0] < 128 && Rdata[1] < 128 && Rdata[2] < 128){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  0;//Black
-			}else if(Rdata[0] > 127 && Rdata[1] > 127 && Rdata[2] > 127){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  1;//White
-			}else if(Rdata[0] < 128 && Rdata[1] > 127 && Rdata[2] > 127){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  2;//Yellow
-			}else if(Rdata[0] < 128 && Rdata[1] < 128 && Rdata[2] > 127){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  3;//Red
-			}
-        }
-        if(bmpInfoHeader.biWidth % 4 != 0)
-        {
-            for (UWORD i = 0; i < (bmpInfoHeader.biWidth % 4); i++)
-            {
-                if(fread((char *)Rdata, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-                }
-            }
-        }
-    }
-    fclose(fp);
-   
-    // Refresh the image to the display buffer based on the displayed orientation
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {
-        for(x = 0; x < bmpInfoHeader.biWidth; x++) {
-            if(x > Paint.Width || y > Paint.Height) {
-                break;
-            }
-            Paint_SetPixel(Xstart + x, Ystart + y, Image[bmpInfoHeader.biHeight *  bmpInfoHeader.biWidth - 1 -(bmpInfoHeader.biWidth-x-1+(y* bmpInfoHeader.biWidth))]);
-		}
+static UBYTE BMP_Classify_7Color(const UBYTE *Rdata)
+{
+    if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 0){
+        return 0;//Black
+    }else if(Rdata[0] == 255 && Rdata[1] == 255 && Rdata[2] == 255){
+        return 1;//White
+    }else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 0){
+        return 2;//Green
+    }else if(Rdata[0] == 255 && Rdata[1] == 0 && Rdata[2] == 0){
+        return 3;//Blue
+    }else if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 255){
+        return 4;//Red
+    }else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 255){
+        return 5;//Yellow
+    }else if(Rdata[0] == 0 && Rdata[1] == 128 && Rdata[2] == 255){
+        return 6;//Orange
     }
-    return 0;
+    return 0xFF;
 }
 
-UBYTE GUI_ReadBmp_RGB_6Color(const char *path, UWORD Xstart, UWORD Ystart)
+static UBYTE BMP_Classify_4Color(const UBYTE *Rdata)
 {
-    FILE *fp;                     //Define a file pointer
-    BMPFILEHEADER bmpFileHeader;  //Define a bmp file header structure
-    BMPINFOHEADER bmpInfoHeader;  //Define a bmp info header structure
-    
-    // Binary file open
-    if((fp = fopen(path, "rb")) == NULL) {
-        Debug("Cann't open the file!\n");
-        exit(0);
+    if(Rdata[0] < 128 && Rdata[1] < 128 && Rdata[2] < 128){
+        return 0;//Black
+    }else if(Rdata[0] > 127 && Rdata[1] > 127 && Rdata[2] > 127){
+        return 1;//White
+    }else if(Rdata[0] < 128 && Rdata[1] > 127 && Rdata[2] > 127){
+        return 2;//Yellow
+    }else if(Rdata[0] < 128 && Rdata[1] < 128 && Rdata[2] > 127){
+        return 3;//Red
     }
+    return 0xFF;
+}
 
-    // Set the file pointer from the beginning
-    fseek(fp, 0, SEEK_SET);
-    fread(&bmpFileHeader, sizeof(BMPFILEHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 14
-    fread(&bmpInfoHeader, sizeof(BMPINFOHEADER), 1, fp);    //sizeof(BMPFILEHEADER) must be 50
-    printf("pixel = %d * %d\r\n", bmpInfoHeader.biWidth, bmpInfoHeader.biHeight);
-	
-    UDOUBLE Image_Byte = bmpInfoHeader.biWidth * bmpInfoHeader.biHeight * 3;
-    UBYTE Image[Image_Byte];
-    memset(Image, 0xFF, Image_Byte);
-
-    // Determine if it is a monochrome bitmap
-    int readbyte = bmpInfoHeader.biBitCount;
-    if(readbyte != 24){
-        Debug("Bmp image is not 24 bitmap!\n");
-        exit(0);
+static UBYTE BMP_Classify_6Color(const UBYTE *Rdata)
+{
+    if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 0){
+        return 0;//Black
+    }else if(Rdata[0] == 255 && Rdata[1] == 255 && Rdata[2] == 255){
+        return 1;//White
+    }else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 255){
+        return 2;//Yellow
+    }else if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 255){
+        return 3;//Red
+    // }else if(Rdata[0] == 0 && Rdata[1] == 128 && Rdata[2] == 255){
+    // 	return 4;//Orange
+    }else if(Rdata[0] == 255 && Rdata[1] == 0 && Rdata[2] == 0){
+        return 5;//Blue
+    }else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 0){
+        return 6;//Green
     }
-    // Read image data into the cache
-    UWORD x, y;
-    UBYTE Rdata[3];
-    fseek(fp, bmpFileHeader.bOffset, SEEK_SET);
-    
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {//Total display column
-        for(x = 0; x < bmpInfoHeader.biWidth ; x++) {//Show a line in the line
-            if(fread((char *)Rdata, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(fread((char *)Rdata+1, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
-			if(fread((char *)Rdata+2, 1, 1, fp) != 1) {
-                perror("get bmpdata:\r\n");
-                break;
-            }
+    return 0xFF;
+}
 
-			if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 0){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  0;//Black
-			}else if(Rdata[0] == 255 && Rdata[1] == 255 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  1;//White
-			}else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  2;//Yellow
-			}else if(Rdata[0] == 0 && Rdata[1] == 0 && Rdata[2] == 255){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  3;//Red
-			// }else if(Rdata[0] == 0 && Rdata[1] == 128 && Rdata[2] == 255){
-			// 	Image[x+(y* bmpInfoHeader.biWidth )] =  4;//Orange
-			}else if(Rdata[0] == 255 && Rdata[1] == 0 && Rdata[2] == 0){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  5;//Blue
-			}else if(Rdata[0] == 0 && Rdata[1] == 255 && Rdata[2] == 0){
-				Image[x+(y* bmpInfoHeader.biWidth )] =  6;//Green
-			}
-            
+static UBYTE BMP_ReadRGB(const char *path, UWORD Xstart, UWORD Ystart, BMP_CLASSIFY Classify)
+{
+    BMP_READER bmp;
+    UWORD n, x, y;
+
+    UBYTE ret = BMP_Open(&bmp, path, 24);
+    if(ret != GUI_BMP_OK)
+        return ret;
+
+    for(n = 0; n < bmp.Height; n++) {
+        y = BMP_StoredRowY(&bmp, n);
+        if((UDOUBLE)Ystart + y >= Paint.Height)
+            continue;
+        if((ret = BMP_ReadRow(&bmp, y)) != GUI_BMP_OK)
+            break;
+        for(x = 0; x < bmp.Width && (UDOUBLE)Xstart + x < Paint.Width; x++) {
+            Paint_SetPixel(Xstart + x, Ystart + y, Classify(&bmp.Row[x * 3]));
         }
     }
-    fclose(fp);
-   
-    // Refresh the image to the display buffer based on the displayed orientation
-    for(y = 0; y < bmpInfoHeader.biHeight; y++) {
-        for(x = 0; x < bmpInfoHeader.biWidth; x++) {
-            if(x > Paint.Width || y > Paint.Height) {
-                break;
-            }
-            Paint_SetPixel(Xstart + x, Ystart + y, Image[bmpInfoHeader.biHeight *  bmpInfoHeader.biWidth - 1 -(bmpInfoHeader.biWidth-x-1+(y* bmpInfoHeader.biWidth))]);
-		}
-    }
-    return 0;
+
+    BMP_Close(&bmp);
+    return ret;
+}
+
+UBYTE GUI_ReadBmp_RGB_7Color(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    return BMP_ReadRGB(path, Xstart, Ystart, BMP_Classify_7Color);
+}
+
+UBYTE GUI_ReadBmp_RGB_4Color(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    return BMP_ReadRGB(path, Xstart, Ystart, BMP_Classify_4Color);
 }
 
+UBYTE GUI_ReadBmp_RGB_6Color(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    return BMP_ReadRGB(path, Xstart, Ystart, BMP_Classify_6Color);
+}
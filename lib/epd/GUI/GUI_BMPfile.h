@@ -6,10 +6,14 @@
 *                Used to shield the underlying layers of each master
 *                and enhance portability
 *----------------
-* |	This version:   V2.3
-* | Date        :   2020-07-27
+* |	This version:   V2.4
+* | Date        :   2026-10-19
 * | Info        :   
 * -----------------------------------------------------------------------------
+* V2.4(2026-10-19):
+* 1.Read pixel data a whole row at a time and paste rows into the image
+*   instead of staging the full picture on the stack
+* 2.Return GUI_BMP_ERR_* codes instead of calling exit()
 * V2.3(2022-07-27):
 * 1.Add GUI_ReadBmp_RGB_4Color()
 * V2.2(2020-07-08):
@@ -51,6 +55,7 @@
 #include <stdint.h>
 
 #include "DEV_Config.h"
+#include "GUI_Dither.h"
 
 /*Bitmap file header   14bit*/
 typedef struct BMP_FILE_HEADER {
@@ -85,10 +90,31 @@ typedef struct RGB_QUAD {
 } __attribute__ ((packed)) BMPRGBQUAD;
 /**************************************** end ***********************************************/
 
+/*Return values of the GUI_ReadBmp family*/
+#define GUI_BMP_OK              0
+#define GUI_BMP_ERR_OPEN        1   //File cannot be opened
+#define GUI_BMP_ERR_HEADER      2   //Not a bmp, or truncated headers/palette
+#define GUI_BMP_ERR_FORMAT      3   //Unsupported bit depth or compression
+#define GUI_BMP_ERR_NOMEM       4   //Row buffer allocation failed
+#define GUI_BMP_ERR_READ        5   //Pixel data ended early
+
+/*A decoded picture in panel format: 1 bit per pixel, MSB first, 1 = white*/
+typedef struct {
+    UBYTE *Data;
+    UWORD Width;
+    UWORD Height;
+    UWORD WidthByte;    //Bytes per row
+} GUI_BITMAP;
+
 UBYTE GUI_ReadBmp(const char *path, UWORD Xstart, UWORD Ystart);
 UBYTE GUI_ReadBmp_4Gray(const char *path, UWORD Xstart, UWORD Ystart);
 UBYTE GUI_ReadBmp_16Gray(const char *path, UWORD Xstart, UWORD Ystart);
 UBYTE GUI_ReadBmp_RGB_4Color(const char *path, UWORD Xstart, UWORD Ystart);
 UBYTE GUI_ReadBmp_RGB_6Color(const char *path, UWORD Xstart, UWORD Ystart);
 UBYTE GUI_ReadBmp_RGB_7Color(const char *path, UWORD Xstart, UWORD Ystart);
+
+UBYTE GUI_ReadBmp_Dither(const char *path, UWORD Xstart, UWORD Ystart, DITHER_MODE Mode);
+
+UBYTE GUI_DecodeBmp(const char *path, GUI_BITMAP *Bitmap);
+void GUI_FreeBmp(GUI_BITMAP *Bitmap);
 #endif
@@ -0,0 +1,188 @@
+/*****************************************************************************
+* | File      	:   GUI_Cache.c
+* | Function    :   Cache of decoded bitmaps
+* | Info        :
+*   Entries live on a doubly linked list ordered from most to least recently
+*   used. A dashboard only draws a handful of icons, so lookups walk the list.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :
+******************************************************************************/
+#include "GUI_Cache.h"
+#include "GUI_Paint.h"
+#include "Debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct CACHE_ENTRY {
+    struct CACHE_ENTRY *Prev;
+    struct CACHE_ENTRY *Next;
+    char *Path;
+    off_t Size;
+    struct timespec Mtime;
+    GUI_BITMAP Bitmap;
+    UDOUBLE Bytes;
+} CACHE_ENTRY;
+
+static CACHE_ENTRY *Head = NULL;   //Most recently used
+static CACHE_ENTRY *Tail = NULL;   //Least recently used
+static GUI_CACHE_STATS Cache = {0, 0, 0, 0, 0, GUI_CACHE_LIMIT_DFT};
+
+static void Cache_Unlink(CACHE_ENTRY *entry)
+{
+    if(entry->Prev)
+        entry->Prev->Next = entry->Next;
+    else
+        Head = entry->Next;
+    if(entry->Next)
+        entry->Next->Prev = entry->Prev;
+    else
+        Tail = entry->Prev;
+    entry->Prev = entry->Next = NULL;
+}
+
+static void Cache_PushFront(CACHE_ENTRY *entry)
+{
+    entry->Prev = NULL;
+    entry->Next = Head;
+    if(Head)
+        Head->Prev = entry;
+    Head = entry;
+    if(Tail == NULL)
+        Tail = entry;
+}
+
+static void Cache_Drop(CACHE_ENTRY *entry)
+{
+    Cache_Unlink(entry);
+    Cache.Entries--;
+    Cache.Bytes -= entry->Bytes;
+    GUI_FreeBmp(&entry->Bitmap);
+    free(entry->Path);
+    free(entry);
+}
+
+/*Evict from the tail until Bytes more fit under the limit*/
+static void Cache_MakeRoom(UDOUBLE Bytes)
+{
+    while(Tail != NULL && Cache.Bytes + Bytes > Cache.Limit) {
+        Debug("GUI_Cache evict %s\r\n", Tail->Path);
+        Cache_Drop(Tail);
+        Cache.Evictions++;
+    }
+}
+
+/******************************************************************************
+function:	Set the most decoded pixel data the cache may hold
+parameter:
+    Bytes : Limit in bytes, 0 disables caching
+******************************************************************************/
+void GUI_Cache_SetLimit(UDOUBLE Bytes)
+{
+    Cache.Limit = Bytes;
+    Cache_MakeRoom(0);
+}
+
+/******************************************************************************
+function:	Look up a decoded bitmap, decoding and caching it on a miss
+parameter:
+    path   : BMP file path
+    Bitmap : Set to the cached bitmap on success
+info:
+    The bitmap stays valid until the next GUI_Cache_* call. A file whose size
+    or modification time changed is decoded again. Pictures bigger than the
+    whole limit are not cached and return GUI_BMP_ERR_NOMEM.
+******************************************************************************/
+UBYTE GUI_Cache_Get(const char *path, const GUI_BITMAP **Bitmap)
+{
+    CACHE_ENTRY *entry;
+    struct stat st;
+    UBYTE ret;
+
+    if(stat(path, &st) != 0) {
+        Debug("GUI_Cache cann't stat %s\r\n", path);
+        return GUI_BMP_ERR_OPEN;
+    }
+
+    for(entry = Head; entry != NULL; entry = entry->Next) {
+        if(strcmp(entry->Path, path) != 0)
+            continue;
+        if(entry->Size == st.st_size &&
+           entry->Mtime.tv_sec == st.st_mtim.tv_sec &&
+           entry->Mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            Cache_Unlink(entry);
+            Cache_PushFront(entry);
+            Cache.Hits++;
+            *Bitmap = &entry->Bitmap;
+            return GUI_BMP_OK;
+        }
+        Cache_Drop(entry); //stale
+        break;
+    }
+
+    Cache.Misses++;
+    entry = (CACHE_ENTRY *)calloc(1, sizeof(CACHE_ENTRY));
+    if(entry == NULL)
+        return GUI_BMP_ERR_NOMEM;
+    if((ret = GUI_DecodeBmp(path, &entry->Bitmap)) != GUI_BMP_OK) {
+        free(entry);
+        return ret;
+    }
+
+    entry->Bytes = (UDOUBLE)entry->Bitmap.WidthByte * entry->Bitmap.Height;
+    entry->Path = strdup(path);
+    if(entry->Path == NULL || entry->Bytes > Cache.Limit) {
+        GUI_FreeBmp(&entry->Bitmap);
+        free(entry->Path);
+        free(entry);
+        return GUI_BMP_ERR_NOMEM;
+    }
+    entry->Size = st.st_size;
+    entry->Mtime = st.st_mtim;
+
+    Cache_MakeRoom(entry->Bytes);
+    Cache_PushFront(entry);
+    Cache.Entries++;
+    Cache.Bytes += entry->Bytes;
+    *Bitmap = &entry->Bitmap;
+    return GUI_BMP_OK;
+}
+
+/******************************************************************************
+function:	Draw a monochrome BMP through the cache
+parameter:
+    path   : BMP file path
+    Xstart : X coordinate of the top left corner
+    Ystart : Y coordinate of the top left corner
+info:
+    Falls back to streaming the file with GUI_ReadBmp() when it cannot be
+    cached, so oversized pictures still draw.
+******************************************************************************/
+UBYTE GUI_DrawBmp_Cached(const char *path, UWORD Xstart, UWORD Ystart)
+{
+    const GUI_BITMAP *Bitmap;
+    UBYTE ret = GUI_Cache_Get(path, &Bitmap);
+
+    if(ret == GUI_BMP_ERR_NOMEM)
+        return GUI_ReadBmp(path, Xstart, Ystart);
+    if(ret != GUI_BMP_OK)
+        return ret;
+
+    Paint_DrawBitMap_Paste(Bitmap->Data, Xstart, Ystart, Bitmap->Width, Bitmap->Height, 0);
+    return GUI_BMP_OK;
+}
+
+void GUI_Cache_Stats(GUI_CACHE_STATS *Stats)
+{
+    *Stats = Cache;
+}
+
+void GUI_Cache_Clear(void)
+{
+    while(Head != NULL) {
+        Cache_Drop(Head);
+    }
+}
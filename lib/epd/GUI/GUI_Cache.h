@@ -0,0 +1,37 @@
+/*****************************************************************************
+* | File      	:   GUI_Cache.h
+* | Function    :   Cache of decoded bitmaps
+* | Info        :
+*   Keeps panel format copies of BMP files so pictures drawn every refresh
+*   are read and converted once. Entries are keyed by path and checked
+*   against the file's size and modification time on every lookup; the
+*   least recently used ones are dropped when the memory limit is reached.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :
+******************************************************************************/
+#ifndef __GUI_CACHE_H
+#define __GUI_CACHE_H
+
+#include "DEV_Config.h"
+#include "GUI_BMPfile.h"
+
+#define GUI_CACHE_LIMIT_DFT   (64 * 1024)   //Bytes of decoded pixels kept
+
+typedef struct {
+    UDOUBLE Hits;
+    UDOUBLE Misses;
+    UDOUBLE Evictions;
+    UDOUBLE Entries;
+    UDOUBLE Bytes;
+    UDOUBLE Limit;
+} GUI_CACHE_STATS;
+
+void GUI_Cache_SetLimit(UDOUBLE Bytes);
+UBYTE GUI_Cache_Get(const char *path, const GUI_BITMAP **Bitmap);
+UBYTE GUI_DrawBmp_Cached(const char *path, UWORD Xstart, UWORD Ystart);
+void GUI_Cache_Stats(GUI_CACHE_STATS *Stats);
+void GUI_Cache_Clear(void);
+
+#endif
@@ -0,0 +1,233 @@
+/*****************************************************************************
+* | File      	:   GUI_Dither.c
+* | Function    :   Gray to black and white conversion
+* | Info        :
+*   The threshold and ordered modes compare four pixels per 32 bit word
+*   (SWAR), which suits the ARMv6 core of the Pi Zero that has no NEON.
+*   Error diffusion is serial by nature and runs on 16 bit error rows.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :
+******************************************************************************/
+#include "GUI_Dither.h"
+#include "Debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DITHER_PAD  2   //Error row margin so kernels never test the edges
+
+#define LANE_HIGH   0x80808080u
+#define LANE_LOW7   0x7F7F7F7Fu
+
+/*Classic 8x8 Bayer index matrix, 0..63*/
+static const UBYTE Bayer8[8][8] = {
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+/*Four consecutive pixels as one word, lane 0 = leftmost, on any endianness*/
+static inline UDOUBLE Dither_Load4(const UBYTE *p)
+{
+    return (UDOUBLE)p[0] | ((UDOUBLE)p[1] << 8) | ((UDOUBLE)p[2] << 16) | ((UDOUBLE)p[3] << 24);
+}
+
+/******************************************************************************
+function:	Compare four pixels against four thresholds at once
+parameter:
+    Gray      : Four 8 bit pixels, lane 0 leftmost
+    Threshold : Four 7 bit thresholds
+return:
+    The four results in the low nibble, leftmost pixel in bit 3, 1 = white
+info:
+    Halving the pixels leaves bit 7 of every lane free, so setting it and
+    subtracting can never borrow across lanes: bit 7 survives exactly when
+    pixel/2 >= threshold. The multiply then gathers the four flags into the
+    top nibble in pixel order.
+******************************************************************************/
+static inline UBYTE Dither_Compare4(UDOUBLE Gray, UDOUBLE Threshold)
+{
+    UDOUBLE Half = (Gray >> 1) & LANE_LOW7;
+    UDOUBLE Flags = ((Half | LANE_HIGH) - Threshold) & LANE_HIGH;
+    return (UBYTE)(((Flags >> 7) * 0x80402010u) >> 28);
+}
+
+/*Threshold word of four 7 bit lanes for row Y, pixels X..X+3 (X % 4 == 0)*/
+static inline UDOUBLE Dither_BayerWord(UWORD X, UWORD Y)
+{
+    const UBYTE *m = &Bayer8[Y % 8][X % 8];
+    // Index i covers gray (2i, 2i+2], i.e. 7 bit threshold i*2 + 1
+    return (UDOUBLE)(m[0] * 2 + 1) | ((UDOUBLE)(m[1] * 2 + 1) << 8) |
+           ((UDOUBLE)(m[2] * 2 + 1) << 16) | ((UDOUBLE)(m[3] * 2 + 1) << 24);
+}
+
+static void Dither_Ordered(GUI_DITHER *Dither, const UBYTE *Gray, UBYTE *Bits)
+{
+    UWORD x, Width = Dither->Width;
+    UDOUBLE T0, T1;
+
+    if (Dither->Mode == DITHER_BAYER) {
+        T0 = Dither_BayerWord(0, Dither->Row);
+        T1 = Dither_BayerWord(4, Dither->Row);
+    } else {
+        T0 = T1 = 0x40404040u;  //128 in 7 bit lanes
+    }
+
+    for (x = 0; x + 8 <= Width; x += 8) {
+        Bits[x / 8] = (Dither_Compare4(Dither_Load4(Gray + x), T0) << 4) |
+                      Dither_Compare4(Dither_Load4(Gray + x + 4), T1);
+    }
+    if (x < Width) {
+        UBYTE Tail[8] = {0};
+        memcpy(Tail, Gray + x, Width - x);
+        Bits[x / 8] = ((Dither_Compare4(Dither_Load4(Tail), T0) << 4) |
+                       Dither_Compare4(Dither_Load4(Tail + 4), T1)) &
+                      (UBYTE)(0xFF << (8 - (Width - x)));
+    }
+}
+
+static inline int16_t Dither_Clamp(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/*Floyd-Steinberg, errors kept in 1/16 units: 7 right, 3/5/1 below*/
+static void Dither_FloydSteinberg(GUI_DITHER *Dither, const UBYTE *Gray, UBYTE *Bits)
+{
+    int16_t *Cur = Dither->Err[0] + DITHER_PAD;
+    int16_t *Next = Dither->Err[1] + DITHER_PAD;
+    UBYTE Byte = 0;
+    UWORD x;
+
+    for (x = 0; x < Dither->Width; x++) {
+        int v = Dither_Clamp(Gray[x] + ((Cur[x] + 8) >> 4));
+        int e = v >= 128 ? v - 255 : v;
+        Byte = (Byte << 1) | (v >= 128);
+        Cur[x + 1] += e * 7;
+        Next[x - 1] += e * 3;
+        Next[x] += e * 5;
+        Next[x + 1] += e;
+        if (x % 8 == 7)
+            Bits[x / 8] = Byte;
+    }
+    if (x % 8)
+        Bits[x / 8] = Byte << (8 - x % 8);
+}
+
+/*Atkinson, errors kept in 1/8 units: one part to six neighbours, 2/8 lost*/
+static void Dither_Atkinson(GUI_DITHER *Dither, const UBYTE *Gray, UBYTE *Bits)
+{
+    int16_t *Cur = Dither->Err[0] + DITHER_PAD;
+    int16_t *Next = Dither->Err[1] + DITHER_PAD;
+    int16_t *Next2 = Dither->Err[2] + DITHER_PAD;
+    UBYTE Byte = 0;
+    UWORD x;
+
+    for (x = 0; x < Dither->Width; x++) {
+        int v = Dither_Clamp(Gray[x] + ((Cur[x] + 4) >> 3));
+        int e = v >= 128 ? v - 255 : v;
+        Byte = (Byte << 1) | (v >= 128);
+        Cur[x + 1] += e;
+        Cur[x + 2] += e;
+        Next[x - 1] += e;
+        Next[x] += e;
+        Next[x + 1] += e;
+        Next2[x] += e;
+        if (x % 8 == 7)
+            Bits[x / 8] = Byte;
+    }
+    if (x % 8)
+        Bits[x / 8] = Byte << (8 - x % 8);
+}
+
+/******************************************************************************
+function:	Prepare to convert rows of the given width
+parameter:
+    Dither : State to initialize, release with GUI_Dither_End()
+    Width  : Pixels per row
+    Mode   : Conversion to apply
+return:
+    0 on success, 1 when the error rows cannot be allocated
+******************************************************************************/
+UBYTE GUI_Dither_Begin(GUI_DITHER *Dither, UWORD Width, DITHER_MODE Mode)
+{
+    UDOUBLE Span = Width + 2 * DITHER_PAD;
+
+    memset(Dither, 0, sizeof(GUI_DITHER));
+    Dither->Mode = Mode;
+    Dither->Width = Width;
+    if (Mode == DITHER_FLOYD_STEINBERG || Mode == DITHER_ATKINSON) {
+        Dither->Block = (int16_t *)calloc(3 * Span, sizeof(int16_t));
+        if (Dither->Block == NULL) {
+            Debug("dither error rows malloc failed!\n");
+            return 1;
+        }
+        Dither->Err[0] = Dither->Block;
+        Dither->Err[1] = Dither->Block + Span;
+        Dither->Err[2] = Dither->Block + 2 * Span;
+    }
+    return 0;
+}
+
+/******************************************************************************
+function:	Convert the next row
+parameter:
+    Dither : State from GUI_Dither_Begin()
+    Gray   : Width pixels, 0 = black, 255 = white
+    Bits   : (Width + 7) / 8 bytes out, MSB first, 1 = white
+info:
+    Rows must be fed top to bottom.
+******************************************************************************/
+void GUI_Dither_Row(GUI_DITHER *Dither, const UBYTE *Gray, UBYTE *Bits)
+{
+    switch (Dither->Mode) {
+    case DITHER_FLOYD_STEINBERG:
+        Dither_FloydSteinberg(Dither, Gray, Bits);
+        break;
+    case DITHER_ATKINSON:
+        Dither_Atkinson(Dither, Gray, Bits);
+        break;
+    default:
+        Dither_Ordered(Dither, Gray, Bits);
+        break;
+    }
+
+    if (Dither->Block != NULL) {
+        // The row below becomes current, the spent row is recycled at the bottom
+        int16_t *Spent = Dither->Err[0];
+        Dither->Err[0] = Dither->Err[1];
+        Dither->Err[1] = Dither->Err[2];
+        Dither->Err[2] = Spent;
+        memset(Spent, 0, (Dither->Width + 2 * DITHER_PAD) * sizeof(int16_t));
+    }
+    Dither->Row++;
+}
+
+void GUI_Dither_End(GUI_DITHER *Dither)
+{
+    free(Dither->Block);
+    memset(Dither, 0, sizeof(GUI_DITHER));
+}
+
+/******************************************************************************
+function:	Convert a row of 24 bit pixels to gray
+parameter:
+    BGR   : Width pixels in BMP byte order
+    Gray  : Width bytes out
+info:
+    Rec.601 luma with 8 bit weights (77, 150, 29).
+******************************************************************************/
+void GUI_Dither_BGRToGray(const UBYTE *BGR, UBYTE *Gray, UWORD Width)
+{
+    UWORD x;
+    for (x = 0; x < Width; x++, BGR += 3) {
+        Gray[x] = (BGR[0] * 29 + BGR[1] * 150 + BGR[2] * 77) >> 8;
+    }
+}
@@ -0,0 +1,40 @@
+/*****************************************************************************
+* | File      	:   GUI_Dither.h
+* | Function    :   Gray to black and white conversion
+* | Info        :
+*   Turns 8 bit gray (or 24 bit BGR via GUI_Dither_BGRToGray) into panel
+*   bits one row at a time. Only integer arithmetic is used, and state is
+*   limited to three rows of error terms, so pictures of any height stream
+*   through in constant memory.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :
+******************************************************************************/
+#ifndef __GUI_DITHER_H
+#define __GUI_DITHER_H
+
+#include "DEV_Config.h"
+
+typedef enum {
+    DITHER_THRESHOLD = 0,       //Plain 50% cut, for line art
+    DITHER_BAYER,               //8x8 ordered, stable between refreshes
+    DITHER_FLOYD_STEINBERG,     //Error diffusion, smoothest gradients
+    DITHER_ATKINSON,            //Error diffusion keeping 6/8, higher contrast
+} DITHER_MODE;
+#define DITHER_MODE_DFT  DITHER_BAYER
+
+typedef struct {
+    DITHER_MODE Mode;
+    UWORD Width;
+    UWORD Row;                  //Rows converted so far
+    int16_t *Err[3];            //Current row and the two below, scaled errors
+    int16_t *Block;             //Backing memory of Err
+} GUI_DITHER;
+
+UBYTE GUI_Dither_Begin(GUI_DITHER *Dither, UWORD Width, DITHER_MODE Mode);
+void GUI_Dither_Row(GUI_DITHER *Dither, const UBYTE *Gray, UBYTE *Bits);
+void GUI_Dither_End(GUI_DITHER *Dither);
+void GUI_Dither_BGRToGray(const UBYTE *BGR, UBYTE *Gray, UWORD Width);
+
+#endif
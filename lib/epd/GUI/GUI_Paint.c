@@ -109,6 +109,7 @@ void Paint_NewImage(UBYTE *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD
    
     Paint.Rotate = Rotate;
     Paint.Mirror = MIRROR_NONE;
+    Paint.Layout = PAINT_LAYOUT_ROWS;
     
     if(Rotate == ROTATE_0 || Rotate == ROTATE_180) {
         Paint.Width = Width;
@@ -168,17 +169,37 @@ void Paint_SetScale(UBYTE scale)
         Paint.WidthByte = (Paint.WidthMemory % 8 == 0)? (Paint.WidthMemory / 8 ): (Paint.WidthMemory / 8 + 1);
     }else if(scale == 4){
         Paint.Scale = scale;
+        Paint.Layout = PAINT_LAYOUT_ROWS;
         Paint.WidthByte = (Paint.WidthMemory % 4 == 0)? (Paint.WidthMemory / 4 ): (Paint.WidthMemory / 4 + 1);
     }else if(scale == 6 || scale == 7 || scale == 16){
         /* 7 colours are only applicable with 5in65 e-Paper */
         /* 16 colours are used for dithering */
 		Paint.Scale = scale;
+		Paint.Layout = PAINT_LAYOUT_ROWS;
 		Paint.WidthByte = (Paint.WidthMemory % 2 == 0)? (Paint.WidthMemory / 2 ): (Paint.WidthMemory / 2 + 1);;
 	}else{
         Debug("Set Scale Input parameter error\r\n");
         Debug("Scale Only support: 2 4 7 16\r\n");
     }
 }
+/******************************************************************************
+function:	Select the memory layout
+parameter:
+    layout : PAINT_LAYOUT_ROWS or PAINT_LAYOUT_PAGES
+info:
+    Pages are for 2 color images only. The image keeps its size, so
+    Paint_Clear works in both layouts; Paint_DrawBitMap copies memory as
+    it is and needs a bitmap in the same layout.
+******************************************************************************/
+void Paint_SetLayout(UBYTE layout)
+{
+    if(layout == PAINT_LAYOUT_ROWS || (layout == PAINT_LAYOUT_PAGES && Paint.Scale == 2)) {
+        Paint.Layout = layout;
+    } else {
+        Debug("Set Layout: pages need scale 2\r\n");
+    }
+}
+
 /******************************************************************************
 function: Draw Pixels
 parameter:
@@ -238,6 +259,11 @@ void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
     
     if(Paint.Scale == 2){
         UDOUBLE Addr = X / 8 + Y * Paint.WidthByte;
+        if(Paint.Layout == PAINT_LAYOUT_PAGES) {
+            if(X >= Paint.WidthMemory || Y >= Paint.HeightMemory)
+                return;
+            Addr = (UDOUBLE)(X / 8) * Paint.HeightMemory + Y;
+        }
         UBYTE Rdata = Paint.Image[Addr];
         if(Color == BLACK)
             Paint.Image[Addr] = Rdata & ~(0x80 >> (X % 8));
@@ -505,6 +531,45 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
     }
 }
 
+/******************************************************************************
+function: Draw a glyph fully inside a rotated page layout image
+parameter:
+    Glyph : Font rows of the character
+info:
+    Under ROTATE_90 a glyph row lands on one bit of consecutive bytes of
+    one page, so each row is written byte after byte with a fixed mask and
+    no pixel goes through the rotation in Paint_SetPixel().
+******************************************************************************/
+static void Paint_DrawChar_Pages(UWORD Xpoint, UWORD Ypoint, const unsigned char *Glyph,
+                                 sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    UWORD Stride = Font->Width / 8 + (Font->Width % 8 ? 1 : 0);
+    UBYTE Opaque = FONT_BACKGROUND != Color_Background;
+    UBYTE FgSet = Color_Foreground != BLACK;
+    UBYTE BgSet = Color_Background != BLACK;
+
+    for (UWORD Page = 0; Page < Font->Height; Page++, Glyph += Stride) {
+        UWORD X = Paint.WidthMemory - (Ypoint + Page) - 1;
+        UBYTE Mask = 0x80 >> (X % 8);
+        UBYTE *Dst = Paint.Image + (UDOUBLE)(X / 8) * Paint.HeightMemory + Xpoint;
+        for (UWORD Column = 0; Column < Font->Width; Column++) {
+            UBYTE Bits = Glyph[Column / 8];
+            if (!Opaque && Bits == 0) {
+                Column |= 7; // nothing to draw in this glyph byte
+                continue;
+            }
+            UBYTE Set;
+            if (Bits & (0x80 >> (Column % 8)))
+                Set = FgSet;
+            else if (Opaque)
+                Set = BgSet;
+            else
+                continue;
+            Dst[Column] = Set ? (Dst[Column] | Mask) : (Dst[Column] & ~Mask);
+        }
+    }
+}
+
 /******************************************************************************
 function: Show English characters
 parameter:
@@ -528,6 +593,13 @@ void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
     uint32_t Char_Offset = (Acsii_Char - ' ') * Font->Height * (Font->Width / 8 + (Font->Width % 8 ? 1 : 0));
     const unsigned char *ptr = &Font->table[Char_Offset];
 
+    if (Paint.Scale == 2 && Paint.Layout == PAINT_LAYOUT_PAGES &&
+        Paint.Rotate == ROTATE_90 && Paint.Mirror == MIRROR_NONE &&
+        Xpoint + Font->Width <= Paint.Width && Ypoint + Font->Height <= Paint.Height) {
+        Paint_DrawChar_Pages(Xpoint, Ypoint, ptr, Font, Color_Foreground, Color_Background);
+        return;
+    }
+
     for (Page = 0; Page < Font->Height; Page ++ ) {
         for (Column = 0; Column < Font->Width; Column ++ ) {
 
@@ -845,3 +917,63 @@ void Paint_DrawBitMap(const unsigned char* image_buffer)
         }
     }
 }
+
+/******************************************************************************
+function:	Paste a monochrome bitmap at a position
+parameter:
+    image_buffer ：1 bit per pixel, MSB first, 1 = white, rows padded to a byte
+    Xstart       ：X coordinate of the top left corner
+    Ystart       ：Y coordinate of the top left corner
+    imageWidth   ：Width of the bitmap in pixels
+    imageHeight  ：Height of the bitmap in pixels
+    flipColor    ：Non zero inverts the bitmap while pasting
+info:
+    Anything outside the image is clipped. Without rotation or mirroring on a
+    2 color image in rows the bits are shifted into place a byte at a time,
+    otherwise every pixel goes through Paint_SetPixel().
+******************************************************************************/
+void Paint_DrawBitMap_Paste(const unsigned char* image_buffer, UWORD Xstart, UWORD Ystart,
+                            UWORD imageWidth, UWORD imageHeight, UBYTE flipColor)
+{
+    UWORD x, y;
+    UWORD SrcWidthByte = (imageWidth % 8 == 0)? (imageWidth / 8): (imageWidth / 8 + 1);
+    UBYTE Flip = flipColor ? 0xFF : 0x00;
+
+    if (Xstart >= Paint.Width || Ystart >= Paint.Height) {
+        Debug("Paint_DrawBitMap_Paste Input exceeds the normal display range\r\n");
+        return;
+    }
+    if (imageWidth > Paint.Width - Xstart)
+        imageWidth = Paint.Width - Xstart;
+    if (imageHeight > Paint.Height - Ystart)
+        imageHeight = Paint.Height - Ystart;
+
+    if (Paint.Scale == 2 && Paint.Layout == PAINT_LAYOUT_ROWS &&
+        Paint.Rotate == ROTATE_0 && Paint.Mirror == MIRROR_NONE) {
+        UWORD Bytes = (imageWidth % 8 == 0)? (imageWidth / 8): (imageWidth / 8 + 1);
+        UBYTE Shift = Xstart % 8;
+        UBYTE Tail = (imageWidth % 8 == 0)? 0xFF: (UBYTE)(0xFF << (8 - imageWidth % 8));
+
+        for (y = 0; y < imageHeight; y++) {
+            const UBYTE *src = image_buffer + (UDOUBLE)y * SrcWidthByte;
+            UBYTE *dst = Paint.Image + (UDOUBLE)(Ystart + y) * Paint.WidthByte + Xstart / 8;
+            for (x = 0; x < Bytes; x++) {
+                UBYTE Valid = (x == Bytes - 1)? Tail: 0xFF;
+                UWORD Bits = (UWORD)((src[x] ^ Flip) & Valid) << (8 - Shift);
+                UWORD Mask = (UWORD)Valid << (8 - Shift);
+                dst[x] = (dst[x] & ~(Mask >> 8)) | (Bits >> 8);
+                if (Mask & 0xFF)
+                    dst[x + 1] = (dst[x + 1] & ~Mask) | (Bits & 0xFF);
+            }
+        }
+        return;
+    }
+
+    for (y = 0; y < imageHeight; y++) {
+        const UBYTE *src = image_buffer + (UDOUBLE)y * SrcWidthByte;
+        for (x = 0; x < imageWidth; x++) {
+            UBYTE Bit = (src[x / 8] ^ Flip) & (0x80 >> (x % 8));
+            Paint_SetPixel(Xstart + x, Ystart + y, Bit ? WHITE : BLACK);
+        }
+    }
+}
@@ -88,6 +88,7 @@ typedef struct {
     UWORD WidthByte;
     UWORD HeightByte;
     UWORD Scale;
+    UWORD Layout;
 } PAINT;
 extern PAINT Paint;
 
@@ -99,6 +100,17 @@ extern PAINT Paint;
 #define ROTATE_180          180
 #define ROTATE_270          270
 
+/**
+ * Memory layout of a 2 color image
+ * ROWS : HeightMemory rows of WidthByte bytes
+ * PAGES: WidthByte pages of HeightMemory bytes, page p holding columns
+ *        8p to 8p+7 of every row, the order the SSD1680 takes its RAM in
+ *        with data entry mode 0x07. Under ROTATE_90 a row of the rotated
+ *        image is a run of consecutive bytes.
+**/
+#define PAINT_LAYOUT_ROWS   0
+#define PAINT_LAYOUT_PAGES  1
+
 /**
  * Display Flip
 **/
@@ -187,6 +199,7 @@ void Paint_SetRotate(UWORD Rotate);
 void Paint_SetMirroring(UBYTE mirror);
 void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color);
 void Paint_SetScale(UBYTE scale);
+void Paint_SetLayout(UBYTE layout);
 
 void Paint_Clear(UWORD Color);
 void Paint_ClearWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
@@ -207,6 +220,7 @@ void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
 
 //pic
 void Paint_DrawBitMap(const unsigned char* image_buffer);
+void Paint_DrawBitMap_Paste(const unsigned char* image_buffer, UWORD Xstart, UWORD Ystart, UWORD imageWidth, UWORD imageHeight, UBYTE flipColor);
 
 
 #endif
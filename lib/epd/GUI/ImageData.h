@@ -31,6 +31,11 @@
 
 #ifndef _IMAGEDATA_H_
 #define _IMAGEDATA_H_
+/*
+ * ImageData.c and ImageData2.c are not built into libscreen.a. `make assets`
+ * packs these arrays into assets.pak; open it with GUI_AssetPack_Open() and
+ * look images up by the names below, e.g. GUI_AssetPack_Find(&Pack, "gImage_2in13", NULL).
+ */
 // ImageData2
 extern const unsigned char gImage_2in13b_V4b[];
 extern const unsigned char gImage_2in13b_V4r[];
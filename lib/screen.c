@@ -1,8 +1,10 @@
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "Config/DEV_Config.h"
 #include "Debug.h"
@@ -18,8 +20,466 @@
 #define TOP_MARGIN 2
 #define BOTTOM_MARGIN 3
 
-static UBYTE *BlackImage = NULL;
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+#define MINUTES_PER_DAY (24 * 60)
+
+// One panel: the lines the EPD driver reaches it through, its framebuffer
+// and its state. Panel 0 is the one screen_paint and screen_push_* draw on.
+//
+// shown is what the panel currently shows, so an identical frame is never
+// sent twice. input_hash covers the lines and font that produced it, which
+// lets a repeated screen_paint skip rasterizing as well; pushed frames have
+// no input hash. pending is set while the framebuffer holds a frame quiet
+// hours held back, with the input hash it would be shown with.
+struct panel {
+  EPD_2in13_V4_PANEL dev;
+  UBYTE *image;
+  UBYTE layout; // of image, EPD_2in13_V4_LAYOUT_*
+  bool asleep;
+  struct {
+    bool valid;
+    uint64_t frame_hash;
+    bool input_valid;
+    uint64_t input_hash;
+  } shown;
+  struct {
+    bool set;
+    bool input_valid;
+    uint64_t input_hash;
+  } pending;
+};
+
+static struct panel panels[SCREEN_MAX_PANELS];
+static int panel_count = 1;
+static struct panel *const main_panel = &panels[0];
+
 static bool screen_on = false;
+static const EPD_2in13_V4_TIMING *timing = &EPD_2in13_V4_Timing_Waveshare;
+static int paint_layout = SCREEN_LAYOUT_ROWS;
+
+// Deep sleep between refreshes. mark is when the first panel last went to
+// sleep or woke up, so the time since then can be added to the right total.
+static struct {
+  bool enabled;
+  uint64_t mark;
+} power = {.enabled = true};
+
+// Quiet hours in minutes after local midnight; start == end disables them.
+static struct {
+  int start;
+  int end;
+} quiet;
+
+static screen_stats stats;
+
+// Phase marks of the paint or push in progress. Time spent waking the panel
+// on the way is taken out of the layout phase, since wake_us reports it.
+static struct {
+  uint64_t start;
+  uint64_t layout_done;
+  uint64_t wake_total_us;
+  uint64_t wake_mark;
+} phase;
+
+static void phase_begin(void) {
+  phase.start = DEV_Time_us();
+  phase.layout_done = phase.start;
+  phase.wake_mark = phase.wake_total_us;
+}
+
+static void phase_layout_done(void) { phase.layout_done = DEV_Time_us(); }
+
+// Closes the current asleep or awake interval of the first panel at now.
+static void power_account(uint64_t now) {
+  if (main_panel->asleep) {
+    stats.asleep_us += now - power.mark;
+  } else {
+    stats.awake_us += now - power.mark;
+  }
+  power.mark = now;
+}
+
+// Power accounting covers the first panel only, so panel_sleep and
+// panel_wake on other panels may run on other threads.
+static void panel_sleep(struct panel *p) {
+  EPD_2in13_V4_Select(&p->dev);
+  EPD_2in13_V4_Sleep();
+  if (p == main_panel) {
+    power_account(DEV_Time_us());
+  }
+  p->asleep = true;
+}
+
+// Wakes the controller if it is in deep sleep and returns how long it took.
+// A partial refresh starts with a hardware reset and writes the registers
+// Init_Wake would, so for one the panel is only marked awake and that reset
+// does the waking.
+static uint64_t panel_wake(struct panel *p, bool full) {
+  if (!p->asleep) {
+    return 0;
+  }
+  uint64_t start = DEV_Time_us();
+  if (p == main_panel) {
+    power_account(start);
+  }
+  if (full) {
+    EPD_2in13_V4_Select(&p->dev);
+    EPD_2in13_V4_Init_Wake();
+  }
+  p->asleep = false;
+  return DEV_Time_us() - start;
+}
+
+// One panel's share of a refresh, filled in by prepare_refresh and
+// run_refresh.
+struct refresh {
+  struct panel *panel;
+  bool full;
+  bool sleep; // deep sleep afterwards
+  uint64_t hash;
+  bool input_valid;
+  uint64_t input_hash;
+  pthread_t thread;
+  bool threaded;
+  uint64_t start;
+  bool resumed; // the panel was in deep sleep
+  uint64_t resume_us;
+  uint64_t upload_us;
+  uint64_t busy_us;
+  bool failed; // a BUSY wait gave up, so the panel content is unknown
+};
+
+static void *run_refresh(void *arg) {
+  struct refresh *r = arg;
+  struct panel *p = r->panel;
+  r->start = DEV_Time_us();
+  p->dev.BusyFailed = 0;
+  r->resumed = p->asleep;
+  r->resume_us = panel_wake(p, r->full);
+  uint64_t upload_start = DEV_Time_us();
+  uint64_t busy_before = p->dev.BusyUs;
+  EPD_2in13_V4_Select(&p->dev);
+  if (r->full) {
+    EPD_2in13_V4_Display_Base_Layout(p->image, p->layout);
+  } else {
+    EPD_2in13_V4_Display_Partial_Layout(p->image, p->layout);
+  }
+  r->busy_us = p->dev.BusyUs - busy_before;
+  r->upload_us = DEV_Time_us() - upload_start - r->busy_us;
+  r->failed = p->dev.BusyFailed;
+  if (r->sleep) {
+    panel_sleep(p);
+  }
+  return NULL;
+}
+
+// Refreshes the panels of jobs at once, the first on the calling thread and
+// each other one on its own: their SPI frames take turns on the shared bus
+// while the refreshes and BUSY waits overlap. The first panel, when in jobs,
+// must come first so its power accounting stays on the calling thread.
+static void run_refreshes(struct refresh *jobs, int n) {
+  for (int i = 1; i < n; ++i) {
+    jobs[i].threaded =
+        pthread_create(&jobs[i].thread, NULL, run_refresh, &jobs[i]) == 0;
+  }
+  if (n > 0) {
+    run_refresh(&jobs[0]);
+  }
+  for (int i = 1; i < n; ++i) {
+    if (jobs[i].threaded) {
+      pthread_join(jobs[i].thread, NULL);
+    } else {
+      run_refresh(&jobs[i]);
+    }
+  }
+  for (int i = 0; i < n; ++i) {
+    if (jobs[i].resumed) {
+      stats.resumes++;
+      stats.resume_total_us += jobs[i].resume_us;
+    }
+  }
+}
+
+static bool in_quiet_hours(void) {
+  if (quiet.start == quiet.end) {
+    return false;
+  }
+  time_t now = time(NULL);
+  struct tm local;
+  if (!localtime_r(&now, &local)) {
+    return false;
+  }
+  int minute = local.tm_hour * 60 + local.tm_min;
+  if (quiet.start < quiet.end) {
+    return minute >= quiet.start && minute < quiet.end;
+  }
+  return minute >= quiet.start || minute < quiet.end;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+  const uint8_t *p = data;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= p[i];
+    hash *= FNV64_PRIME;
+  }
+  return hash;
+}
+
+// The layout is hashed too, so the same bytes in the other layout never pass
+// for the frame on the panel.
+static uint64_t hash_frame(const struct panel *p) {
+  uint64_t hash = fnv1a(FNV64_OFFSET, &p->layout, sizeof(p->layout));
+  return fnv1a(hash, p->image, SCREEN_FRAME_BYTES);
+}
+
+// Copies a frame in pages to dst in rows. A page byte holds the same 8
+// columns of one row as the row byte does, so this is a byte transpose.
+static void pages_to_rows(const UBYTE *pages, UBYTE *rows) {
+  for (int page = 0; page < SCREEN_FRAME_ROW_BYTES; ++page) {
+    const UBYTE *src = pages + page * SCREEN_FRAME_ROWS;
+    for (int row = 0; row < SCREEN_FRAME_ROWS; ++row) {
+      rows[row * SCREEN_FRAME_ROW_BYTES + page] = src[row];
+    }
+  }
+}
+
+// Turns p's framebuffer from pages into rows.
+static void frame_to_rows(struct panel *p) {
+  if (p->layout == EPD_2in13_V4_LAYOUT_ROWS) {
+    return;
+  }
+  UBYTE rows[SCREEN_FRAME_BYTES];
+  pages_to_rows(p->image, rows);
+  memcpy(p->image, rows, SCREEN_FRAME_BYTES);
+  p->layout = EPD_2in13_V4_LAYOUT_ROWS;
+}
+
+// Frame history: the frames sent to the panels, oldest first, in a ring of
+// entries. The newest frame of each panel is kept whole in last; every older
+// entry holds its frame as the XOR with the next newer frame of the same
+// panel, run-length encoded. Consecutive frames mostly agree, so the XOR is
+// mostly zero bytes, and since the chains run backwards from the newest
+// frame, dropping the oldest entry never breaks one. Guarded by lock, so the
+// history may be read while another thread paints.
+//
+// Delta encoding: a control byte c below 0x80 is followed by c + 1 literal
+// bytes; c from 0x80 stands for (c & 0x7F) + 1 zero bytes.
+#define HISTORY_RUN 128
+#define HISTORY_DELTA_MAX (SCREEN_FRAME_BYTES + SCREEN_FRAME_BYTES / 64 + 2)
+
+struct history_entry {
+  screen_history_entry info;
+  uint8_t *delta; // NULL for the newest entry of its panel, or when lost
+  bool lost;      // the delta could not be stored
+};
+
+static struct {
+  pthread_mutex_t lock;
+  struct history_entry ring[SCREEN_HISTORY_MAX_ENTRIES];
+  int head; // oldest entry
+  int count;
+  int max_entries;
+  size_t max_bytes;
+  size_t bytes; // held in deltas
+  uint8_t *last[SCREEN_MAX_PANELS];
+  struct history_entry *newest[SCREEN_MAX_PANELS];
+} history = {.lock = PTHREAD_MUTEX_INITIALIZER,
+             .max_entries = SCREEN_HISTORY_ENTRIES,
+             .max_bytes = SCREEN_HISTORY_BYTES};
+
+static struct history_entry *history_at(int i) {
+  return &history.ring[(history.head + i) % SCREEN_HISTORY_MAX_ENTRIES];
+}
+
+static size_t delta_encode(const uint8_t *a, const uint8_t *b, uint8_t *out) {
+  size_t n = 0;
+  int i = 0;
+  while (i < SCREEN_FRAME_BYTES) {
+    int run = 0;
+    while (i + run < SCREEN_FRAME_BYTES && run < HISTORY_RUN &&
+           a[i + run] == b[i + run]) {
+      run++;
+    }
+    if (run > 0) {
+      out[n++] = (uint8_t)(0x80 | (run - 1));
+      i += run;
+      continue;
+    }
+    // Literals run until two zero bytes in a row, which are cheaper as a run
+    size_t control = n++;
+    while (i + run < SCREEN_FRAME_BYTES && run < HISTORY_RUN &&
+           !(i + run + 1 < SCREEN_FRAME_BYTES && a[i + run] == b[i + run] &&
+             a[i + run + 1] == b[i + run + 1])) {
+      out[n++] = a[i + run] ^ b[i + run];
+      run++;
+    }
+    out[control] = (uint8_t)(run - 1);
+    i += run;
+  }
+  return n;
+}
+
+static void delta_apply(uint8_t *frame, const uint8_t *delta, size_t len) {
+  size_t n = 0;
+  int i = 0;
+  while (n < len && i < SCREEN_FRAME_BYTES) {
+    uint8_t c = delta[n++];
+    int run = (c & 0x7F) + 1;
+    if (c & 0x80) {
+      i += run;
+      continue;
+    }
+    for (int k = 0; k < run && i < SCREEN_FRAME_BYTES; ++k) {
+      frame[i++] ^= delta[n++];
+    }
+  }
+}
+
+static void history_drop_oldest(void) {
+  struct history_entry *e = history_at(0);
+  for (int p = 0; p < SCREEN_MAX_PANELS; ++p) {
+    if (history.newest[p] == e) {
+      history.newest[p] = NULL;
+    }
+  }
+  history.bytes -= e->info.size;
+  free(e->delta);
+  *e = (struct history_entry){0};
+  history.head = (history.head + 1) % SCREEN_HISTORY_MAX_ENTRIES;
+  history.count--;
+}
+
+static void history_trim(void) {
+  while (history.count > history.max_entries ||
+         (history.count > 1 && history.bytes > history.max_bytes)) {
+    history_drop_oldest();
+  }
+}
+
+// Appends the frame sent to panel index (in rows) to the history.
+static void history_record(int index, const uint8_t *frame,
+                           const screen_history_entry *info) {
+  pthread_mutex_lock(&history.lock);
+  if (history.max_entries == 0) {
+    pthread_mutex_unlock(&history.lock);
+    return;
+  }
+  if (!history.last[index]) {
+    history.last[index] = malloc(SCREEN_FRAME_BYTES);
+    if (!history.last[index]) {
+      pthread_mutex_unlock(&history.lock);
+      return;
+    }
+  } else if (history.newest[index]) {
+    struct history_entry *prev = history.newest[index];
+    uint8_t delta[HISTORY_DELTA_MAX];
+    size_t len = delta_encode(history.last[index], frame, delta);
+    prev->delta = malloc(len);
+    if (prev->delta) {
+      memcpy(prev->delta, delta, len);
+      prev->info.size = (uint32_t)len;
+      history.bytes += len;
+    } else {
+      prev->lost = true;
+    }
+  }
+  memcpy(history.last[index], frame, SCREEN_FRAME_BYTES);
+
+  if (history.count == SCREEN_HISTORY_MAX_ENTRIES) {
+    history_drop_oldest();
+  }
+  struct history_entry *e = history_at(history.count++);
+  *e = (struct history_entry){.info = *info};
+  history.newest[index] = e;
+  history_trim();
+  pthread_mutex_unlock(&history.lock);
+}
+
+void screen_set_history(int max_entries, size_t max_bytes) {
+  if (max_entries < 0) {
+    max_entries = 0;
+  }
+  if (max_entries > SCREEN_HISTORY_MAX_ENTRIES) {
+    max_entries = SCREEN_HISTORY_MAX_ENTRIES;
+  }
+  pthread_mutex_lock(&history.lock);
+  history.max_entries = max_entries;
+  history.max_bytes = max_bytes;
+  history_trim();
+  if (max_entries == 0) {
+    for (int p = 0; p < SCREEN_MAX_PANELS; ++p) {
+      free(history.last[p]);
+      history.last[p] = NULL;
+    }
+  }
+  pthread_mutex_unlock(&history.lock);
+}
+
+int screen_history(screen_history_entry *out, int max) {
+  pthread_mutex_lock(&history.lock);
+  int n = history.count < max ? history.count : max;
+  for (int i = 0; i < n; ++i) {
+    out[i] = history_at(history.count - n + i)->info;
+  }
+  pthread_mutex_unlock(&history.lock);
+  return n < 0 ? 0 : n;
+}
+
+bool screen_history_frame(uint64_t seq, screen_history_entry *info,
+                          uint8_t *frame) {
+  pthread_mutex_lock(&history.lock);
+  int found = -1;
+  for (int i = 0; i < history.count; ++i) {
+    if (history_at(i)->info.seq == seq) {
+      found = i;
+      break;
+    }
+  }
+  bool ok = found >= 0;
+  if (ok) {
+    uint32_t panel = history_at(found)->info.panel;
+    *info = history_at(found)->info;
+    memcpy(frame, history.last[panel], SCREEN_FRAME_BYTES);
+    // XOR is commutative, so the deltas may be undone in any order
+    for (int i = found; i < history.count && ok; ++i) {
+      const struct history_entry *e = history_at(i);
+      if (e->info.panel != panel || e == history.newest[panel]) {
+        continue;
+      }
+      ok = !e->lost;
+      if (ok) {
+        delta_apply(frame, e->delta, e->info.size);
+      }
+    }
+  }
+  pthread_mutex_unlock(&history.lock);
+  return ok;
+}
+
+bool screen_current_frame(int panel, uint8_t *frame) {
+  if (panel < 0 || panel >= SCREEN_MAX_PANELS) {
+    return false;
+  }
+  pthread_mutex_lock(&history.lock);
+  bool ok = history.last[panel] != NULL;
+  if (ok) {
+    memcpy(frame, history.last[panel], SCREEN_FRAME_BYTES);
+  }
+  pthread_mutex_unlock(&history.lock);
+  return ok;
+}
+
+static uint64_t hash_lines_begin(const sFONT *font, int line_count) {
+  uint64_t hash = fnv1a(FNV64_OFFSET, &font->Height, sizeof(font->Height));
+  return fnv1a(hash, &line_count, sizeof(line_count));
+}
+
+static uint64_t hash_line(uint64_t hash, const char *text, size_t len) {
+  hash = fnv1a(hash, &len, sizeof(len));
+  return fnv1a(hash, text, len);
+}
 
 static const sFONT *choose_font(int requested_height) {
   const sFONT *fonts[] = {&Font20, &Font16, &Font12, &Font8};
@@ -38,77 +498,190 @@ static const sFONT *choose_font(int requested_height) {
   return best;
 }
 
+_Static_assert(SCREEN_FRAME_COLUMNS == SCREEN_WIDTH &&
+                   SCREEN_FRAME_ROWS == SCREEN_HEIGHT,
+               "screen.h frame geometry must match the panel");
+
 static bool init_framebuffer(void) {
-  if (BlackImage) {
+  if (main_panel->image) {
     return true;
   }
 
-  UWORD image_size =
-      ((SCREEN_WIDTH % 8 == 0) ? (SCREEN_WIDTH / 8)
-                               : (SCREEN_WIDTH / 8 + 1)) *
-      SCREEN_HEIGHT;
-
-  BlackImage = (UBYTE *)malloc(image_size);
-  if (!BlackImage) {
+  main_panel->image = (UBYTE *)malloc(SCREEN_FRAME_BYTES);
+  if (!main_panel->image) {
     Debug("Failed to allocate framebuffer\n");
     return false;
   }
 
-  Paint_NewImage(BlackImage, SCREEN_WIDTH, SCREEN_HEIGHT, ROTATE_90, WHITE);
-  Paint_SelectImage(BlackImage);
+  main_panel->layout = EPD_2in13_V4_LAYOUT_ROWS;
+  Paint_NewImage(main_panel->image, SCREEN_WIDTH, SCREEN_HEIGHT, ROTATE_90,
+                 WHITE);
+  Paint_SelectImage(main_panel->image);
   Paint_Clear(WHITE);
   return true;
 }
 
-bool screen_turn_on(void) {
+// Brings the panel up. The normal path checks the environment, clears the
+// panel and lets it sleep until the first frame; the fast one skips all
+// three and leaves the panel content unknown, so the first frame goes out as
+// a full refresh.
+static bool power_up(bool fast) {
   if (screen_on) {
     return true;
   }
 
-  if (DEV_Module_Init() != 0) {
+  uint64_t start = DEV_Time_us();
+  if ((fast ? DEV_Module_Init_Fast() : DEV_Module_Init()) != 0) {
     fprintf(stderr, "Failed to initialize device module\n");
     return false;
   }
 
+  main_panel->dev = (EPD_2in13_V4_PANEL){.RstPin = EPD_RST_PIN,
+                                         .DcPin = EPD_DC_PIN,
+                                         .CsPin = EPD_CS_PIN,
+                                         .BusyPin = EPD_BUSY_PIN,
+                                         .Timing = timing};
+  EPD_2in13_V4_Select(&main_panel->dev);
   EPD_2in13_V4_Init_Fast();
-  EPD_2in13_V4_Clear();
+  if (!fast) {
+    EPD_2in13_V4_Clear();
+  }
+  if (main_panel->dev.BusyFailed) {
+    fprintf(stderr, "Panel does not respond\n");
+    DEV_Module_Exit();
+    return false;
+  }
+  main_panel->asleep = false;
+  power.mark = start;
 
   if (!init_framebuffer()) {
     DEV_Module_Exit();
     return false;
   }
 
+  // After a clear the panel shows the blank framebuffer
+  main_panel->shown.valid = !fast;
+  main_panel->shown.frame_hash = hash_frame(main_panel);
+  main_panel->shown.input_valid = false;
+  main_panel->pending.set = false;
+  if (!fast && power.enabled) {
+    panel_sleep(main_panel);
+  }
+
+  uint64_t elapsed = DEV_Time_us() - start;
+  stats.wake_us = (uint32_t)elapsed;
+  phase.wake_total_us += elapsed;
   screen_on = true;
   return true;
 }
 
+bool screen_turn_on(void) { return power_up(false); }
+
+bool screen_start(void) { return power_up(true); }
+
 void screen_turn_off(void) {
   if (!screen_on) {
     return;
   }
 
-  if (BlackImage) {
-    Paint_SelectImage(BlackImage);
-    Paint_Clear(WHITE);
-    EPD_2in13_V4_Display_Base(BlackImage);
-    EPD_2in13_V4_Sleep();
-    free(BlackImage);
-    BlackImage = NULL;
+  uint64_t start = DEV_Time_us();
+  // Every panel is cleared and put to sleep at once
+  struct refresh jobs[SCREEN_MAX_PANELS];
+  int n = 0;
+  for (int i = 0; i < panel_count; ++i) {
+    struct panel *p = &panels[i];
+    if (p->image) {
+      memset(p->image, 0xFF, SCREEN_FRAME_BYTES);
+      jobs[n++] = (struct refresh){.panel = p, .full = true, .sleep = true};
+    }
   }
+  run_refreshes(jobs, n);
+  power_account(DEV_Time_us());
 
   DEV_Module_Exit();
+  for (int i = 0; i < panel_count; ++i) {
+    struct panel *p = &panels[i];
+    free(p->image);
+    p->image = NULL;
+    p->asleep = false;
+    p->shown.valid = false;
+    p->shown.input_valid = false;
+    p->pending.set = false;
+  }
+  panel_count = 1;
+  stats.sleep_us = (uint32_t)(DEV_Time_us() - start);
   screen_on = false;
 }
 
+uint64_t screen_skipped_refreshes(void) { return stats.skipped; }
+
+void screen_set_auto_sleep(bool on) { power.enabled = on; }
+
+static const EPD_2in13_V4_TIMING *timing_profile(int profile) {
+  switch (profile) {
+  case SCREEN_TIMING_WAVESHARE:
+    return &EPD_2in13_V4_Timing_Waveshare;
+  case SCREEN_TIMING_DATASHEET:
+    return &EPD_2in13_V4_Timing_Datasheet;
+  }
+  fprintf(stderr, "timing: unknown profile %d\n", profile);
+  return NULL;
+}
+
+bool screen_set_timing(int profile) {
+  const EPD_2in13_V4_TIMING *t = timing_profile(profile);
+  if (!t) {
+    return false;
+  }
+  timing = t;
+  main_panel->dev.Timing = t;
+  return true;
+}
+
+bool screen_set_paint_layout(int layout) {
+  if (layout != SCREEN_LAYOUT_ROWS && layout != SCREEN_LAYOUT_PAGES) {
+    fprintf(stderr, "layout: unknown layout %d\n", layout);
+    return false;
+  }
+  paint_layout = layout;
+  return true;
+}
+
+void screen_set_quiet_hours(int start_minute, int end_minute) {
+  quiet.start = ((start_minute % MINUTES_PER_DAY) + MINUTES_PER_DAY) %
+                MINUTES_PER_DAY;
+  quiet.end =
+      ((end_minute % MINUTES_PER_DAY) + MINUTES_PER_DAY) % MINUTES_PER_DAY;
+}
+
+void screen_get_stats(screen_stats *out) {
+  *out = stats;
+  if (screen_on) {
+    // Include the interval still running
+    uint64_t open = DEV_Time_us() - power.mark;
+    if (main_panel->asleep) {
+      out->asleep_us += open;
+    } else {
+      out->awake_us += open;
+    }
+  }
+  DEV_STATS dev = DEV_Stats_Get();
+  out->spi_bytes = dev.SpiBytes;
+  out->busy_waits = dev.BusyWaits;
+  out->busy_total_us = dev.BusyUs;
+  out->delay_total_us = dev.DelayUs;
+}
+
 static void truncate_to_width(char *dest, size_t dest_size, const char *src,
-                              const sFONT *font) {
-  size_t len = strlen(src);
+                              size_t len, const sFONT *font) {
   int char_width = font->Width;
   int max_chars = SCREEN_HEIGHT / char_width;
 
   if ((int)len <= max_chars) {
-    strncpy(dest, src, dest_size - 1);
-    dest[dest_size - 1] = '\0';
+    if (len >= dest_size)
+      len = dest_size - 1;
+    memcpy(dest, src, len);
+    dest[len] = '\0';
     return;
   }
 
@@ -117,58 +690,431 @@ static void truncate_to_width(char *dest, size_t dest_size, const char *src,
     copy_chars = 0;
   if ((size_t)copy_chars >= dest_size)
     copy_chars = (int)dest_size - 1;
-  strncpy(dest, src, copy_chars);
+  memcpy(dest, src, copy_chars);
   dest[copy_chars] = '\0';
   strncat(dest, "...", dest_size - strlen(dest) - 1);
 }
 
-bool screen_paint(const char **lines, int line_count, int font_height) {
-  const sFONT *font = choose_font(font_height);
+// Records that p shows the frame with the given hash. input_hash is the hash
+// of the lines behind it, or NULL for a pushed frame.
+static void mark_shown(struct panel *p, uint64_t hash,
+                       const uint64_t *input_hash) {
+  p->shown.valid = true;
+  p->shown.frame_hash = hash;
+  p->shown.input_valid = input_hash != NULL;
+  if (input_hash) {
+    p->shown.input_hash = *input_hash;
+  }
+  p->pending.set = false;
+}
+
+// Decides whether p's framebuffer goes to the panel, and if so fills in r
+// and returns true. Every way of producing a frame ends here so they all
+// share one refresh path. A frame the panel already shows is skipped. A full
+// refresh is always honoured since callers use it to clear ghosting, and is
+// forced while the panel content is unknown after screen_start. During quiet
+// hours the frame stays in the framebuffer for screen_flush_pending.
+static bool prepare_refresh(struct panel *p, uint32_t flags,
+                            const uint64_t *input_hash, struct refresh *r) {
+  if (!p->shown.valid) {
+    flags |= SCREEN_FRAME_FULL_REFRESH;
+  }
+  uint64_t hash = hash_frame(p);
+  if (!(flags & SCREEN_FRAME_FULL_REFRESH) && p->shown.valid &&
+      p->shown.frame_hash == hash) {
+    stats.skipped++;
+    mark_shown(p, hash, input_hash);
+    return false;
+  }
+  if (in_quiet_hours()) {
+    stats.quiet_deferred++;
+    p->pending.set = true;
+    p->pending.input_valid = input_hash != NULL;
+    if (input_hash) {
+      p->pending.input_hash = *input_hash;
+    }
+    return false;
+  }
+
+  *r = (struct refresh){.panel = p,
+                        .full = flags & SCREEN_FRAME_FULL_REFRESH,
+                        .sleep = power.enabled,
+                        .hash = hash,
+                        .input_valid = input_hash != NULL};
+  if (input_hash) {
+    r->input_hash = *input_hash;
+  }
+  return true;
+}
+
+// Sends the frames of prepare_refresh and records them. With several panels
+// the phase timings describe the first one. Returns false when a panel gave
+// up waiting on BUSY; its frame is not recorded and the next one goes out as
+// a full refresh.
+static bool send_refreshes(struct refresh *jobs, int n) {
+  if (n == 0) {
+    return true;
+  }
+  struct timespec sent;
+  clock_gettime(CLOCK_REALTIME, &sent);
+  run_refreshes(jobs, n);
+
+  uint64_t woke = phase.wake_total_us - phase.wake_mark;
+  uint64_t layout = phase.layout_done - phase.start;
+  stats.layout_us = (uint32_t)(layout > woke ? layout - woke : 0);
+  stats.raster_us = (uint32_t)(jobs[0].start - phase.layout_done);
+  stats.resume_us = (uint32_t)jobs[0].resume_us;
+  stats.upload_us = (uint32_t)jobs[0].upload_us;
+  stats.busy_us = (uint32_t)jobs[0].busy_us;
+
+  bool ok = true;
+  for (int i = 0; i < n; ++i) {
+    struct refresh *r = &jobs[i];
+    if (r->failed) {
+      fprintf(stderr, "refresh: panel %d does not respond\n",
+              (int)(r->panel - panels));
+      r->panel->shown.valid = false;
+      ok = false;
+      continue;
+    }
+    stats.frames++;
+    if (r->full) {
+      stats.full_refreshes++;
+      stats.last_mode = SCREEN_MODE_FULL;
+    } else {
+      stats.partial_refreshes++;
+      stats.last_mode = SCREEN_MODE_PARTIAL;
+    }
+    mark_shown(r->panel, r->hash, r->input_valid ? &r->input_hash : NULL);
+
+    screen_history_entry info = {
+        .seq = stats.frames,
+        .time_us = (int64_t)sent.tv_sec * 1000000 + sent.tv_nsec / 1000,
+        .panel = (uint32_t)(r->panel - panels),
+        .mode = r->full ? SCREEN_MODE_FULL : SCREEN_MODE_PARTIAL,
+        .layout_us = stats.layout_us,
+        .raster_us = stats.raster_us,
+        .resume_us = (uint32_t)r->resume_us,
+        .upload_us = (uint32_t)r->upload_us,
+        .busy_us = (uint32_t)r->busy_us};
+    if (r->panel->layout == EPD_2in13_V4_LAYOUT_ROWS) {
+      history_record(info.panel, r->panel->image, &info);
+    } else {
+      UBYTE rows[SCREEN_FRAME_BYTES];
+      pages_to_rows(r->panel->image, rows);
+      history_record(info.panel, rows, &info);
+    }
+  }
+  return ok;
+}
+
+// Sends the first panel's framebuffer, see prepare_refresh.
+static bool flush_frame(uint32_t flags, const uint64_t *input_hash) {
+  struct refresh r;
+  if (prepare_refresh(main_panel, flags, input_hash, &r)) {
+    return send_refreshes(&r, 1);
+  }
+  return true;
+}
+
+bool screen_flush_pending(void) {
+  if (!screen_on || in_quiet_hours()) {
+    return true;
+  }
+  phase_begin();
+  phase_layout_done();
+  struct refresh jobs[SCREEN_MAX_PANELS];
+  int n = 0;
+  for (int i = 0; i < panel_count; ++i) {
+    struct panel *p = &panels[i];
+    if (!p->pending.set) {
+      continue;
+    }
+    uint64_t input_hash = p->pending.input_hash;
+    if (prepare_refresh(p, 0, p->pending.input_valid ? &input_hash : NULL,
+                        &jobs[n])) {
+      n++;
+    }
+  }
+  return send_refreshes(jobs, n);
+}
+
+// Skips a text paint whose lines and font match the ones on the panel. With a
+// frame held back by quiet hours the framebuffer no longer matches the panel,
+// so it is redrawn.
+static bool repeat_of_shown(uint64_t input_hash) {
+  const struct panel *p = main_panel;
+  if (screen_on && p->shown.valid && p->shown.input_valid && !p->pending.set &&
+      p->shown.input_hash == input_hash) {
+    stats.skipped++;
+    return true;
+  }
+  return false;
+}
+
+// Prepares the framebuffer for line_count centered lines and returns the
+// height of each line slot, or 0 on failure.
+static int begin_lines(int line_count) {
   if (line_count <= 0) {
     fprintf(stderr, "paint: no lines provided\n");
-    return false;
+    return 0;
   }
 
   if (!screen_on && !screen_turn_on()) {
-    return false;
+    return 0;
   }
   if (!init_framebuffer()) {
-    return false;
+    return 0;
   }
 
-  Paint_SelectImage(BlackImage);
-  Paint_Clear(WHITE);
-
   int content_height = SCREEN_WIDTH - TOP_MARGIN - BOTTOM_MARGIN;
   int slot_height = content_height / line_count;
   if (slot_height <= 0) {
     fprintf(stderr, "paint: too many lines to fit on screen\n");
-    return false;
+    return 0;
   }
 
+  Paint_SelectImage(main_panel->image);
+  if (paint_layout == SCREEN_LAYOUT_PAGES) {
+    Paint_SetLayout(PAINT_LAYOUT_PAGES);
+    main_panel->layout = EPD_2in13_V4_LAYOUT_PAGES;
+  } else {
+    Paint_SetLayout(PAINT_LAYOUT_ROWS);
+    main_panel->layout = EPD_2in13_V4_LAYOUT_ROWS;
+  }
+  Paint_Clear(WHITE);
+  return slot_height;
+}
+
+static void draw_line(int index, int slot_height, const char *text, size_t len,
+                      const sFONT *font) {
   UWORD bg = WHITE;
   UWORD fg = BLACK;
 
+  char rendered[MAX_MESSAGE_LENGTH] = {0};
+  truncate_to_width(rendered, sizeof(rendered), text, len, font);
+
+  int text_width = (int)strlen(rendered) * font->Width;
+  int y_slot_start = TOP_MARGIN + index * slot_height;
+  int y = y_slot_start + (slot_height - font->Height) / 2;
+  if (y < TOP_MARGIN)
+    y = TOP_MARGIN;
+  if (y + font->Height > SCREEN_WIDTH - BOTTOM_MARGIN) {
+    y = SCREEN_WIDTH - BOTTOM_MARGIN - font->Height;
+  }
+
+  int x = (SCREEN_HEIGHT - text_width) / 2;
+  if (x < 0)
+    x = 0;
+
+  Paint_DrawString_EN(x, y, rendered, (sFONT *)font, bg, fg);
+}
+
+bool screen_paint(const char **lines, int line_count, int font_height) {
+  phase_begin();
+  const sFONT *font = choose_font(font_height);
+  uint64_t input_hash = hash_lines_begin(font, line_count);
+  for (int i = 0; i < line_count; ++i) {
+    input_hash = hash_line(input_hash, lines[i], strlen(lines[i]));
+  }
+  if (line_count > 0 && repeat_of_shown(input_hash)) {
+    return true;
+  }
+
+  int slot_height = begin_lines(line_count);
+  if (slot_height <= 0) {
+    return false;
+  }
+  phase_layout_done();
+
   for (int i = 0; i < line_count; ++i) {
-    char rendered[MAX_MESSAGE_LENGTH] = {0};
-    truncate_to_width(rendered, sizeof(rendered), lines[i], font);
+    draw_line(i, slot_height, lines[i], strlen(lines[i]), font);
+  }
+
+  return flush_frame(0, &input_hash);
+}
 
-    int text_width = (int)strlen(rendered) * font->Width;
-    int y_slot_start = TOP_MARGIN + i * slot_height;
-    int y = y_slot_start + (slot_height - font->Height) / 2;
-    if (y < TOP_MARGIN)
-      y = TOP_MARGIN;
-    if (y + font->Height > SCREEN_WIDTH - BOTTOM_MARGIN) {
-      y = SCREEN_WIDTH - BOTTOM_MARGIN - font->Height;
+bool screen_paint_buf(const char *buf, const int *offsets, int line_count,
+                      int font_height) {
+  phase_begin();
+  const sFONT *font = choose_font(font_height);
+  uint64_t input_hash = hash_lines_begin(font, line_count);
+  for (int i = 0; i < line_count; ++i) {
+    int start = offsets[i];
+    int end = offsets[i + 1];
+    if (start < 0 || end < start) {
+      fprintf(stderr, "paint: bad offsets for line %d\n", i);
+      return false;
     }
+    input_hash = hash_line(input_hash, buf + start, (size_t)(end - start));
+  }
+  if (line_count > 0 && repeat_of_shown(input_hash)) {
+    return true;
+  }
 
-    int x = (SCREEN_HEIGHT - text_width) / 2;
-    if (x < 0)
-      x = 0;
+  int slot_height = begin_lines(line_count);
+  if (slot_height <= 0) {
+    return false;
+  }
+  phase_layout_done();
 
-    Paint_DrawString_EN(x, y, rendered, font, bg, fg);
+  for (int i = 0; i < line_count; ++i) {
+    draw_line(i, slot_height, buf + offsets[i],
+              (size_t)(offsets[i + 1] - offsets[i]), font);
   }
 
-  EPD_2in13_V4_Display_Partial(BlackImage);
-  return true;
+  return flush_frame(0, &input_hash);
+}
+
+static bool begin_push(void) {
+  if (!screen_on && !screen_turn_on()) {
+    return false;
+  }
+  return init_framebuffer();
+}
+
+bool screen_push_frame(const uint8_t *buf, size_t len, uint32_t flags) {
+  if (len != SCREEN_FRAME_BYTES) {
+    fprintf(stderr, "push: frame is %zu bytes, want %d\n", len,
+            SCREEN_FRAME_BYTES);
+    return false;
+  }
+  phase_begin();
+  if (!begin_push()) {
+    return false;
+  }
+
+  memcpy(main_panel->image, buf, SCREEN_FRAME_BYTES);
+  main_panel->layout = EPD_2in13_V4_LAYOUT_ROWS;
+  phase_layout_done();
+  return flush_frame(flags, NULL);
+}
+
+bool screen_push_window(const uint8_t *buf, size_t len, int x, int y,
+                        int width, int height, uint32_t flags) {
+  if (x < 0 || y < 0 || width <= 0 || height <= 0 || x % 8 != 0 ||
+      x + width > SCREEN_FRAME_COLUMNS || y + height > SCREEN_FRAME_ROWS) {
+    fprintf(stderr, "push: window %dx%d at %d,%d is off the panel\n", width,
+            height, x, y);
+    return false;
+  }
+  size_t row_bytes = (size_t)(width + 7) / 8;
+  if (len != row_bytes * (size_t)height) {
+    fprintf(stderr, "push: window is %zu bytes, want %zu\n", len,
+            row_bytes * (size_t)height);
+    return false;
+  }
+  phase_begin();
+  if (!begin_push()) {
+    return false;
+  }
+
+  // The window patches rows of the frame a paint may have left in pages. A
+  // width that is not a multiple of 8 leaves the trailing bits of the last
+  // byte of each row untouched.
+  frame_to_rows(main_panel);
+  uint8_t tail_mask = width % 8 ? (uint8_t)(0xFF << (8 - width % 8)) : 0xFF;
+  for (int row = 0; row < height; ++row) {
+    const uint8_t *src = buf + (size_t)row * row_bytes;
+    uint8_t *dst =
+        main_panel->image + (size_t)(y + row) * SCREEN_FRAME_ROW_BYTES + x / 8;
+    memcpy(dst, src, row_bytes - 1);
+    dst[row_bytes - 1] =
+        (dst[row_bytes - 1] & ~tail_mask) | (src[row_bytes - 1] & tail_mask);
+  }
+  phase_layout_done();
+  return flush_frame(flags, NULL);
+}
+
+int screen_panel_count(void) { return panel_count; }
+
+int screen_add_panel(const screen_panel_pins *pins) {
+  if (panel_count >= SCREEN_MAX_PANELS) {
+    fprintf(stderr, "panel: at most %d panels\n", SCREEN_MAX_PANELS);
+    return -1;
+  }
+  if (pins->cs_pin < 0 || pins->rst_pin < 0 || pins->busy_pin < 0) {
+    fprintf(stderr, "panel: CS, RST and BUSY lines are required\n");
+    return -1;
+  }
+  if (!begin_push()) {
+    return -1;
+  }
+  for (int i = 0; i < panel_count; ++i) {
+    const EPD_2in13_V4_PANEL *dev = &panels[i].dev;
+    if (dev->CsPin == pins->cs_pin || dev->RstPin == pins->rst_pin ||
+        dev->BusyPin == pins->busy_pin) {
+      fprintf(stderr, "panel: lines already used by panel %d\n", i);
+      return -1;
+    }
+  }
+  const EPD_2in13_V4_TIMING *t = timing_profile(pins->timing);
+  if (!t) {
+    return -1;
+  }
+  int dc = pins->dc_pin >= 0 ? pins->dc_pin : EPD_DC_PIN;
+  if (DEV_Panel_Init(pins->rst_pin, dc, pins->cs_pin, pins->busy_pin) != 0) {
+    fprintf(stderr, "panel: failed to set up its lines\n");
+    return -1;
+  }
+
+  struct panel *p = &panels[panel_count];
+  p->image = (UBYTE *)malloc(SCREEN_FRAME_BYTES);
+  if (!p->image) {
+    fprintf(stderr, "panel: failed to allocate framebuffer\n");
+    return -1;
+  }
+  memset(p->image, 0xFF, SCREEN_FRAME_BYTES);
+  p->layout = EPD_2in13_V4_LAYOUT_ROWS;
+  p->dev = (EPD_2in13_V4_PANEL){.RstPin = pins->rst_pin,
+                                .DcPin = dc,
+                                .CsPin = pins->cs_pin,
+                                .BusyPin = pins->busy_pin,
+                                .Timing = t};
+  EPD_2in13_V4_Select(&p->dev);
+  EPD_2in13_V4_Init_Fast();
+  EPD_2in13_V4_Clear();
+  if (p->dev.BusyFailed) {
+    fprintf(stderr, "panel: does not respond\n");
+    free(p->image);
+    p->image = NULL;
+    return -1;
+  }
+  p->asleep = false;
+  p->shown.valid = true;
+  p->shown.frame_hash = hash_frame(p);
+  p->shown.input_valid = false;
+  p->pending.set = false;
+  if (power.enabled) {
+    panel_sleep(p);
+  }
+  return panel_count++;
+}
+
+bool screen_push_frames(const uint8_t *const *frames, int count,
+                        uint32_t flags) {
+  if (count <= 0 || count > panel_count) {
+    fprintf(stderr, "push: %d frames for %d panels\n", count, panel_count);
+    return false;
+  }
+  phase_begin();
+  if (!begin_push()) {
+    return false;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (frames[i]) {
+      memcpy(panels[i].image, frames[i], SCREEN_FRAME_BYTES);
+      panels[i].layout = EPD_2in13_V4_LAYOUT_ROWS;
+    }
+  }
+  phase_layout_done();
+
+  struct refresh jobs[SCREEN_MAX_PANELS];
+  int n = 0;
+  for (int i = 0; i < count; ++i) {
+    if (frames[i] && prepare_refresh(&panels[i], flags, NULL, &jobs[n])) {
+      n++;
+    }
+  }
+  return send_refreshes(jobs, n);
 }
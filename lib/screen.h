@@ -2,9 +2,180 @@
 #define SCREEN_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Framebuffer in panel-native layout: SCREEN_FRAME_ROWS rows of
+// SCREEN_FRAME_ROW_BYTES bytes, 1 bit per pixel, MSB first, 1 = white. Rows run
+// along the long edge; screen_paint draws landscape, so its x axis maps to
+// rows and its y axis to bits counted from the right-hand end of a row.
+#define SCREEN_FRAME_COLUMNS 122
+#define SCREEN_FRAME_ROWS 250
+#define SCREEN_FRAME_ROW_BYTES ((SCREEN_FRAME_COLUMNS + 7) / 8)
+#define SCREEN_FRAME_BYTES (SCREEN_FRAME_ROW_BYTES * SCREEN_FRAME_ROWS)
+
+// screen_push_* flags
+#define SCREEN_FRAME_FULL_REFRESH (1u << 0) // full waveform instead of partial
 
 bool screen_turn_on(void);
+// Fast cold start: turns the panel on without the environment check, the
+// banners or the initial clear. The first frame is sent as a full refresh
+// and replaces the clear.
+bool screen_start(void);
 void screen_turn_off(void);
 bool screen_paint(const char **lines, int line_count, int font_height);
+// Same layout as screen_paint, with every line packed into one buffer: line i
+// is buf[offsets[i]] up to buf[offsets[i + 1]], so offsets has line_count + 1
+// entries. Lines need no NUL terminator.
+bool screen_paint_buf(const char *buf, const int *offsets, int line_count,
+                      int font_height);
+
+// Uploads a complete frame of SCREEN_FRAME_BYTES bytes and refreshes the panel.
+bool screen_push_frame(const uint8_t *buf, size_t len, uint32_t flags);
+// Replaces the rectangle at (x, y) of the current frame, in native columns and
+// rows, with buf (height rows of (width + 7) / 8 bytes) and refreshes. x must
+// be a multiple of 8.
+bool screen_push_window(const uint8_t *buf, size_t len, int x, int y,
+                        int width, int height, uint32_t flags);
+
+// Additional panels share SPI with the first one, and DC unless given their
+// own, and each has its own CS, RST and BUSY lines (BCM numbers) and timing
+// profile. CS may be CE1 (GPIO 7) or any free GPIO. Not available with the
+// gpiod2 backend.
+#define SCREEN_MAX_PANELS 4
+
+typedef struct {
+  int cs_pin;
+  int rst_pin;
+  int busy_pin;
+  int dc_pin; // -1 shares the first panel's DC
+  int timing; // SCREEN_TIMING_*, see screen_set_timing
+} screen_panel_pins;
+
+// Sets up and clears one more panel, turning the first one on if needed.
+// Returns its index, from 1, or -1. Added panels stay until screen_turn_off.
+int screen_add_panel(const screen_panel_pins *pins);
+int screen_panel_count(void);
+// Uploads frames[i], SCREEN_FRAME_BYTES each, to panel i for i < count and
+// refreshes those panels at once: uploads take turns on the shared bus while
+// the refreshes and BUSY waits overlap, so N panels take about as long as
+// one. A NULL entry leaves its panel alone. Panel 0 is the one screen_paint
+// and screen_push_* draw on; quiet hours and auto sleep apply to all.
+bool screen_push_frames(const uint8_t *const *frames, int count,
+                        uint32_t flags);
+
+// Frame history: the library keeps the frames it sent to the panels, oldest
+// first, compressed against each other so hundreds fit in a few dozen KB. By
+// default it holds the last SCREEN_HISTORY_ENTRIES frames in at most
+// SCREEN_HISTORY_BYTES of compressed data. All history calls are safe to
+// make while another thread paints.
+#define SCREEN_HISTORY_MAX_ENTRIES 1024
+#define SCREEN_HISTORY_ENTRIES 256
+#define SCREEN_HISTORY_BYTES (64 * 1024)
+
+typedef struct {
+  uint64_t seq;    // screen_stats.frames once it was sent
+  int64_t time_us; // wall clock when it was sent, microseconds since the epoch
+  uint32_t panel;
+  uint32_t mode; // SCREEN_MODE_*
+  uint32_t layout_us; // phase timings, as in screen_stats
+  uint32_t raster_us;
+  uint32_t resume_us;
+  uint32_t upload_us;
+  uint32_t busy_us;
+  uint32_t size; // compressed bytes held for it, 0 for the newest of a panel
+} screen_history_entry;
+
+// Limits the history to max_entries frames, at most
+// SCREEN_HISTORY_MAX_ENTRIES, and max_bytes of compressed data, dropping the
+// oldest frames to fit. 0 entries turns it off and frees it.
+void screen_set_history(int max_entries, size_t max_bytes);
+// Copies the newest max entries, oldest first, to out and returns how many.
+int screen_history(screen_history_entry *out, int max);
+// Copies the entry with the given seq to info and its frame, in rows of
+// SCREEN_FRAME_BYTES, to frame. Returns false when it is no longer held.
+bool screen_history_frame(uint64_t seq, screen_history_entry *info,
+                          uint8_t *frame);
+// Copies the last frame sent to panel, in rows, to frame. Returns false when
+// the history holds none.
+bool screen_current_frame(int panel, uint8_t *frame);
+
+// Puts the panel controller into deep sleep after every refresh and wakes it
+// with a short reset on the next one. On by default.
+void screen_set_auto_sleep(bool on);
+
+// No refreshes happen between start_minute and end_minute local time, in
+// minutes after midnight; the window wraps past midnight when start is later
+// than end, and equal values disable it. Paints and pushes during the window
+// still update the framebuffer, and the last of them is held back until
+// screen_flush_pending.
+void screen_set_quiet_hours(int start_minute, int end_minute);
+// Sends the frame held back by quiet hours, if any. Returns true when there
+// was nothing to send or the window is still open.
+bool screen_flush_pending(void);
+
+// screen_set_timing profiles
+#define SCREEN_TIMING_WAVESHARE 0 // delays of the vendor driver
+#define SCREEN_TIMING_DATASHEET 1 // trimmed to the controller minimums
+
+// Selects the delays used for resets, wakes, sleep and BUSY polling of the
+// first panel; added panels take theirs from screen_panel_pins. The
+// Waveshare profile is the default: the datasheet one has not been checked
+// on real hardware yet.
+bool screen_set_timing(int profile);
+
+// screen_set_paint_layout layouts
+#define SCREEN_LAYOUT_ROWS 0  // the frame layout above
+#define SCREEN_LAYOUT_PAGES 1 // SCREEN_FRAME_ROW_BYTES pages of SCREEN_FRAME_ROWS
+                              // bytes, page p holding columns 8p to 8p+7
+
+// Selects the framebuffer layout screen_paint draws in. In pages a landscape
+// text row is a run of consecutive bytes, so glyphs are drawn row by row
+// without the per-pixel rotation, and the controller's address counter
+// (data entry mode 0x07) puts the pages in place on upload. Rows is the
+// default. Pushed frames are always rows.
+bool screen_set_paint_layout(int layout);
+
+// Number of paints and pushes skipped because the panel already showed the
+// resulting frame.
+uint64_t screen_skipped_refreshes(void);
+
+// screen_stats.last_mode
+#define SCREEN_MODE_NONE 0 // no frame sent yet
+#define SCREEN_MODE_PARTIAL 1
+#define SCREEN_MODE_FULL 2
+
+// Counters are totals since start. The *_us phase timings are microseconds on
+// the monotonic clock and describe the last frame sent to the panel (the
+// first of several refreshed at once), except wake_us and sleep_us which
+// describe the last screen_turn_on (or screen_start) and screen_turn_off.
+// asleep_us and awake_us split the time since the first panel was turned on
+// between deep sleep and a powered controller.
+typedef struct {
+  uint64_t frames; // frames sent to the panel
+  uint64_t full_refreshes;
+  uint64_t partial_refreshes;
+  uint64_t skipped; // see screen_skipped_refreshes
+  uint64_t spi_bytes;
+  uint64_t busy_waits;
+  uint64_t busy_total_us;
+  uint64_t delay_total_us; // fixed delays in resets, wakes and sleeps
+  uint64_t resumes; // wakes from deep sleep
+  uint64_t resume_total_us;
+  uint64_t asleep_us;
+  uint64_t awake_us;
+  uint64_t quiet_deferred; // frames held back by quiet hours
+  uint32_t last_mode;
+  uint32_t layout_us; // hashing, clearing and placing lines, or copying a push
+  uint32_t raster_us; // drawing glyphs into the framebuffer
+  uint32_t resume_us; // waking the panel from deep sleep, 0 if it was awake;
+                      // a partial refresh wakes it in upload_us instead
+  uint32_t upload_us; // commands and frame data over SPI
+  uint32_t busy_us;   // waiting for the panel to finish refreshing
+  uint32_t wake_us;
+  uint32_t sleep_us;
+} screen_stats;
+
+void screen_get_stats(screen_stats *out);
 
 #endif // SCREEN_H
@@ -1,22 +1,34 @@
 package main
 
 import (
+	"context"
 	"fmt"
 	"log"
+	"net/http"
 	"os"
 	"os/signal"
 	"strings"
 	"syscall"
 	"time"
 
-	"jarvis/notifications"
+	"jarvis/display"
+	"jarvis/metrics"
+	"jarvis/providers"
 	"jarvis/quotes"
+	"jarvis/schedule"
 	"jarvis/screen"
 )
 
 const (
 	defaultFontSize  = 16
 	defaultInterval  = 15 * time.Second
+	rotateEnv        = "JARVIS_ROTATE_INTERVAL"
+	quietEnv         = "JARVIS_QUIET_HOURS"
+	timingEnv        = "JARVIS_PANEL_TIMING"
+	layoutEnv        = "JARVIS_PAINT_LAYOUT"
+	displayEnv       = "JARVIS_DISPLAY_SOCKET"
+	rotationKey      = 1   // coalescing key of the rotation's own updates
+	latencyWindow    = 100 // frames per paint latency summary
 	quoteRefreshHour = 0
 	quotesCachePath  = "quotes.json"
 	screenHeightPx   = 250
@@ -155,59 +167,292 @@ func nextDailyAtHour(hour int) time.Time {
 	return candidate
 }
 
-func main() {
-	rotator, err := quotes.NewRotatorFromCache()
+// quoteProvider shows the current quote, which moves on when quotes refresh.
+type quoteProvider struct {
+	rotator *quotes.Rotator
+	quote   quotes.Quote
+	version uint64
+}
+
+// Next advances to the next quote in the rotation.
+func (p *quoteProvider) Next() quotes.Quote {
+	p.quote = p.rotator.NextQuote()
+	p.version++
+	return p.quote
+}
+
+func (p *quoteProvider) Name() string {
+	return "quote"
+}
+
+func (p *quoteProvider) Render(time.Time) providers.Content {
+	lines, font := prepareLines(p.quote, defaultFontSize)
+	return providers.Content{Lines: lines, FontHeight: font.height}
+}
+
+func (p *quoteProvider) NextChange(time.Time) time.Time {
+	return time.Time{}
+}
+
+func (p *quoteProvider) Version(time.Time) uint64 {
+	return p.version
+}
+
+// rotateInterval is how long each screen stays up, from JARVIS_ROTATE_INTERVAL
+// when set. Zero keeps the quote up and only repaints when content changes.
+func rotateInterval() time.Duration {
+	v := os.Getenv(rotateEnv)
+	if v == "" {
+		return defaultInterval
+	}
+	d, err := time.ParseDuration(v)
+	if err != nil || d < 0 {
+		fmt.Fprintf(os.Stderr, "Ignoring invalid %s=%q\n", rotateEnv, v)
+		return defaultInterval
+	}
+	return d
+}
+
+// quietHours is the window without refreshes from JARVIS_QUIET_HOURS, such
+// as "22:30-07:00". Unset or invalid means none.
+func quietHours() screen.QuietHours {
+	v := os.Getenv(quietEnv)
+	if v == "" {
+		return screen.QuietHours{}
+	}
+	q, err := screen.ParseQuietHours(v)
 	if err != nil {
-		fmt.Fprintf(os.Stderr, "Failed to load quotes: %v\n", err)
-		rotator = quotes.NewRotator([]quotes.Quote{{Quote: "No quotes available", Author: ""}})
+		fmt.Fprintf(os.Stderr, "Ignoring invalid %s: %v\n", quietEnv, err)
+		return screen.QuietHours{}
+	}
+	return q
+}
+
+// resetTimer points t at deadline, or parks it when deadline is zero.
+func resetTimer(t *time.Timer, deadline time.Time) {
+	if !t.Stop() {
+		select {
+		case <-t.C:
+		default:
+		}
+	}
+	if !deadline.IsZero() {
+		t.Reset(time.Until(deadline))
+	}
+}
+
+// serveDisplay starts a display server on the socket at path, calling
+// observe after every update it draws. Without the socket the panel stays
+// private to this process.
+func serveDisplay(ctx context.Context, path string, observe func()) *display.Server {
+	l, err := display.Listen(path)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "Display socket failed: %v\n", err)
+		return nil
+	}
+	srv := display.NewServer(display.ScreenPanel{})
+	srv.OnDraw = func(u *display.Update, err error) {
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Paint failed: key %d: %v\n", u.Key, err)
+		}
+		observe()
+	}
+	go srv.Run(ctx)
+	go func() {
+		if err := srv.Serve(ctx, l); err != nil {
+			fmt.Fprintf(os.Stderr, "Display socket failed: %v\n", err)
+		}
+	}()
+	log.Printf("Serving the display on %s", path)
+	return srv
+}
+
+func main() {
+	tl := newTimeline()
+	fast := fastStartup()
+
+	if v := os.Getenv(timingEnv); v != "" {
+		p, err := screen.ParseTimingProfile(v)
+		if err == nil {
+			err = screen.SetTimingProfile(p)
+		}
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Ignoring invalid %s: %v\n", timingEnv, err)
+		}
+	}
+	if v := os.Getenv(layoutEnv); v != "" {
+		l, err := screen.ParsePaintLayout(v)
+		if err == nil {
+			err = screen.SetPaintLayout(l)
+		}
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Ignoring invalid %s: %v\n", layoutEnv, err)
+		}
 	}
-	q := rotator.NextQuote()
 
-	if err := screen.TurnOn(); err != nil {
+	quiet := quietHours()
+	if quiet.Enabled() {
+		screen.SetQuietHours(quiet)
+		log.Printf("Quiet hours %s: no refreshes in the window", quiet)
+	}
+
+	rotator, fetchNow, err := bringUp(fast, tl)
+	if err != nil {
 		fmt.Fprintf(os.Stderr, "Turn on failed: %v\n", err)
 		os.Exit(1)
 	}
+	quote := &quoteProvider{rotator: rotator}
+	quote.Next()
+
+	// Screens in rotation order
+	var registry providers.Registry
+	quoteScreen := registry.Register(quote)
+	registry.Register(&providers.Countdown{FontHeight: defaultFontSize, LastFetch: rotator.LastFetch})
+
+	// Cancelled on shutdown so a background quote refresh stops retrying
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+
+	telemetry := newTelemetry(rotator)
+	if addr := os.Getenv(metricsEnv); addr != "" {
+		if err := metrics.Serve(ctx, addr, telemetry.registry, map[string]http.Handler{framesPath: frameHistory{}}); err != nil {
+			fmt.Fprintf(os.Stderr, "Metrics listener failed: %v\n", err)
+		} else {
+			log.Printf("Serving metrics on %s/metrics and frames on %s%s", addr, addr, framesPath)
+		}
+	}
 
 	// Graceful shutdown
 	sigc := make(chan os.Signal, 1)
 	signal.Notify(sigc, os.Interrupt, syscall.SIGTERM)
 	defer signal.Stop(sigc)
 
-	ticker := time.NewTicker(defaultInterval)
-	defer ticker.Stop()
-
 	refreshQuotesTimer := time.NewTimer(time.Until(nextDailyAtHour(quoteRefreshHour)))
 	defer refreshQuotesTimer.Stop()
 
-	if err := screen.Paint([]string{"Welcome :)"}, defaultFontSize); err != nil {
-		fmt.Fprintf(os.Stderr, "Paint failed: %v\n", err)
+	// The welcome screen stays up for one interval before the rotation
+	// starts. The fast start skips it and paints the first quote right away.
+	start := time.Now()
+	startupLogged := false
+	logStartup := func() {
+		if startupLogged {
+			return
+		}
+		startupLogged = true
+		tl.mark("first frame")
+		log.Printf("Startup timeline (fast=%t): %s", fast, tl)
+	}
+	if !fast {
+		if err := screen.Paint([]string{"Welcome :)"}, defaultFontSize); err != nil {
+			fmt.Fprintf(os.Stderr, "Paint failed: %v\n", err)
+		}
+		logStartup()
+		start = start.Add(defaultInterval)
+	}
+
+	rotate := rotateInterval()
+	sched := schedule.New(registry.Sources(), rotate, schedule.DefaultSlack, start)
+	wake := time.NewTimer(time.Until(start))
+	defer wake.Stop()
+
+	latency := screen.NewLatencyLog(latencyWindow)
+	observe := func() {
+		stats := screen.Stats()
+		telemetry.observePaint(stats)
+		if latency.Observe(stats) && stats.Frames%latencyWindow == 0 {
+			log.Printf("Paint latency over %d frames: %s; %d full, %d partial, %d skipped, %d SPI bytes, wake %v, asleep %.1f%%",
+				latency.Len(), latency.Summary(), stats.FullRefreshes, stats.PartialRefreshes,
+				stats.Skipped, stats.SPIBytes, stats.Wake, 100*stats.AsleepFraction())
+		}
+	}
+
+	// With a display socket, other producers share the panel: the server's
+	// goroutine does all drawing from here on and the rotation submits to it
+	// like any client.
+	var srv *display.Server
+	if path := os.Getenv(displayEnv); path != "" {
+		srv = serveDisplay(ctx, path, observe)
+	}
+	if srv != nil {
+		telemetry.observeDisplay(srv)
+	}
+	onPanel := func(fn func()) {
+		if srv == nil {
+			fn()
+			return
+		}
+		srv.Do(fn)
+	}
+
+	paint := func(now time.Time) {
+		if !sched.Advance(now) {
+			return
+		}
+		i := sched.Current()
+		content := registry.Render(i, now)
+		if srv != nil {
+			srv.Submit(&display.Update{
+				Type:     display.MsgText,
+				Priority: display.PriorityNormal,
+				Key:      rotationKey,
+				Text:     display.Text{Lines: content.Lines, FontHeight: content.FontHeight},
+			})
+		} else {
+			if err := screen.Paint(content.Lines, content.FontHeight); err != nil {
+				fmt.Fprintf(os.Stderr, "Paint failed: %s: %v\n", registry.Provider(i).Name(), err)
+			}
+			observe()
+		}
+		sched.Painted()
+		logStartup()
+	}
+
+	// Sends whatever the rotation painted during quiet hours once they end
+	quietEnd := time.NewTimer(0)
+	resetTimer(quietEnd, quiet.NextEnd(time.Now()))
+	defer quietEnd.Stop()
+
+	// Non-nil while a background quote refresh is in flight
+	var refreshDone <-chan error
+	if fetchNow {
+		refreshDone = rotator.StartRefresh(ctx)
 	}
 
-	showQuote := true
 	for {
 		select {
 		case <-sigc:
-			screen.TurnOff()
+			cancel()
+			onPanel(screen.TurnOff)
 			time.Sleep(4 * time.Second)
 			return
-		case <-ticker.C:
-			if showQuote {
-				lines, chosenFont := prepareLines(q, defaultFontSize)
-				if err := screen.Paint(lines, chosenFont.height); err != nil {
-					fmt.Fprintf(os.Stderr, "Paint failed: %v\n", err)
+		case <-wake.C:
+			paint(time.Now())
+			resetTimer(wake, sched.Deadline())
+		case <-quietEnd.C:
+			onPanel(func() {
+				if err := screen.FlushPending(); err != nil {
+					fmt.Fprintf(os.Stderr, "Flush after quiet hours failed: %v\n", err)
 				}
-			} else {
-				lines := notifications.BuildLines(time.Now(), rotator.LastFetch)
-				if err := screen.Paint(lines, defaultFontSize); err != nil {
-					fmt.Fprintf(os.Stderr, "Paint failed: %v\n", err)
-				}
-			}
-			showQuote = !showQuote
+				telemetry.observePaint(screen.Stats())
+			})
+			resetTimer(quietEnd, quiet.NextEnd(time.Now()))
 		case <-refreshQuotesTimer.C:
-			rotator.Refresh()
-			q = rotator.NextQuote()
-			log.Printf("Quote refreshed at %s: %q — %s", time.Now().Format(time.RFC3339), q.Quote, q.Author)
+			if refreshDone == nil {
+				refreshDone = rotator.StartRefresh(ctx)
+			}
 			refreshQuotesTimer.Reset(time.Until(nextDailyAtHour(quoteRefreshHour)))
+		case err := <-refreshDone:
+			refreshDone = nil
+			if err != nil {
+				fmt.Fprintf(os.Stderr, "Quote refresh failed: %v\n", err)
+			}
+			q := quote.Next()
+			log.Printf("Quote refreshed at %s: %q — %s", time.Now().Format(time.RFC3339), q.Quote, q.Author)
+			now := time.Now()
+			if !now.Before(start) && sched.Invalidate(quoteScreen, now) {
+				paint(now)
+				resetTimer(wake, sched.Deadline())
+			}
 		}
 	}
 }
@@ -0,0 +1,57 @@
+package main
+
+import (
+	"strings"
+	"testing"
+
+	"jarvis/quotes"
+)
+
+var (
+	shortQuote = quotes.Quote{Quote: "Simplicity is prerequisite for reliability.", Author: "Edsger W. Dijkstra"}
+	longQuote  = quotes.Quote{
+		Quote:  strings.Repeat("The most dangerous phrase in the language is we've always done it this way. ", 3),
+		Author: "Grace Hopper",
+	}
+)
+
+func BenchmarkWrapText(b *testing.B) {
+	for _, f := range fontOptions {
+		maxChars := screenHeightPx / f.width
+		b.Run(fontName(f), func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				wrapText(longQuote.Quote, maxChars)
+			}
+		})
+	}
+}
+
+func BenchmarkPrepareLines(b *testing.B) {
+	for _, bc := range []struct {
+		name  string
+		quote quotes.Quote
+	}{
+		{"Short", shortQuote},
+		{"Long", longQuote},
+	} {
+		b.Run(bc.name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				prepareLines(bc.quote, defaultFontSize)
+			}
+		})
+	}
+}
+
+func fontName(f fontOption) string {
+	switch f.height {
+	case 20:
+		return "Font20"
+	case 16:
+		return "Font16"
+	case 12:
+		return "Font12"
+	}
+	return "Font8"
+}
@@ -0,0 +1,243 @@
+// Package metrics exports counters, gauges and histograms in the Prometheus
+// text exposition format.
+//
+// Updates are single atomic operations so instrumented paths stay cheap on
+// the Pi Zero; anything that is expensive to compute is registered as a
+// function and only evaluated when the endpoint is scraped.
+package metrics
+
+import (
+	"bufio"
+	"context"
+	"fmt"
+	"io"
+	"math"
+	"net"
+	"net/http"
+	"sort"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// Counter is a monotonically increasing value.
+type Counter struct {
+	v atomic.Uint64
+}
+
+func (c *Counter) Inc() {
+	c.v.Add(1)
+}
+
+func (c *Counter) Add(n uint64) {
+	c.v.Add(n)
+}
+
+// Histogram counts observations into cumulative buckets.
+type Histogram struct {
+	bounds  []float64
+	buckets []atomic.Uint64 // per bucket, made cumulative when written
+	count   atomic.Uint64
+	sum     atomic.Uint64 // float64 bits
+}
+
+// Observe records v.
+func (h *Histogram) Observe(v float64) {
+	i := sort.SearchFloat64s(h.bounds, v)
+	if i < len(h.buckets) {
+		h.buckets[i].Add(1)
+	}
+	h.count.Add(1)
+	for {
+		old := h.sum.Load()
+		if h.sum.CompareAndSwap(old, math.Float64bits(math.Float64frombits(old)+v)) {
+			return
+		}
+	}
+}
+
+// ObserveDuration records d in seconds.
+func (h *Histogram) ObserveDuration(d time.Duration) {
+	h.Observe(d.Seconds())
+}
+
+// DurationBuckets suits anything from a SPI transfer to a slow fetch.
+var DurationBuckets = []float64{.001, .005, .01, .05, .1, .25, .5, 1, 2.5, 5, 10, 30}
+
+const (
+	typeCounter   = "counter"
+	typeGauge     = "gauge"
+	typeHistogram = "histogram"
+)
+
+type series struct {
+	labels string
+	write  func(w io.Writer, name, labels string)
+}
+
+type family struct {
+	name, help, kind string
+	series           []series
+}
+
+// Registry holds metric families in registration order.
+type Registry struct {
+	mu       sync.Mutex
+	families []*family
+	byName   map[string]*family
+}
+
+func NewRegistry() *Registry {
+	return &Registry{byName: map[string]*family{}}
+}
+
+func (r *Registry) add(name, help, kind, labels string, write func(io.Writer, string, string)) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	f := r.byName[name]
+	if f == nil {
+		f = &family{name: name, help: help, kind: kind}
+		r.byName[name] = f
+		r.families = append(r.families, f)
+	} else if f.kind != kind {
+		panic("metrics: " + name + " registered as both " + f.kind + " and " + kind)
+	}
+	f.series = append(f.series, series{labels: labels, write: write})
+}
+
+func formatFloat(v float64) string {
+	return strconv.FormatFloat(v, 'g', -1, 64)
+}
+
+// braces wraps a label list such as `phase="upload"` for a sample line.
+func braces(labels string) string {
+	if labels == "" {
+		return ""
+	}
+	return "{" + labels + "}"
+}
+
+// Counter registers a counter. labels is a preformatted label list such as
+// `mode="full"`, or empty.
+func (r *Registry) Counter(name, help, labels string) *Counter {
+	c := &Counter{}
+	r.add(name, help, typeCounter, labels, func(w io.Writer, name, labels string) {
+		fmt.Fprintf(w, "%s%s %d\n", name, braces(labels), c.v.Load())
+	})
+	return c
+}
+
+// CounterFunc registers a counter whose value is read from fn at scrape time.
+func (r *Registry) CounterFunc(name, help, labels string, fn func() float64) {
+	r.add(name, help, typeCounter, labels, func(w io.Writer, name, labels string) {
+		fmt.Fprintf(w, "%s%s %s\n", name, braces(labels), formatFloat(fn()))
+	})
+}
+
+// GaugeFunc registers a gauge whose value is read from fn at scrape time.
+func (r *Registry) GaugeFunc(name, help, labels string, fn func() float64) {
+	r.add(name, help, typeGauge, labels, func(w io.Writer, name, labels string) {
+		fmt.Fprintf(w, "%s%s %s\n", name, braces(labels), formatFloat(fn()))
+	})
+}
+
+// Histogram registers a histogram with the given upper bucket bounds, which
+// must be sorted.
+func (r *Registry) Histogram(name, help, labels string, bounds []float64) *Histogram {
+	h := &Histogram{bounds: bounds, buckets: make([]atomic.Uint64, len(bounds))}
+	r.add(name, help, typeHistogram, labels, func(w io.Writer, name, labels string) {
+		sep := ""
+		if labels != "" {
+			sep = ","
+		}
+		// Read count first so the +Inf bucket is never below a finite one
+		count := h.count.Load()
+		var cumulative uint64
+		for i, le := range h.bounds {
+			cumulative += h.buckets[i].Load()
+			if cumulative > count {
+				cumulative = count
+			}
+			fmt.Fprintf(w, "%s_bucket{%s%sle=\"%s\"} %d\n", name, labels, sep, formatFloat(le), cumulative)
+		}
+		fmt.Fprintf(w, "%s_bucket{%s%sle=\"+Inf\"} %d\n", name, labels, sep, count)
+		fmt.Fprintf(w, "%s_sum%s %s\n", name, braces(labels), formatFloat(math.Float64frombits(h.sum.Load())))
+		fmt.Fprintf(w, "%s_count%s %d\n", name, braces(labels), count)
+	})
+	return h
+}
+
+// WriteTo writes every metric in the text exposition format.
+func (r *Registry) WriteTo(w io.Writer) (int64, error) {
+	r.mu.Lock()
+	families := append([]*family(nil), r.families...)
+	r.mu.Unlock()
+
+	cw := &countingWriter{w: bufio.NewWriter(w)}
+	for _, f := range families {
+		fmt.Fprintf(cw, "# HELP %s %s\n# TYPE %s %s\n", f.name, f.help, f.name, f.kind)
+		for _, s := range f.series {
+			s.write(cw, f.name, s.labels)
+		}
+	}
+	if cw.err == nil {
+		cw.err = cw.w.Flush()
+	}
+	return cw.n, cw.err
+}
+
+type countingWriter struct {
+	w   *bufio.Writer
+	n   int64
+	err error
+}
+
+func (c *countingWriter) Write(p []byte) (int, error) {
+	if c.err != nil {
+		return 0, c.err
+	}
+	n, err := c.w.Write(p)
+	c.n += int64(n)
+	c.err = err
+	return n, err
+}
+
+// ServeHTTP serves the registry to scrapers.
+func (r *Registry) ServeHTTP(w http.ResponseWriter, _ *http.Request) {
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+	r.WriteTo(w)
+}
+
+// Serve exposes r on addr at /metrics, and each of extra at its path, until
+// ctx is cancelled. An address without a host, such as ":9100", binds to
+// loopback only.
+func Serve(ctx context.Context, addr string, r *Registry, extra map[string]http.Handler) error {
+	host, port, err := net.SplitHostPort(addr)
+	if err != nil {
+		return err
+	}
+	if host == "" {
+		addr = net.JoinHostPort("127.0.0.1", port)
+	}
+	ln, err := net.Listen("tcp", addr)
+	if err != nil {
+		return err
+	}
+
+	mux := http.NewServeMux()
+	mux.Handle("/metrics", r)
+	for path, h := range extra {
+		mux.Handle(path, h)
+	}
+	srv := &http.Server{
+		Handler:           mux,
+		ReadHeaderTimeout: 5 * time.Second,
+	}
+	go func() {
+		<-ctx.Done()
+		srv.Close()
+	}()
+	go srv.Serve(ln)
+	return nil
+}
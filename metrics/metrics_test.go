@@ -0,0 +1,80 @@
+package metrics
+
+import (
+	"bytes"
+	"net/http/httptest"
+	"strings"
+	"testing"
+)
+
+func TestWriteTo(t *testing.T) {
+	r := NewRegistry()
+	frames := r.Counter("frames_total", "Frames sent.", "")
+	frames.Add(3)
+	frames.Inc()
+	h := r.Histogram("refresh_seconds", "Refresh time.", `mode="partial"`, []float64{.1, .5, 1})
+	for _, v := range []float64{.05, .1, .3, .7, 2} {
+		h.Observe(v)
+	}
+	r.Histogram("refresh_seconds", "Refresh time.", "", []float64{1}).Observe(.5)
+	r.GaugeFunc("temperature_celsius", "Panel temperature.", `panel="0"`, func() float64 { return 21.5 })
+
+	want := `# HELP frames_total Frames sent.
+# TYPE frames_total counter
+frames_total 4
+# HELP refresh_seconds Refresh time.
+# TYPE refresh_seconds histogram
+refresh_seconds_bucket{mode="partial",le="0.1"} 2
+refresh_seconds_bucket{mode="partial",le="0.5"} 3
+refresh_seconds_bucket{mode="partial",le="1"} 4
+refresh_seconds_bucket{mode="partial",le="+Inf"} 5
+refresh_seconds_sum{mode="partial"} 3.15
+refresh_seconds_count{mode="partial"} 5
+refresh_seconds_bucket{le="1"} 1
+refresh_seconds_bucket{le="+Inf"} 1
+refresh_seconds_sum 0.5
+refresh_seconds_count 1
+# HELP temperature_celsius Panel temperature.
+# TYPE temperature_celsius gauge
+temperature_celsius{panel="0"} 21.5
+`
+	var buf bytes.Buffer
+	n, err := r.WriteTo(&buf)
+	if err != nil || n != int64(buf.Len()) {
+		t.Fatalf("wrote %d of %d bytes: %v", n, buf.Len(), err)
+	}
+	if buf.String() != want {
+		t.Fatalf("got\n%s\nwant\n%s", buf.String(), want)
+	}
+
+	rec := httptest.NewRecorder()
+	r.ServeHTTP(rec, httptest.NewRequest("GET", "/metrics", nil))
+	if rec.Body.String() != want || !strings.HasPrefix(rec.Header().Get("Content-Type"), "text/plain; version=0.0.4") {
+		t.Fatalf("served %q as %q", rec.Body.String(), rec.Header().Get("Content-Type"))
+	}
+}
+
+func TestHistogramClampsToCount(t *testing.T) {
+	r := NewRegistry()
+	h := r.Histogram("h", "h", "", []float64{1, 2})
+	h.Observe(.5)
+	// A scrape that reads count before a racing Observe lands in a bucket
+	h.buckets[1].Add(1)
+	var buf bytes.Buffer
+	r.WriteTo(&buf)
+	if !strings.Contains(buf.String(), "h_bucket{le=\"2\"} 1\nh_bucket{le=\"+Inf\"} 1\n") {
+		t.Fatalf("bucket above the count:\n%s", buf.String())
+	}
+}
+
+func TestKindConflictPanics(t *testing.T) {
+	r := NewRegistry()
+	r.Counter("x", "x", `a="1"`)
+	r.Counter("x", "x", `a="2"`) // another series of the same kind is fine
+	defer func() {
+		if recover() == nil {
+			t.Fatal("registering x as a gauge too did not panic")
+		}
+	}()
+	r.GaugeFunc("x", "x", "", func() float64 { return 0 })
+}
@@ -58,6 +58,12 @@ func CountdownTargets(now time.Time) (int, int, int) {
 	return daysMonth, daysSummer, daysTarget
 }
 
+// NextChange returns when BuildLines output next changes: every countdown
+// is counted in whole days, so at the next local midnight.
+func NextChange(now time.Time) time.Time {
+	return time.Date(now.Year(), now.Month(), now.Day()+1, 0, 0, 0, 0, now.Location())
+}
+
 func BuildLines(now time.Time, _ time.Time) []string {
 	daysMonth, daysSummer, daysTarget := CountdownTargets(now)
 	daysQuarter := DaysUntil(endOfQuarter(now))
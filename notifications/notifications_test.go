@@ -0,0 +1,14 @@
+package notifications
+
+import (
+	"testing"
+	"time"
+)
+
+func BenchmarkBuildLines(b *testing.B) {
+	now := time.Date(2026, time.March, 14, 9, 30, 0, 0, time.Local)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		BuildLines(now, now)
+	}
+}
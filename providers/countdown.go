@@ -0,0 +1,39 @@
+package providers
+
+import (
+	"time"
+
+	"jarvis/notifications"
+)
+
+// Countdown shows the days left until the end of the month, quarter and the
+// other notification targets.
+type Countdown struct {
+	FontHeight int
+	// LastFetch reports when quotes were last fetched
+	LastFetch func() time.Time
+}
+
+func (c *Countdown) Name() string {
+	return "countdown"
+}
+
+func (c *Countdown) Render(now time.Time) Content {
+	var lastFetch time.Time
+	if c.LastFetch != nil {
+		lastFetch = c.LastFetch()
+	}
+	return Content{
+		Lines:      notifications.BuildLines(now, lastFetch),
+		FontHeight: c.FontHeight,
+	}
+}
+
+func (c *Countdown) NextChange(now time.Time) time.Time {
+	return notifications.NextChange(now)
+}
+
+// Version is the local calendar day, since every countdown moves at midnight.
+func (c *Countdown) Version(now time.Time) uint64 {
+	return uint64(now.Year())*1000 + uint64(now.YearDay())
+}
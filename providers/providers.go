@@ -0,0 +1,83 @@
+// Package providers defines the screens the display rotates through.
+//
+// A Provider renders its content, says when that content next changes and
+// exposes a version that moves whenever a new render would differ. The
+// Registry keeps each provider's last render and hands it back until the
+// version changes, so a screen that has nothing new costs nothing to show.
+package providers
+
+import (
+	"time"
+
+	"jarvis/schedule"
+)
+
+// Content is one rendered screen.
+type Content struct {
+	Lines      []string
+	FontHeight int
+}
+
+// Provider is a source of screen content.
+type Provider interface {
+	// Name identifies the provider in logs.
+	Name() string
+	// Render produces the content as of now.
+	Render(now time.Time) Content
+	// NextChange is the first time after now at which Version changes on
+	// its own, or the zero time if it only changes on outside events.
+	NextChange(now time.Time) time.Time
+	// Version changes whenever Render would return something different.
+	Version(now time.Time) uint64
+}
+
+type entry struct {
+	provider Provider
+	cached   bool
+	version  uint64
+	content  Content
+}
+
+// Registry holds the providers in rotation order along with their cached
+// renders. It is not safe for concurrent use.
+type Registry struct {
+	entries []entry
+}
+
+// Register appends p to the rotation and returns its index.
+func (r *Registry) Register(p Provider) int {
+	r.entries = append(r.entries, entry{provider: p})
+	return len(r.entries) - 1
+}
+
+// Len returns the number of registered providers.
+func (r *Registry) Len() int {
+	return len(r.entries)
+}
+
+// Provider returns the provider at index i.
+func (r *Registry) Provider(i int) Provider {
+	return r.entries[i].provider
+}
+
+// Sources returns the providers as scheduler sources, in rotation order.
+func (r *Registry) Sources() []schedule.Source {
+	sources := make([]schedule.Source, len(r.entries))
+	for i := range r.entries {
+		sources[i] = r.entries[i].provider
+	}
+	return sources
+}
+
+// Render returns provider i's content, re-rendering only when its version
+// moved since the last call.
+func (r *Registry) Render(i int, now time.Time) Content {
+	e := &r.entries[i]
+	v := e.provider.Version(now)
+	if !e.cached || e.version != v {
+		e.content = e.provider.Render(now)
+		e.version = v
+		e.cached = true
+	}
+	return e.content
+}
@@ -0,0 +1,80 @@
+package providers
+
+import (
+	"fmt"
+	"testing"
+	"time"
+)
+
+// fake counts renders and returns its version in the content.
+type fake struct {
+	version uint64
+	renders int
+}
+
+func (f *fake) Name() string                       { return "fake" }
+func (f *fake) NextChange(now time.Time) time.Time { return time.Time{} }
+func (f *fake) Version(now time.Time) uint64       { return f.version }
+
+func (f *fake) Render(now time.Time) Content {
+	f.renders++
+	return Content{Lines: []string{fmt.Sprint(f.version)}}
+}
+
+func TestRegistryRendersOncePerVersion(t *testing.T) {
+	var r Registry
+	a, b := &fake{}, &fake{version: 7}
+	ia, ib := r.Register(a), r.Register(b)
+	now := time.Date(2026, 3, 1, 12, 0, 0, 0, time.UTC)
+
+	for i := 0; i < 3; i++ {
+		r.Render(ia, now)
+		r.Render(ib, now)
+	}
+	if a.renders != 1 || b.renders != 1 {
+		t.Fatalf("renders %d and %d for unchanged versions, want 1 each", a.renders, b.renders)
+	}
+
+	a.version++
+	for i := 0; i < 3; i++ {
+		if c := r.Render(ia, now); c.Lines[0] != "1" {
+			t.Fatalf("stale content %q after the version moved", c.Lines)
+		}
+	}
+	if a.renders != 2 || b.renders != 1 {
+		t.Fatalf("renders %d and %d after one version change, want 2 and 1", a.renders, b.renders)
+	}
+	// Going back to an earlier version is a change too
+	a.version--
+	r.Render(ia, now)
+	if a.renders != 3 {
+		t.Fatalf("renders %d after the version moved back, want 3", a.renders)
+	}
+}
+
+func TestCountdownVersionAtMidnight(t *testing.T) {
+	// East of UTC, so the local day differs from the UTC one in the evening
+	loc := time.FixedZone("UTC+9", 9*3600)
+	var c Countdown
+	for _, now := range []time.Time{
+		time.Date(2026, 3, 1, 12, 0, 0, 0, loc),
+		time.Date(2026, 3, 1, 0, 0, 0, 0, loc),
+		time.Date(2026, 2, 28, 23, 59, 59, 0, loc),
+		time.Date(2028, 2, 28, 18, 0, 0, 0, loc),
+		time.Date(2026, 12, 31, 23, 0, 0, 0, loc),
+		time.Date(2026, 6, 30, 20, 0, 0, 0, time.UTC).In(loc),
+	} {
+		next := c.NextChange(now)
+		want := time.Date(now.Year(), now.Month(), now.Day()+1, 0, 0, 0, 0, loc)
+		if !next.Equal(want) {
+			t.Errorf("%v: next change %v, want local midnight %v", now, next, want)
+		}
+		v := c.Version(now)
+		if c.Version(next.Add(-time.Nanosecond)) != v {
+			t.Errorf("%v: version moved before %v", now, next)
+		}
+		if c.Version(next) == v {
+			t.Errorf("%v: version unchanged at %v", now, next)
+		}
+	}
+}
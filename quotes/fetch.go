@@ -0,0 +1,237 @@
+package quotes
+
+import (
+	"compress/gzip"
+	"context"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"net/http"
+	"os"
+	"path/filepath"
+	"time"
+)
+
+const (
+	fetchTimeout    = 30 * time.Second
+	fetchAttempts   = 4
+	fetchBackoff    = 5 * time.Second
+	fetchBackoffMax = 2 * time.Minute
+)
+
+// FetchObserver is called after each fetch attempt. err is nil or
+// ErrNotModified when the attempt succeeded.
+type FetchObserver func(d time.Duration, err error)
+
+// ErrNotModified is returned by Fetch when the endpoint reports that the
+// cached quotes are still current.
+var ErrNotModified = errors.New("quotes not modified")
+
+// Fetcher downloads the quote corpus into a cache file. It remembers the
+// ETag and Last-Modified validators in a sidecar next to the cache and sends
+// them back, so an unchanged corpus costs a single 304.
+type Fetcher struct {
+	Client *http.Client
+	URL    string
+}
+
+// cacheMeta is stored as <cache>.meta alongside the cache file.
+type cacheMeta struct {
+	ETag         string `json:"etag,omitempty"`
+	LastModified string `json:"lastModified,omitempty"`
+}
+
+var defaultFetcher = &Fetcher{
+	Client: &http.Client{Timeout: fetchTimeout},
+	URL:    endpoint,
+}
+
+func metaPath(path string) string {
+	return path + ".meta"
+}
+
+// readMeta returns the stored validators, or none when the cache they
+// describe is missing.
+func readMeta(path string) cacheMeta {
+	var meta cacheMeta
+	if _, err := os.Stat(path); err != nil {
+		return meta
+	}
+	data, err := os.ReadFile(metaPath(path))
+	if err != nil {
+		return meta
+	}
+	if err := json.Unmarshal(data, &meta); err != nil {
+		return cacheMeta{}
+	}
+	return meta
+}
+
+func writeMeta(path string, meta cacheMeta) error {
+	if meta.ETag == "" && meta.LastModified == "" {
+		err := os.Remove(metaPath(path))
+		if errors.Is(err, os.ErrNotExist) {
+			return nil
+		}
+		return err
+	}
+	data, err := json.Marshal(meta)
+	if err != nil {
+		return err
+	}
+	return writeFileAtomic(metaPath(path), func(w io.Writer) error {
+		_, err := w.Write(data)
+		return err
+	})
+}
+
+// writeFileAtomic fills a temporary file next to path and renames it into
+// place, so readers never see a partial file. The file keeps the mode of the
+// one it replaces, or gets 0644 rather than CreateTemp's 0600.
+func writeFileAtomic(path string, fill func(io.Writer) error) error {
+	tmp, err := os.CreateTemp(filepath.Dir(path), filepath.Base(path)+".*.tmp")
+	if err != nil {
+		return err
+	}
+	defer os.Remove(tmp.Name())
+	mode := os.FileMode(0o644)
+	if fi, err := os.Stat(path); err == nil {
+		mode = fi.Mode().Perm()
+	}
+	if err := tmp.Chmod(mode); err != nil {
+		tmp.Close()
+		return err
+	}
+	if err := fill(tmp); err != nil {
+		tmp.Close()
+		return err
+	}
+	if err := tmp.Close(); err != nil {
+		return err
+	}
+	return os.Rename(tmp.Name(), path)
+}
+
+// Fetch downloads the quotes into path and returns them. The body is decoded
+// as it streams in while a copy goes to a temporary file, which only replaces
+// the cache once the JSON parsed. Returns ErrNotModified on a 304.
+func (f *Fetcher) Fetch(ctx context.Context, path string) ([]Quote, error) {
+	req, err := http.NewRequestWithContext(ctx, http.MethodGet, f.URL, nil)
+	if err != nil {
+		return nil, err
+	}
+	meta := readMeta(path)
+	if meta.ETag != "" {
+		req.Header.Set("If-None-Match", meta.ETag)
+	}
+	if meta.LastModified != "" {
+		req.Header.Set("If-Modified-Since", meta.LastModified)
+	}
+	// Asking explicitly keeps compression on even with a custom Transport,
+	// but it also means decoding the body is up to us.
+	req.Header.Set("Accept-Encoding", "gzip")
+
+	client := f.Client
+	if client == nil {
+		client = http.DefaultClient
+	}
+	resp, err := client.Do(req)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+
+	switch resp.StatusCode {
+	case http.StatusOK:
+	case http.StatusNotModified:
+		// Bump the mtime so LoadFromFile reports when we last checked
+		now := time.Now()
+		os.Chtimes(path, now, now)
+		return nil, ErrNotModified
+	default:
+		return nil, fmt.Errorf("bad status: %s", resp.Status)
+	}
+
+	var body io.Reader = resp.Body
+	if resp.Header.Get("Content-Encoding") == "gzip" {
+		zr, err := gzip.NewReader(resp.Body)
+		if err != nil {
+			return nil, err
+		}
+		defer zr.Close()
+		body = zr
+	}
+
+	var qs []Quote
+	err = writeFileAtomic(path, func(w io.Writer) error {
+		dec := json.NewDecoder(io.TeeReader(body, w))
+		if err := dec.Decode(&qs); err != nil {
+			return err
+		}
+		// Read to the end so the whole body lands in the cache, and refuse
+		// anything but whitespace after the value: LoadFromFile would reject
+		// such a cache on the next start
+		tok, err := dec.Token()
+		switch {
+		case err == io.EOF:
+			return nil
+		case err != nil:
+			return err
+		}
+		return fmt.Errorf("unexpected %v after the quotes", tok)
+	})
+	if err != nil {
+		return nil, err
+	}
+
+	meta = cacheMeta{
+		ETag:         resp.Header.Get("ETag"),
+		LastModified: resp.Header.Get("Last-Modified"),
+	}
+	if err := writeMeta(path, meta); err != nil {
+		return nil, err
+	}
+	return qs, nil
+}
+
+// FetchToFile downloads the quotes to path unless the cached copy is current.
+func FetchToFile(ctx context.Context, path string) error {
+	_, err := defaultFetcher.Fetch(ctx, path)
+	if errors.Is(err, ErrNotModified) {
+		return nil
+	}
+	return err
+}
+
+// fetchWithRetry retries Fetch with exponential backoff until it succeeds,
+// the attempts run out or ctx is cancelled. A 304 is not retried. observe,
+// if set, is told the duration and outcome of every attempt.
+func (f *Fetcher) fetchWithRetry(ctx context.Context, path string, observe FetchObserver) ([]Quote, error) {
+	delay := fetchBackoff
+	var err error
+	for attempt := 1; attempt <= fetchAttempts; attempt++ {
+		var qs []Quote
+		start := time.Now()
+		qs, err = f.Fetch(ctx, path)
+		if observe != nil {
+			observe(time.Since(start), err)
+		}
+		if err == nil || errors.Is(err, ErrNotModified) {
+			return qs, err
+		}
+		if attempt == fetchAttempts {
+			break
+		}
+		select {
+		case <-ctx.Done():
+			return nil, ctx.Err()
+		case <-time.After(delay):
+		}
+		delay *= 2
+		if delay > fetchBackoffMax {
+			delay = fetchBackoffMax
+		}
+	}
+	return nil, fmt.Errorf("fetch failed after %d attempts: %w", fetchAttempts, err)
+}
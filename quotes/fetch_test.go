@@ -0,0 +1,209 @@
+package quotes
+
+import (
+	"compress/gzip"
+	"context"
+	"errors"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+const testCorpus = `[{"quote":"Simplicity is prerequisite for reliability.","author":"Edsger W. Dijkstra"}]`
+
+const (
+	testETag         = `"v1"`
+	testLastModified = "Wed, 01 Jan 2025 00:00:00 GMT"
+)
+
+// fetchServer serves handler until the test ends.
+func fetchServer(t *testing.T, handler http.HandlerFunc) *httptest.Server {
+	t.Helper()
+	srv := httptest.NewServer(handler)
+	t.Cleanup(srv.Close)
+	return srv
+}
+
+// conditional serves body with validators, answering 304 when the request
+// carries both of them back.
+func conditional(body string) http.HandlerFunc {
+	return func(w http.ResponseWriter, r *http.Request) {
+		if r.Header.Get("If-None-Match") == testETag && r.Header.Get("If-Modified-Since") == testLastModified {
+			w.WriteHeader(http.StatusNotModified)
+			return
+		}
+		w.Header().Set("ETag", testETag)
+		w.Header().Set("Last-Modified", testLastModified)
+		w.Write([]byte(body))
+	}
+}
+
+func fetcher(srv *httptest.Server) *Fetcher {
+	return &Fetcher{Client: srv.Client(), URL: srv.URL}
+}
+
+func TestFetchWritesCacheAndMeta(t *testing.T) {
+	srv := fetchServer(t, conditional(testCorpus))
+	path := filepath.Join(t.TempDir(), "quotes.json")
+
+	qs, err := fetcher(srv).Fetch(context.Background(), path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(qs) != 1 || qs[0].Author != "Edsger W. Dijkstra" {
+		t.Fatalf("got %+v", qs)
+	}
+	data, err := os.ReadFile(path)
+	if err != nil || string(data) != testCorpus {
+		t.Fatalf("cache %q, %v", data, err)
+	}
+	if meta := readMeta(path); meta.ETag != testETag || meta.LastModified != testLastModified {
+		t.Fatalf("meta %+v", meta)
+	}
+	if cached, _, err := LoadFromFile(path); err != nil || len(cached) != 1 {
+		t.Fatalf("LoadFromFile: %d quotes, %v", len(cached), err)
+	}
+	for _, p := range []string{path, metaPath(path)} {
+		if fi, err := os.Stat(p); err != nil || fi.Mode().Perm() != 0o644 {
+			t.Fatalf("%s: mode %v, %v", p, fi.Mode(), err)
+		}
+	}
+}
+
+func TestWriteFileAtomicKeepsMode(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "quotes.json")
+	if err := os.WriteFile(path, []byte("old"), 0o600); err != nil {
+		t.Fatal(err)
+	}
+	if err := os.Chmod(path, 0o640); err != nil {
+		t.Fatal(err)
+	}
+	err := writeFileAtomic(path, func(w io.Writer) error {
+		_, err := io.WriteString(w, "new")
+		return err
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	fi, err := os.Stat(path)
+	if err != nil || fi.Mode().Perm() != 0o640 {
+		t.Fatalf("mode %v, %v; want the replaced file's 0640", fi.Mode(), err)
+	}
+}
+
+func TestFetchNotModified(t *testing.T) {
+	srv := fetchServer(t, conditional(testCorpus))
+	path := filepath.Join(t.TempDir(), "quotes.json")
+	f := fetcher(srv)
+	if _, err := f.Fetch(context.Background(), path); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := f.Fetch(context.Background(), path); !errors.Is(err, ErrNotModified) {
+		t.Fatalf("second fetch: %v, want ErrNotModified", err)
+	}
+	if data, _ := os.ReadFile(path); string(data) != testCorpus {
+		t.Fatalf("cache changed to %q", data)
+	}
+}
+
+func TestFetchWithoutCacheSendsNoValidators(t *testing.T) {
+	srv := fetchServer(t, func(w http.ResponseWriter, r *http.Request) {
+		if r.Header.Get("If-None-Match") != "" || r.Header.Get("If-Modified-Since") != "" {
+			t.Errorf("validators sent without a cache")
+		}
+		w.Write([]byte(testCorpus))
+	})
+	path := filepath.Join(t.TempDir(), "quotes.json")
+	// A meta file left behind without its cache is ignored
+	os.WriteFile(metaPath(path), []byte(`{"etag":"\"stale\""}`), 0o644)
+	if _, err := fetcher(srv).Fetch(context.Background(), path); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := os.Stat(metaPath(path)); !os.IsNotExist(err) {
+		t.Errorf("meta kept for a response without validators: %v", err)
+	}
+}
+
+func TestFetchGzip(t *testing.T) {
+	srv := fetchServer(t, func(w http.ResponseWriter, r *http.Request) {
+		if r.Header.Get("Accept-Encoding") != "gzip" {
+			t.Errorf("Accept-Encoding %q", r.Header.Get("Accept-Encoding"))
+		}
+		w.Header().Set("Content-Encoding", "gzip")
+		zw := gzip.NewWriter(w)
+		zw.Write([]byte(testCorpus))
+		zw.Close()
+	})
+	path := filepath.Join(t.TempDir(), "quotes.json")
+	qs, err := fetcher(srv).Fetch(context.Background(), path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(qs) != 1 {
+		t.Fatalf("got %+v", qs)
+	}
+	if data, _ := os.ReadFile(path); string(data) != testCorpus {
+		t.Fatalf("cache %q, want the decoded body", data)
+	}
+}
+
+func TestFetchBadBodyKeepsCache(t *testing.T) {
+	bodies := map[string]string{
+		"malformed": `[{"quote":"cut off`,
+		"trailing":  testCorpus + ` garbage`,
+		"second":    testCorpus + `[]`,
+	}
+	for name, body := range bodies {
+		t.Run(name, func(t *testing.T) {
+			srv := fetchServer(t, func(w http.ResponseWriter, r *http.Request) {
+				w.Write([]byte(body))
+			})
+			dir := t.TempDir()
+			path := filepath.Join(dir, "quotes.json")
+			if err := os.WriteFile(path, []byte(testCorpus), 0o644); err != nil {
+				t.Fatal(err)
+			}
+			if _, err := fetcher(srv).Fetch(context.Background(), path); err == nil {
+				t.Fatal("bad body accepted")
+			}
+			if data, _ := os.ReadFile(path); string(data) != testCorpus {
+				t.Fatalf("cache changed to %q", data)
+			}
+			// No temporary file is left next to the cache
+			if entries, _ := os.ReadDir(dir); len(entries) != 1 {
+				t.Fatalf("%d files in the cache directory", len(entries))
+			}
+		})
+	}
+}
+
+func TestFetchTrailingWhitespace(t *testing.T) {
+	srv := fetchServer(t, func(w http.ResponseWriter, r *http.Request) {
+		w.Write([]byte(testCorpus + "\n\t "))
+	})
+	path := filepath.Join(t.TempDir(), "quotes.json")
+	if _, err := fetcher(srv).Fetch(context.Background(), path); err != nil {
+		t.Fatal(err)
+	}
+	if _, _, err := LoadFromFile(path); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestFetchBadStatus(t *testing.T) {
+	for _, code := range []int{http.StatusNotFound, http.StatusInternalServerError} {
+		srv := fetchServer(t, func(w http.ResponseWriter, r *http.Request) {
+			http.Error(w, "nope", code)
+		})
+		path := filepath.Join(t.TempDir(), "quotes.json")
+		if _, err := fetcher(srv).Fetch(context.Background(), path); err == nil {
+			t.Errorf("status %d accepted", code)
+		}
+		if _, err := os.Stat(path); !os.IsNotExist(err) {
+			t.Errorf("status %d wrote a cache", code)
+		}
+	}
+}
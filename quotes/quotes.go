@@ -1,17 +1,19 @@
 package quotes
 
 import (
+	"context"
 	"encoding/json"
+	"errors"
 	"fmt"
-	"io"
 	"math/rand/v2"
-	"net/http"
 	"os"
+	"sync/atomic"
 	"time"
 )
 
 const (
 	cachePath = "quotes.json"
+	storePath = "quotes.bin"
 	endpoint  = "https://gist.githubusercontent.com/sjdonado/66c22e7fafe4505bcbd7a167249bfd5f/raw/quotes.json"
 )
 
@@ -20,58 +22,117 @@ type Quote struct {
 	Author string `json:"author"`
 }
 
-type Rotator struct {
-	quotes    []Quote
-	remaining []int
-	shuffled  bool
-	LastFetch time.Time
+// quoteSet is what a corpus draws from: normally a mapped Store, or a plain
+// slice for the placeholder and when the store cannot be written.
+type quoteSet interface {
+	Len() int
+	At(i int) Quote
 }
 
-func NewRotator(qs []Quote) *Rotator {
-	if len(qs) == 0 {
-		return &Rotator{
-			quotes:    []Quote{{Quote: "No quotes available", Author: ""}},
-			remaining: []int{0},
-			shuffled:  true,
-			LastFetch: time.Time{},
+type quoteSlice []Quote
+
+func (qs quoteSlice) Len() int       { return len(qs) }
+func (qs quoteSlice) At(i int) Quote { return qs[i] }
+
+// corpus is an immutable set of quotes. Refreshes build a new one and swap
+// it in, so readers never see a half-loaded list.
+type corpus struct {
+	set       quoteSet
+	lastFetch time.Time
+}
+
+// permutation visits 0..n-1 in shuffled order without an index slice, using
+// i -> (a*i + b) mod n with a coprime to n, so memory stays constant however
+// large the corpus is.
+type permutation struct {
+	n, a, b, i uint64
+}
+
+func gcd(a, b uint64) uint64 {
+	for b != 0 {
+		a, b = b, a%b
+	}
+	return a
+}
+
+func newPermutation(n int) permutation {
+	p := permutation{n: uint64(n), a: 1}
+	if n <= 1 {
+		return p
+	}
+	for {
+		p.a = rand.Uint64N(p.n-1) + 1
+		if gcd(p.a, p.n) == 1 {
+			break
 		}
 	}
+	p.b = rand.Uint64N(p.n)
+	return p
+}
 
-	indices := make([]int, len(qs))
-	for i := range indices {
-		indices[i] = i
+func (p *permutation) next() (int, bool) {
+	if p.i >= p.n {
+		return 0, false
 	}
+	idx := (p.a*p.i + p.b) % p.n
+	p.i++
+	return int(idx), true
+}
+
+// Rotator hands out quotes in shuffled order. NextQuote must be called from a
+// single goroutine; Refresh and StartRefresh may run concurrently with it.
+type Rotator struct {
+	corpus     atomic.Pointer[corpus]
+	refreshing atomic.Bool
+
+	// OnFetch, if set, observes each fetch attempt made by Refresh. It runs
+	// on the refreshing goroutine.
+	OnFetch FetchObserver
+
+	// rotation state, owned by the NextQuote caller
+	current *corpus
+	cycle   permutation
+}
 
-	return &Rotator{
-		quotes:    qs,
-		remaining: indices,
-		shuffled:  false,
-		LastFetch: time.Now(),
+func NewRotator(qs []Quote) *Rotator {
+	r := &Rotator{}
+	if len(qs) == 0 {
+		r.publish(quoteSlice{{Quote: "No quotes available", Author: ""}}, time.Time{})
+		return r
 	}
+	r.publish(quoteSlice(qs), time.Now())
+	return r
+}
+
+func (qr *Rotator) publish(set quoteSet, lastFetch time.Time) {
+	qr.corpus.Store(&corpus{set: set, lastFetch: lastFetch})
+}
+
+// Len returns the number of quotes in rotation. Safe for concurrent use.
+func (qr *Rotator) Len() int {
+	return qr.corpus.Load().set.Len()
+}
+
+// LastFetch reports when the quotes currently in rotation were fetched.
+func (qr *Rotator) LastFetch() time.Time {
+	return qr.corpus.Load().lastFetch
 }
 
 func (qr *Rotator) NextQuote() Quote {
-	if len(qr.remaining) == 0 {
-		// Restart cycle
-		qr.remaining = make([]int, len(qr.quotes))
-		for i := range qr.remaining {
-			qr.remaining[i] = i
-		}
-		qr.shuffled = false
+	c := qr.corpus.Load()
+	if c != qr.current {
+		// A refresh published new quotes; start a fresh cycle over them
+		qr.current = c
+		qr.cycle = permutation{}
 	}
 
-	if !qr.shuffled {
-		rand.Shuffle(len(qr.remaining), func(i, j int) {
-			qr.remaining[i], qr.remaining[j] = qr.remaining[j], qr.remaining[i]
-		})
-		qr.shuffled = true
+	idx, ok := qr.cycle.next()
+	if !ok {
+		// Restart cycle
+		qr.cycle = newPermutation(c.set.Len())
+		idx, _ = qr.cycle.next()
 	}
-
-	// Pick next quote from remaining
-	idx := qr.remaining[0]
-	qr.remaining = qr.remaining[1:]
-
-	return qr.quotes[idx]
+	return c.set.At(idx)
 }
 
 func LoadFromFile(path string) ([]Quote, time.Time, error) {
@@ -90,61 +151,137 @@ func LoadFromFile(path string) ([]Quote, time.Time, error) {
 	return qs, mod, nil
 }
 
-func FetchToFile(path string) error {
-	resp, err := http.Get(endpoint)
+// storeQuotes converts qs into the binary store and maps it.
+func storeQuotes(qs []Quote) (*Store, error) {
+	if err := BuildStore(storePath, qs); err != nil {
+		return nil, err
+	}
+	return OpenStore(storePath)
+}
+
+// openCachedStore maps the binary store, first rebuilding it from the JSON
+// cache when it is missing or older than the cache.
+func openCachedStore() (*Store, time.Time, error) {
+	jsonInfo, jsonErr := os.Stat(cachePath)
+	if info, err := os.Stat(storePath); err == nil && (jsonErr != nil || !info.ModTime().Before(jsonInfo.ModTime())) {
+		if s, err := OpenStore(storePath); err == nil && s.Len() > 0 {
+			return s, info.ModTime(), nil
+		}
+	}
+
+	qs, mod, err := LoadFromFile(cachePath)
 	if err != nil {
-		return err
+		return nil, time.Time{}, err
 	}
-	defer resp.Body.Close()
-	if resp.StatusCode != http.StatusOK {
-		return fmt.Errorf("bad status: %s", resp.Status)
+	if len(qs) == 0 {
+		return nil, time.Time{}, fmt.Errorf("no quotes in %s", cachePath)
 	}
-	data, err := io.ReadAll(resp.Body)
+	s, err := storeQuotes(qs)
 	if err != nil {
-		return err
+		return nil, time.Time{}, err
 	}
-	return os.WriteFile(path, data, 0644)
+	// Keep the store's mtime in step with the cache it came from
+	os.Chtimes(storePath, mod, mod)
+	return s, mod, nil
 }
 
-func LoadOrFetch() ([]Quote, time.Time, error) {
+// LoadOrFetch maps the cached quote store, fetching the corpus first when
+// there is no usable cache.
+func LoadOrFetch() (*Store, time.Time, error) {
 	// Try to load from cache first
-	qs, mod, err := LoadFromFile(cachePath)
+	s, mod, err := openCachedStore()
 	if err == nil {
-		return qs, mod, nil
+		return s, mod, nil
 	}
 
-	// If cache fails, fetch and cache
-	if fetchErr := FetchToFile(cachePath); fetchErr != nil {
-		return nil, time.Time{}, fmt.Errorf("failed to load quotes (no cache and fetch failed): %w", fetchErr)
+	// If cache fails, fetch and cache. The validators describe a cache we
+	// could not read, so drop them to force a full download.
+	os.Remove(metaPath(cachePath))
+	ctx, cancel := context.WithTimeout(context.Background(), fetchTimeout)
+	defer cancel()
+	qs, err := defaultFetcher.Fetch(ctx, cachePath)
+	if err != nil {
+		return nil, time.Time{}, fmt.Errorf("failed to load quotes (no cache and fetch failed): %w", err)
 	}
-
-	// Load the freshly fetched quotes
-	return LoadFromFile(cachePath)
+	if len(qs) == 0 {
+		return nil, time.Time{}, fmt.Errorf("no quotes in %s", cachePath)
+	}
+	s, err = storeQuotes(qs)
+	if err != nil {
+		return nil, time.Time{}, err
+	}
+	return s, time.Now(), nil
 }
 
 // NewRotatorFromCache loads quotes from cache or endpoint and returns a rotator with last fetch time set.
 func NewRotatorFromCache() (*Rotator, error) {
-	qs, mod, err := LoadOrFetch()
+	s, mod, err := LoadOrFetch()
+	if err != nil {
+		return nil, err
+	}
+	r := &Rotator{}
+	r.publish(s, mod)
+	return r, nil
+}
+
+// OpenCachedRotator loads the rotation from the on-disk cache only and never
+// touches the network, so it is fast enough to run during startup. It fails
+// when there is no usable cache; StartRefresh can then fetch one.
+func OpenCachedRotator() (*Rotator, error) {
+	s, mod, err := openCachedStore()
 	if err != nil {
 		return nil, err
 	}
-	r := NewRotator(qs)
-	r.LastFetch = mod
+	r := &Rotator{}
+	r.publish(s, mod)
 	return r, nil
 }
 
-// Refresh reloads quotes from cache/endpoint and resets rotation.
-func (qr *Rotator) Refresh() error {
-	qs, mod, err := LoadOrFetch()
+// Refresh fetches the latest quotes, falling back to the cache when the
+// endpoint is unreachable, and publishes them for the next NextQuote call.
+// It blocks on the network, so the display loop should use StartRefresh.
+func (qr *Rotator) Refresh(ctx context.Context) error {
+	qs, fetchErr := defaultFetcher.fetchWithRetry(ctx, cachePath, qr.OnFetch)
+	switch {
+	case fetchErr == nil:
+		if len(qs) == 0 {
+			return fmt.Errorf("no quotes in %s", cachePath)
+		}
+		s, err := storeQuotes(qs)
+		if err != nil {
+			// Still worth showing the new quotes from memory
+			qr.publish(quoteSlice(qs), time.Now())
+			return err
+		}
+		qr.publish(s, time.Now())
+		return nil
+	case errors.Is(fetchErr, ErrNotModified):
+		// Same quotes; only the fetch time moves, and the cycle restarts
+		// as it would for a new corpus
+		now := time.Now()
+		os.Chtimes(storePath, now, now)
+		qr.publish(qr.corpus.Load().set, now)
+		return nil
+	}
+
+	s, mod, err := openCachedStore()
 	if err != nil {
-		return err
+		return fetchErr
 	}
-	qr.quotes = qs
-	qr.remaining = make([]int, len(qs))
-	for i := range qr.remaining {
-		qr.remaining[i] = i
+	qr.publish(s, mod)
+	return fetchErr
+}
+
+// StartRefresh runs Refresh in a background goroutine and delivers its result
+// on the returned channel. It returns nil if a refresh is already running.
+func (qr *Rotator) StartRefresh(ctx context.Context) <-chan error {
+	if !qr.refreshing.CompareAndSwap(false, true) {
+		return nil
 	}
-	qr.shuffled = false
-	qr.LastFetch = mod
-	return nil
+	done := make(chan error, 1)
+	go func() {
+		defer qr.refreshing.Store(false)
+		done <- qr.Refresh(ctx)
+	}()
+	return done
 }
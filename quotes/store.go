@@ -0,0 +1,169 @@
+package quotes
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"math"
+	"os"
+	"runtime"
+	"syscall"
+)
+
+// Store file layout, all integers little-endian:
+//
+//	header   magic "JQTS" | u32 version | u32 count | u32 reserved
+//	offsets  (2*count+1) x u32, relative to the start of the string data;
+//	         quote i spans [2i, 2i+1) and its author [2i+1, 2i+2)
+//	data     quote and author bytes back to back
+const (
+	storeMagic      = "JQTS"
+	storeVersion    = 1
+	storeHeaderSize = 16
+)
+
+var errBadStore = errors.New("malformed quote store")
+
+// Store is a read-only, memory-mapped quote corpus. Quotes are decoded on
+// demand, so opening a store costs the same whatever its size and only the
+// pages actually read become resident.
+type Store struct {
+	data    []byte
+	count   int
+	offsets []byte
+	strings []byte
+}
+
+// BuildStore writes qs to path in the store format. The file is replaced
+// atomically, so a Store already mapped from path keeps its old contents.
+func BuildStore(path string, qs []Quote) error {
+	var size uint64
+	for _, q := range qs {
+		size += uint64(len(q.Quote) + len(q.Author))
+	}
+	if size > math.MaxUint32 || len(qs) > (math.MaxUint32-1)/2 {
+		return fmt.Errorf("quote store: corpus too large (%d quotes, %d bytes)", len(qs), size)
+	}
+
+	return writeFileAtomic(path, func(w io.Writer) error {
+		bw := bufio.NewWriter(w)
+		var hdr [storeHeaderSize]byte
+		copy(hdr[:4], storeMagic)
+		binary.LittleEndian.PutUint32(hdr[4:], storeVersion)
+		binary.LittleEndian.PutUint32(hdr[8:], uint32(len(qs)))
+		bw.Write(hdr[:])
+
+		var word [4]byte
+		var off uint32
+		putOffset := func() {
+			binary.LittleEndian.PutUint32(word[:], off)
+			bw.Write(word[:])
+		}
+		for _, q := range qs {
+			putOffset()
+			off += uint32(len(q.Quote))
+			putOffset()
+			off += uint32(len(q.Author))
+		}
+		putOffset()
+
+		for _, q := range qs {
+			bw.WriteString(q.Quote)
+			bw.WriteString(q.Author)
+		}
+		return bw.Flush()
+	})
+}
+
+// OpenStore maps the store at path. The mapping is released by Close, or by
+// the garbage collector once the Store is unreachable.
+func OpenStore(path string) (*Store, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	size := fi.Size()
+	if size < storeHeaderSize || size > math.MaxInt32 {
+		return nil, fmt.Errorf("%s: %w", path, errBadStore)
+	}
+
+	data, err := syscall.Mmap(int(f.Fd()), 0, int(size), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("mmap %s: %w", path, err)
+	}
+
+	s, err := newStore(data)
+	if err != nil {
+		syscall.Munmap(data)
+		return nil, fmt.Errorf("%s: %w", path, err)
+	}
+	runtime.SetFinalizer(s, (*Store).Close)
+	return s, nil
+}
+
+func newStore(data []byte) (*Store, error) {
+	if string(data[:4]) != storeMagic {
+		return nil, errBadStore
+	}
+	if binary.LittleEndian.Uint32(data[4:]) != storeVersion {
+		return nil, fmt.Errorf("unsupported quote store version %d", binary.LittleEndian.Uint32(data[4:]))
+	}
+	count := uint64(binary.LittleEndian.Uint32(data[8:]))
+	tableEnd := storeHeaderSize + (2*count+1)*4
+	if tableEnd > uint64(len(data)) {
+		return nil, errBadStore
+	}
+	s := &Store{
+		data:    data,
+		count:   int(count),
+		offsets: data[storeHeaderSize:tableEnd],
+		strings: data[tableEnd:],
+	}
+	if s.offset(2*s.count) > uint32(len(s.strings)) {
+		return nil, errBadStore
+	}
+	return s, nil
+}
+
+func (s *Store) offset(i int) uint32 {
+	return binary.LittleEndian.Uint32(s.offsets[i*4:])
+}
+
+// field copies string j out of the mapping; a corrupt range reads as empty.
+func (s *Store) field(j int) string {
+	start, end := s.offset(j), s.offset(j+1)
+	if start > end || end > uint32(len(s.strings)) {
+		return ""
+	}
+	return string(s.strings[start:end])
+}
+
+// Len returns the number of quotes in the store.
+func (s *Store) Len() int {
+	return s.count
+}
+
+// At returns quote i. The strings are copies, so they stay valid after the
+// store is closed.
+func (s *Store) At(i int) Quote {
+	return Quote{Quote: s.field(2 * i), Author: s.field(2*i + 1)}
+}
+
+// Close unmaps the store. It is safe to call more than once.
+func (s *Store) Close() error {
+	if s.data == nil {
+		return nil
+	}
+	runtime.SetFinalizer(s, nil)
+	err := syscall.Munmap(s.data)
+	s.data, s.offsets, s.strings, s.count = nil, nil, nil, 0
+	return err
+}
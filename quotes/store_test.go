@@ -0,0 +1,135 @@
+package quotes
+
+import (
+	"encoding/binary"
+	"errors"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+var storeQuotesFixture = []Quote{
+	{Quote: "Simplicity is prerequisite for reliability.", Author: "Edsger W. Dijkstra"},
+	{Quote: "", Author: ""},
+	{Quote: "Der Weg ist das Ziel — 道可道，非常道", Author: "Laozi 老子"},
+	{Quote: "No author", Author: ""},
+}
+
+// buildStoreBytes writes qs with BuildStore and returns the file contents.
+func buildStoreBytes(t *testing.T, qs []Quote) []byte {
+	t.Helper()
+	path := filepath.Join(t.TempDir(), "quotes.bin")
+	if err := BuildStore(path, qs); err != nil {
+		t.Fatal(err)
+	}
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return data
+}
+
+func TestStoreRoundTrip(t *testing.T) {
+	for _, qs := range [][]Quote{storeQuotesFixture, nil} {
+		path := filepath.Join(t.TempDir(), "quotes.bin")
+		if err := BuildStore(path, qs); err != nil {
+			t.Fatal(err)
+		}
+		s, err := OpenStore(path)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if s.Len() != len(qs) {
+			t.Fatalf("Len %d, want %d", s.Len(), len(qs))
+		}
+		got := make([]Quote, s.Len())
+		for i := range got {
+			got[i] = s.At(i)
+		}
+		if err := s.Close(); err != nil {
+			t.Fatal(err)
+		}
+		// The quotes are copies, so they outlive the mapping
+		for i, q := range qs {
+			if got[i] != q {
+				t.Errorf("quote %d: %q, want %q", i, got[i], q)
+			}
+		}
+		if err := s.Close(); err != nil {
+			t.Errorf("second Close: %v", err)
+		}
+	}
+}
+
+func TestStoreRejectsMalformed(t *testing.T) {
+	good := buildStoreBytes(t, storeQuotesFixture)
+	tableEnd := storeHeaderSize + (2*len(storeQuotesFixture)+1)*4
+	for _, tc := range []struct {
+		name  string
+		edit  func([]byte) []byte
+		isBad bool // errBadStore rather than another error
+	}{
+		{"magic", func(b []byte) []byte { b[0] = 'X'; return b }, true},
+		{"version", func(b []byte) []byte { binary.LittleEndian.PutUint32(b[4:], 2); return b }, false},
+		{"count past EOF", func(b []byte) []byte { binary.LittleEndian.PutUint32(b[8:], 1000); return b }, true},
+		{"table cut short", func(b []byte) []byte { return b[:tableEnd-1] }, true},
+		{"final offset past the strings", func(b []byte) []byte {
+			binary.LittleEndian.PutUint32(b[tableEnd-4:], uint32(len(b)-tableEnd+1))
+			return b
+		}, true},
+	} {
+		data := tc.edit(append([]byte(nil), good...))
+		s, err := newStore(data)
+		if err == nil {
+			t.Errorf("%s: store accepted (%d quotes)", tc.name, s.Len())
+			continue
+		}
+		if tc.isBad != errors.Is(err, errBadStore) {
+			t.Errorf("%s: %v", tc.name, err)
+		}
+	}
+}
+
+func TestStoreCorruptOffset(t *testing.T) {
+	data := buildStoreBytes(t, storeQuotesFixture)
+	// Quote 0's end runs past the strings, and quote 2 starts after it ends
+	binary.LittleEndian.PutUint32(data[storeHeaderSize+1*4:], 1<<30)
+	binary.LittleEndian.PutUint32(data[storeHeaderSize+4*4:], 1<<20)
+	s, err := newStore(data)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if q := s.At(0); q.Quote != "" || q.Author != "" {
+		t.Errorf("quote 0 read %q past the strings", q)
+	}
+	if q := s.At(2); q.Quote != "" {
+		t.Errorf("quote 2 read %q from a reversed range", q.Quote)
+	}
+	if q := s.At(3); q != storeQuotesFixture[3] {
+		t.Errorf("quote 3 %q, want %q", q, storeQuotesFixture[3])
+	}
+}
+
+func TestPermutation(t *testing.T) {
+	for _, n := range []int{0, 1, 2, 3, 4, 7, 12, 97, 100, 101, 1024, 7919} {
+		for round := 0; round < 20; round++ {
+			p := newPermutation(n)
+			seen := make([]bool, n)
+			count := 0
+			for {
+				i, ok := p.next()
+				if !ok {
+					break
+				}
+				if i < 0 || i >= n || seen[i] {
+					t.Fatalf("n=%d a=%d b=%d: index %d out of range or repeated", n, p.a, p.b, i)
+				}
+				seen[i] = true
+				count++
+			}
+			if count != n {
+				t.Fatalf("n=%d a=%d b=%d: visited %d indices", n, p.a, p.b, count)
+			}
+		}
+	}
+}
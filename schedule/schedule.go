@@ -0,0 +1,128 @@
+// Package schedule decides when the display loop has to wake up.
+//
+// Each screen reports when its content next changes, and screens take turns
+// on the panel at a fixed rotation interval. The loop sleeps on one timer
+// until the earliest deadline and repaints only when the screen on display
+// changed, either because its content moved on or because another screen
+// rotated in.
+package schedule
+
+import "time"
+
+// DefaultSlack is how close two deadlines must be to be served by a single
+// wakeup.
+const DefaultSlack = time.Second
+
+// Source is a screen the scheduler can put on display.
+type Source interface {
+	// NextChange returns the first time after now at which the content
+	// differs from what it is at now. The zero time means the content only
+	// changes on outside events, reported through Scheduler.Invalidate.
+	NextChange(now time.Time) time.Time
+}
+
+// Scheduler tracks which source is on display and when the loop must wake.
+// It is not safe for concurrent use.
+type Scheduler struct {
+	sources []Source
+	rotate  time.Duration
+	slack   time.Duration
+
+	current    int
+	nextRotate time.Time
+	nextChange time.Time // of the source on display, zero if none
+	dirty      bool      // display does not show the current content
+}
+
+// New returns a scheduler showing sources[0] first. A rotate interval of zero
+// keeps the first source on display for good.
+func New(sources []Source, rotate, slack time.Duration, now time.Time) *Scheduler {
+	s := &Scheduler{
+		sources: sources,
+		rotate:  rotate,
+		slack:   slack,
+		dirty:   true,
+	}
+	if s.rotating() {
+		s.nextRotate = now.Add(rotate)
+	}
+	s.nextChange = s.sources[0].NextChange(now)
+	return s
+}
+
+func (s *Scheduler) rotating() bool {
+	return s.rotate > 0 && len(s.sources) > 1
+}
+
+// Current returns the index of the source that should be on display.
+func (s *Scheduler) Current() int {
+	return s.current
+}
+
+// Deadline returns when the loop should wake next, or the zero time if
+// nothing is pending. Deadlines that fall within the slack of the earliest
+// one are merged by waking at the latest of them, so a rotation and a
+// content change a moment apart cost one refresh.
+func (s *Scheduler) Deadline() time.Time {
+	var deadlines []time.Time
+	if !s.nextRotate.IsZero() {
+		deadlines = append(deadlines, s.nextRotate)
+	}
+	if !s.nextChange.IsZero() {
+		deadlines = append(deadlines, s.nextChange)
+	}
+	if len(deadlines) == 0 {
+		return time.Time{}
+	}
+
+	earliest := deadlines[0]
+	for _, d := range deadlines[1:] {
+		if d.Before(earliest) {
+			earliest = d
+		}
+	}
+	wake := earliest
+	for _, d := range deadlines {
+		if d.After(wake) && d.Sub(earliest) <= s.slack {
+			wake = d
+		}
+	}
+	return wake
+}
+
+// Advance applies every deadline that is due at now and reports whether the
+// display needs repainting. The caller must then paint Current and call
+// Painted.
+func (s *Scheduler) Advance(now time.Time) bool {
+	if !s.nextRotate.IsZero() && !now.Before(s.nextRotate) {
+		s.current = (s.current + 1) % len(s.sources)
+		s.nextRotate = s.nextRotate.Add(s.rotate)
+		if !s.nextRotate.After(now) {
+			// Woke up late (suspend, slow refresh); don't replay missed turns
+			s.nextRotate = now.Add(s.rotate)
+		}
+		s.nextChange = s.sources[s.current].NextChange(now)
+		s.dirty = true
+	}
+	if !s.nextChange.IsZero() && !now.Before(s.nextChange) {
+		s.nextChange = s.sources[s.current].NextChange(now)
+		s.dirty = true
+	}
+	return s.dirty
+}
+
+// Invalidate records that source i changed outside its NextChange schedule
+// and reports whether it is on display.
+func (s *Scheduler) Invalidate(i int, now time.Time) bool {
+	if i != s.current {
+		return false
+	}
+	s.nextChange = s.sources[i].NextChange(now)
+	s.dirty = true
+	return true
+}
+
+// Painted records that the display now shows the current content.
+func (s *Scheduler) Painted() {
+	s.dirty = false
+}
@@ -0,0 +1,125 @@
+package schedule
+
+import (
+	"testing"
+	"time"
+)
+
+var t0 = time.Date(2026, 1, 1, 12, 0, 0, 0, time.UTC)
+
+// ticker changes every period, counted from t0; a zero period never changes
+// on its own.
+type ticker struct {
+	period time.Duration
+	calls  int
+}
+
+func (f *ticker) NextChange(now time.Time) time.Time {
+	f.calls++
+	if f.period == 0 {
+		return time.Time{}
+	}
+	n := now.Sub(t0)/f.period + 1
+	return t0.Add(n * f.period)
+}
+
+func at(d time.Duration) time.Time { return t0.Add(d) }
+
+func TestSlackMerges(t *testing.T) {
+	// Rotation at 10s, content change at 10.5s: one wakeup at the later one
+	src := &ticker{period: 10500 * time.Millisecond}
+	s := New([]Source{src, &ticker{}}, 10*time.Second, time.Second, t0)
+	if d := s.Deadline(); !d.Equal(at(10500 * time.Millisecond)) {
+		t.Fatalf("deadline %v, want the later of the two", d.Sub(t0))
+	}
+	s.Painted()
+	if !s.Advance(s.Deadline()) || s.Current() != 1 {
+		t.Fatalf("merged wakeup did not rotate, current %d", s.Current())
+	}
+}
+
+func TestNoMergeBeyondSlack(t *testing.T) {
+	src := &ticker{period: 12 * time.Second}
+	s := New([]Source{src, &ticker{}}, 10*time.Second, time.Second, t0)
+	if d := s.Deadline(); !d.Equal(at(10 * time.Second)) {
+		t.Fatalf("deadline %v, want the rotation at 10s", d.Sub(t0))
+	}
+}
+
+func TestNoRotation(t *testing.T) {
+	for _, tc := range []struct {
+		name    string
+		sources []Source
+		rotate  time.Duration
+	}{
+		{"rotate 0", []Source{&ticker{}, &ticker{}}, 0},
+		{"one source", []Source{&ticker{}}, 10 * time.Second},
+	} {
+		s := New(tc.sources, tc.rotate, time.Second, t0)
+		if d := s.Deadline(); !d.IsZero() {
+			t.Errorf("%s: deadline %v, want none", tc.name, d.Sub(t0))
+		}
+		s.Painted()
+		if s.Advance(at(time.Hour)) || s.Current() != 0 {
+			t.Errorf("%s: moved to source %d", tc.name, s.Current())
+		}
+	}
+}
+
+func TestLateWake(t *testing.T) {
+	srcs := []Source{&ticker{}, &ticker{}, &ticker{}}
+	s := New(srcs, 10*time.Second, time.Second, t0)
+	s.Painted()
+	// Slept through six turns: move on by one and count the next from now
+	now := at(65 * time.Second)
+	if !s.Advance(now) || s.Current() != 1 {
+		t.Fatalf("current %d after a late wake, want 1", s.Current())
+	}
+	if d := s.Deadline(); !d.Equal(now.Add(10 * time.Second)) {
+		t.Fatalf("next rotation %v, want 10s after waking", d.Sub(t0))
+	}
+}
+
+func TestInvalidate(t *testing.T) {
+	on, off := &ticker{}, &ticker{}
+	s := New([]Source{on, off}, 0, time.Second, t0)
+	s.Painted()
+	calls := off.calls
+	if s.Invalidate(1, at(time.Second)) {
+		t.Error("invalidating a source not on display reported true")
+	}
+	if s.Advance(at(time.Second)) || off.calls != calls {
+		t.Error("invalidating a source not on display asked for a repaint")
+	}
+
+	on.period = 5 * time.Second
+	if !s.Invalidate(0, at(2*time.Second)) {
+		t.Fatal("invalidating the source on display reported false")
+	}
+	if d := s.Deadline(); !d.Equal(at(5 * time.Second)) {
+		t.Errorf("deadline %v, want the new NextChange", d.Sub(t0))
+	}
+}
+
+func TestDirtyUntilPainted(t *testing.T) {
+	src := &ticker{period: 5 * time.Second}
+	s := New([]Source{src}, 0, time.Second, t0)
+	if !s.Advance(t0) {
+		t.Fatal("first frame not painted")
+	}
+	s.Painted()
+	if s.Advance(at(time.Second)) {
+		t.Fatal("repaint with nothing due")
+	}
+	if !s.Advance(at(5 * time.Second)) {
+		t.Fatal("content change not painted")
+	}
+	// A failed or skipped paint leaves it pending
+	if !s.Advance(at(6 * time.Second)) {
+		t.Fatal("dirty cleared without Painted")
+	}
+	s.Painted()
+	if s.Advance(at(7 * time.Second)) {
+		t.Fatal("still dirty after Painted")
+	}
+}
@@ -0,0 +1,108 @@
+package screen
+
+import (
+	"bufio"
+	"fmt"
+	"image"
+	"image/color"
+	"image/png"
+	"io"
+)
+
+// Panel-native framebuffer geometry, mirrored from lib/screen.h.
+const (
+	FrameColumns  = 122
+	FrameRows     = 250
+	FrameRowBytes = (FrameColumns + 7) / 8
+	FrameBytes    = FrameRowBytes * FrameRows
+
+	// Landscape size, as laid out by Paint.
+	Width  = FrameRows
+	Height = FrameColumns
+)
+
+// Frame is a framebuffer in panel-native layout: FrameRows rows of
+// FrameRowBytes bytes, 1 bit per pixel, MSB first, 1 = white. It can be
+// drawn with Set in the same landscape orientation Paint uses and uploaded
+// with PushFrame.
+type Frame []byte
+
+// NewFrame returns an all-white frame.
+func NewFrame() Frame {
+	f := make(Frame, FrameBytes)
+	f.Fill(false)
+	return f
+}
+
+// Fill sets every pixel to black or white.
+func (f Frame) Fill(black bool) {
+	v := byte(0xFF)
+	if black {
+		v = 0
+	}
+	for i := range f {
+		f[i] = v
+	}
+}
+
+// Set colors the landscape pixel (x, y), with (0, 0) at the top left as
+// Paint draws it. Out of range coordinates are ignored.
+func (f Frame) Set(x, y int, black bool) {
+	if x < 0 || x >= Width || y < 0 || y >= Height {
+		return
+	}
+	col := FrameColumns - 1 - y
+	i := x*FrameRowBytes + col/8
+	bit := byte(0x80) >> (col % 8)
+	if black {
+		f[i] &^= bit
+	} else {
+		f[i] |= bit
+	}
+}
+
+// Black reports whether the landscape pixel (x, y) is black.
+func (f Frame) Black(x, y int) bool {
+	if x < 0 || x >= Width || y < 0 || y >= Height {
+		return false
+	}
+	col := FrameColumns - 1 - y
+	return f[x*FrameRowBytes+col/8]&(byte(0x80)>>(col%8)) == 0
+}
+
+// Image returns f in landscape, as Paint draws it, with a black and white
+// palette, which PNG stores at 1 bit per pixel.
+func (f Frame) Image() *image.Paletted {
+	img := image.NewPaletted(image.Rect(0, 0, Width, Height), color.Palette{color.White, color.Black})
+	for y := 0; y < Height; y++ {
+		row := img.Pix[y*img.Stride:]
+		for x := 0; x < Width; x++ {
+			if f.Black(x, y) {
+				row[x] = 1
+			}
+		}
+	}
+	return img
+}
+
+// WritePNG encodes f in landscape as a PNG.
+func (f Frame) WritePNG(w io.Writer) error {
+	return png.Encode(w, f.Image())
+}
+
+// WritePBM encodes f in landscape as a binary PBM (P4), where 1 is black.
+func (f Frame) WritePBM(w io.Writer) error {
+	bw := bufio.NewWriter(w)
+	fmt.Fprintf(bw, "P4\n%d %d\n", Width, Height)
+	row := make([]byte, (Width+7)/8)
+	for y := 0; y < Height; y++ {
+		clear(row)
+		for x := 0; x < Width; x++ {
+			if f.Black(x, y) {
+				row[x/8] |= 0x80 >> (x % 8)
+			}
+		}
+		bw.Write(row)
+	}
+	return bw.Flush()
+}
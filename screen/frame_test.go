@@ -0,0 +1,85 @@
+package screen
+
+import (
+	"bufio"
+	"bytes"
+	"fmt"
+	"image/color"
+	"image/png"
+	"io"
+	"testing"
+)
+
+// patternFrame draws a border, a diagonal and a block in the top left
+// corner, so a swapped axis, a mirror or an off-by-one shows up.
+func patternFrame() Frame {
+	f := NewFrame()
+	for x := 0; x < Width; x++ {
+		f.Set(x, 0, true)
+		f.Set(x, Height-1, true)
+	}
+	for y := 0; y < Height; y++ {
+		f.Set(0, y, true)
+		f.Set(Width-1, y, true)
+		f.Set(y*2, y, true)
+	}
+	for y := 3; y < 10; y++ {
+		for x := 3; x < 20; x++ {
+			f.Set(x, y, true)
+		}
+	}
+	return f
+}
+
+func TestWritePBM(t *testing.T) {
+	f := patternFrame()
+	var buf bytes.Buffer
+	if err := f.WritePBM(&buf); err != nil {
+		t.Fatal(err)
+	}
+	r := bufio.NewReader(&buf)
+	var w, h int
+	if _, err := fmt.Fscanf(r, "P4\n%d %d\n", &w, &h); err != nil || w != Width || h != Height {
+		t.Fatalf("header %dx%d, %v", w, h, err)
+	}
+	stride := (Width + 7) / 8
+	data, err := io.ReadAll(r)
+	if err != nil || len(data) != stride*Height {
+		t.Fatalf("%d bytes of pixels, want %d (%v)", len(data), stride*Height, err)
+	}
+	for y := 0; y < Height; y++ {
+		for x := 0; x < Width; x++ {
+			black := data[y*stride+x/8]&(0x80>>(x%8)) != 0
+			if black != f.Black(x, y) {
+				t.Fatalf("pixel %d,%d black=%v", x, y, black)
+			}
+		}
+		// The padding bits past the last column stay clear
+		if pad := data[y*stride+stride-1] & (0xFF >> (Width % 8)); Width%8 != 0 && pad != 0 {
+			t.Fatalf("row %d padding %#x", y, pad)
+		}
+	}
+}
+
+func TestWritePNG(t *testing.T) {
+	f := patternFrame()
+	var buf bytes.Buffer
+	if err := f.WritePNG(&buf); err != nil {
+		t.Fatal(err)
+	}
+	img, err := png.Decode(&buf)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if b := img.Bounds(); b.Dx() != Width || b.Dy() != Height {
+		t.Fatalf("bounds %v", b)
+	}
+	for y := 0; y < Height; y++ {
+		for x := 0; x < Width; x++ {
+			black := color.GrayModel.Convert(img.At(x, y)).(color.Gray).Y == 0
+			if black != f.Black(x, y) {
+				t.Fatalf("pixel %d,%d black=%v", x, y, black)
+			}
+		}
+	}
+}
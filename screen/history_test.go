@@ -0,0 +1,219 @@
+package screen
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+// historyRun pushes frames to two panels and remembers each one by the Seq
+// the history gave it.
+type historyRun struct {
+	t    *testing.T
+	rng  *rand.Rand
+	last [2]Frame
+	sent map[uint64]Frame
+	seen uint64
+	base uint64 // frames sent before the run, by an earlier TurnOff
+}
+
+func newHistoryRun(t *testing.T) *historyRun {
+	t.Helper()
+	if err := TurnOn(); err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(TurnOff)
+	if _, err := AddPanel(PanelPins{CS: 7, RST: 16, Busy: 26, DC: -1}); err != nil {
+		t.Fatal(err)
+	}
+	h := &historyRun{t: t, rng: rand.New(rand.NewSource(1)), sent: map[uint64]Frame{}}
+	for _, e := range History() {
+		h.seen = max(h.seen, e.Seq)
+	}
+	h.base = h.seen
+	return h
+}
+
+// push sends the frames (nil leaves a panel alone) and records what the
+// history filed them under.
+func (h *historyRun) push(f0, f1 Frame) {
+	h.t.Helper()
+	frames := [][]byte{f0, f1}
+	if err := PushFrames(frames, 0); err != nil {
+		h.t.Fatal(err)
+	}
+	for _, e := range History() {
+		if e.Seq > h.seen {
+			h.sent[e.Seq] = append(Frame(nil), frames[e.Panel]...)
+			h.seen = e.Seq
+		}
+	}
+	for p, f := range frames {
+		if f != nil {
+			h.last[p] = append(Frame(nil), f...)
+		}
+	}
+}
+
+// next returns the previous frame of panel p changed by kind: a few bytes,
+// most of the frame, or back to an earlier frame.
+func (h *historyRun) next(p int, kind int, alt Frame) Frame {
+	f := append(Frame(nil), h.last[p]...)
+	if f == nil {
+		f = NewFrame()
+	}
+	switch kind {
+	case 0:
+		for i := 0; i < 3; i++ {
+			f[h.rng.Intn(len(f))] ^= byte(1 + h.rng.Intn(255))
+		}
+	case 1:
+		h.rng.Read(f[h.rng.Intn(64):])
+	default:
+		copy(f, alt)
+		// Ends mid run and right at the last byte
+		f[len(f)-1] ^= 0x0F
+	}
+	return f
+}
+
+// check compares every frame still in the history with the one pushed and
+// returns how many are held.
+func (h *historyRun) check() int {
+	h.t.Helper()
+	entries := History()
+	for _, e := range entries {
+		if e.Seq <= h.base {
+			continue
+		}
+		want, ok := h.sent[e.Seq]
+		if !ok {
+			h.t.Fatalf("unknown seq %d in the history", e.Seq)
+		}
+		got, info, err := HistoryFrame(e.Seq)
+		if err != nil {
+			h.t.Fatalf("seq %d: %v", e.Seq, err)
+		}
+		if info.Panel != e.Panel || !bytes.Equal(got, want) {
+			h.t.Fatalf("seq %d (panel %d): frame differs from the one pushed", e.Seq, e.Panel)
+		}
+	}
+	for p, f := range h.last {
+		if f == nil || len(entries) == 0 {
+			continue
+		}
+		if cur, err := CurrentFrame(p); err != nil || !bytes.Equal(cur, f) {
+			h.t.Fatalf("current frame of panel %d: %v", p, err)
+		}
+	}
+	return len(entries)
+}
+
+// fill pushes n rounds of small, large and alternating changes, sometimes
+// to one panel only so the two chains interleave unevenly.
+func (h *historyRun) fill(n int) {
+	alt := [2]Frame{NewFrame(), NewFrame()}
+	alt[1].Fill(true)
+	for i := 0; i < n; i++ {
+		f0 := h.next(0, i%3, alt[i/3%2])
+		var f1 Frame
+		if i%4 != 1 {
+			f1 = h.next(1, (i+1)%3, alt[(i/3+1)%2])
+		}
+		h.push(f0, f1)
+	}
+}
+
+func TestHistoryFrames(t *testing.T) {
+	SetHistory(MaxHistoryEntries, 1<<30)
+	defer SetHistory(DefaultHistoryEntries, DefaultHistoryBytes)
+	h := newHistoryRun(t)
+	h.fill(60)
+	if n := h.check(); n < 100 {
+		t.Fatalf("%d frames held, want every one pushed", n)
+	}
+	// The newest frame of each panel costs nothing
+	sizes := map[int]int{}
+	for _, e := range History() {
+		sizes[e.Panel] = e.Size
+	}
+	if sizes[0] != 0 || sizes[1] != 0 {
+		t.Errorf("newest sizes %v, want 0", sizes)
+	}
+}
+
+func TestHistoryEntryLimit(t *testing.T) {
+	SetHistory(MaxHistoryEntries, 1<<30)
+	defer SetHistory(DefaultHistoryEntries, DefaultHistoryBytes)
+	h := newHistoryRun(t)
+	h.fill(30)
+
+	SetHistory(10, 1<<30)
+	entries := History()
+	if len(entries) != 10 || entries[9].Seq != h.seen {
+		t.Fatalf("%d entries ending at %d, want the newest 10", len(entries), entries[len(entries)-1].Seq)
+	}
+	if _, _, err := HistoryFrame(entries[0].Seq - 1); err == nil {
+		t.Error("dropped frame still decodes")
+	}
+	h.check()
+
+	// Panel 1 goes quiet until its newest entry is evicted, then resumes
+	for i := 0; i < 12; i++ {
+		h.push(h.next(0, i%3, NewFrame()), nil)
+	}
+	for _, e := range History() {
+		if e.Panel == 1 {
+			t.Fatalf("panel 1 frame %d outlived the limit", e.Seq)
+		}
+	}
+	h.push(nil, h.next(1, 1, nil))
+	h.push(h.next(0, 0, nil), h.next(1, 0, nil))
+	h.check()
+}
+
+func TestHistoryByteLimit(t *testing.T) {
+	SetHistory(MaxHistoryEntries, 1<<30)
+	defer SetHistory(DefaultHistoryEntries, DefaultHistoryBytes)
+	h := newHistoryRun(t)
+	h.fill(30)
+	held := h.check()
+
+	// Large changes cost about a frame each, so this keeps only a few
+	const limit = 3 * FrameBytes
+	SetHistory(MaxHistoryEntries, limit)
+	h.fill(12)
+	entries := History()
+	size := 0
+	for _, e := range entries {
+		size += e.Size
+	}
+	if size > limit || len(entries) >= held {
+		t.Fatalf("%d entries in %d bytes, limit %d", len(entries), size, limit)
+	}
+	h.check()
+}
+
+func TestHistoryOff(t *testing.T) {
+	defer SetHistory(DefaultHistoryEntries, DefaultHistoryBytes)
+	h := newHistoryRun(t)
+	h.fill(4)
+
+	SetHistory(0, 0)
+	if n := len(History()); n != 0 {
+		t.Fatalf("%d entries after turning the history off", n)
+	}
+	if _, err := CurrentFrame(0); err == nil {
+		t.Error("current frame kept after turning the history off")
+	}
+	h.push(h.next(0, 1, nil), nil)
+	if n := len(History()); n != 0 {
+		t.Fatalf("%d entries recorded while off", n)
+	}
+
+	SetHistory(DefaultHistoryEntries, DefaultHistoryBytes)
+	h.fill(5)
+	if n := h.check(); n == 0 {
+		t.Fatal("nothing recorded after turning the history back on")
+	}
+}
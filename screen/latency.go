@@ -0,0 +1,84 @@
+package screen
+
+import (
+	"fmt"
+	"sort"
+	"strings"
+	"time"
+)
+
+// phases are the per-frame timings a LatencyLog summarizes, in paint order.
+var phases = []struct {
+	name string
+	get  func(PaintStats) time.Duration
+}{
+	{"layout", func(s PaintStats) time.Duration { return s.Layout }},
+	{"raster", func(s PaintStats) time.Duration { return s.Raster }},
+	{"resume", func(s PaintStats) time.Duration { return s.Resume }},
+	{"upload", func(s PaintStats) time.Duration { return s.Upload }},
+	{"busy", func(s PaintStats) time.Duration { return s.Busy }},
+}
+
+// LatencyLog keeps the phase timings of the most recent frames so their
+// percentiles can be logged.
+type LatencyLog struct {
+	samples []PaintStats
+	next    int
+	full    bool
+	frames  uint64
+}
+
+// NewLatencyLog returns a log holding the last size frames.
+func NewLatencyLog(size int) *LatencyLog {
+	return &LatencyLog{samples: make([]PaintStats, size)}
+}
+
+// Observe records s if it describes a frame not seen yet and reports whether
+// it did; skipped paints leave the frame count unchanged and are ignored.
+func (l *LatencyLog) Observe(s PaintStats) bool {
+	if s.Frames == l.frames {
+		return false
+	}
+	l.frames = s.Frames
+	l.samples[l.next] = s
+	l.next++
+	if l.next == len(l.samples) {
+		l.next = 0
+		l.full = true
+	}
+	return true
+}
+
+// Len returns the number of frames held.
+func (l *LatencyLog) Len() int {
+	if l.full {
+		return len(l.samples)
+	}
+	return l.next
+}
+
+func percentile(sorted []time.Duration, p int) time.Duration {
+	return sorted[(len(sorted)-1)*p/100]
+}
+
+// Summary formats p50/p90/p99 for each phase over the frames held.
+func (l *LatencyLog) Summary() string {
+	n := l.Len()
+	if n == 0 {
+		return "no frames"
+	}
+	values := make([]time.Duration, n)
+	var b strings.Builder
+	for i, ph := range phases {
+		for j := 0; j < n; j++ {
+			values[j] = ph.get(l.samples[j])
+		}
+		sort.Slice(values, func(a, b int) bool { return values[a] < values[b] })
+		if i > 0 {
+			b.WriteString(" ")
+		}
+		fmt.Fprintf(&b, "%s p50=%v p90=%v p99=%v", ph.name,
+			percentile(values, 50), percentile(values, 90), percentile(values, 99))
+	}
+	return b.String()
+}
@@ -0,0 +1,77 @@
+package screen
+
+import (
+	"fmt"
+	"strings"
+	"time"
+)
+
+// QuietHours is a daily window without refreshes, in minutes after local
+// midnight. The window wraps past midnight when Start is later than End;
+// equal values mean no window.
+type QuietHours struct {
+	Start int
+	End   int
+}
+
+// ParseQuietHours parses a window written as "HH:MM-HH:MM", such as
+// "22:30-07:00".
+func ParseQuietHours(s string) (QuietHours, error) {
+	from, to, ok := strings.Cut(s, "-")
+	if !ok {
+		return QuietHours{}, fmt.Errorf("quiet hours %q: want HH:MM-HH:MM", s)
+	}
+	start, err := parseClock(from)
+	if err != nil {
+		return QuietHours{}, fmt.Errorf("quiet hours %q: %w", s, err)
+	}
+	end, err := parseClock(to)
+	if err != nil {
+		return QuietHours{}, fmt.Errorf("quiet hours %q: %w", s, err)
+	}
+	return QuietHours{Start: start, End: end}, nil
+}
+
+func parseClock(s string) (int, error) {
+	t, err := time.Parse("15:04", strings.TrimSpace(s))
+	if err != nil {
+		return 0, err
+	}
+	return t.Hour()*60 + t.Minute(), nil
+}
+
+// Enabled reports whether q describes a window at all.
+func (q QuietHours) Enabled() bool {
+	return q.Start != q.End
+}
+
+// Contains reports whether t falls inside the window, matching the check the
+// library makes before every refresh.
+func (q QuietHours) Contains(t time.Time) bool {
+	if !q.Enabled() {
+		return false
+	}
+	m := t.Hour()*60 + t.Minute()
+	if q.Start < q.End {
+		return m >= q.Start && m < q.End
+	}
+	return m >= q.Start || m < q.End
+}
+
+// NextEnd returns the first end of the window after t, or the zero time if
+// q is disabled.
+func (q QuietHours) NextEnd(t time.Time) time.Time {
+	if !q.Enabled() {
+		return time.Time{}
+	}
+	y, m, d := t.Date()
+	end := time.Date(y, m, d, q.End/60, q.End%60, 0, 0, t.Location())
+	if !end.After(t) {
+		end = time.Date(y, m, d+1, q.End/60, q.End%60, 0, 0, t.Location())
+	}
+	return end
+}
+
+func (q QuietHours) String() string {
+	return fmt.Sprintf("%02d:%02d-%02d:%02d", q.Start/60, q.Start%60, q.End/60, q.End%60)
+}
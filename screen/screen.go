@@ -1,17 +1,40 @@
 package screen
 
 /*
-#cgo CFLAGS: -I${SRCDIR}/../lib -I${SRCDIR}/../lib/epd -I${SRCDIR}/../lib/epd/Config -I${SRCDIR}/../lib/epd/GUI -I${SRCDIR}/../lib/epd/Fonts -march=armv6 -mfpu=vfp -mfloat-abi=hard
-#cgo LDFLAGS: -L${SRCDIR}/.. -lscreen -L${SRCDIR}/../lib/libbcm2835/lib -lbcm2835 -lm -lpthread
-#include "../lib/screen.h"
+// -tags sim links the host library from `make host`, which drives a simulated
+// panel, so the package builds and runs off the Pi.
+#cgo CFLAGS: -I${SRCDIR}/../lib -I${SRCDIR}/../lib/epd -I${SRCDIR}/../lib/epd/Config -I${SRCDIR}/../lib/epd/GUI -I${SRCDIR}/../lib/epd/Fonts
+#cgo !sim CFLAGS: -march=armv6 -mfpu=vfp -mfloat-abi=hard
+// -tags gpiod2 links a library built with GPIO_BACKEND=gpiod2. armv6 has no
+// 64-bit exclusive loads and stores, so the DEV_Stats counters need libatomic.
+#cgo !sim,!gpiod2 LDFLAGS: -L${SRCDIR}/.. -lscreen -L${SRCDIR}/../lib/libbcm2835/lib -lbcm2835 -lm -lpthread -latomic
+#cgo gpiod2 LDFLAGS: -L${SRCDIR}/.. -lscreen -lgpiod -lm -lpthread -latomic
+#cgo sim LDFLAGS: -L${SRCDIR}/../bin/host -lscreen -lm -lpthread
 #include <stdlib.h>
+#include "../lib/screen.h"
 */
 import "C"
 import (
 	"errors"
+	"fmt"
+	"time"
 	"unsafe"
 )
 
+// FrameFlags select how a pushed frame is refreshed.
+type FrameFlags uint32
+
+// FullRefresh uses the full waveform, which clears ghosting but flashes.
+const FullRefresh FrameFlags = C.SCREEN_FRAME_FULL_REFRESH
+
+// The Go geometry in frame.go must match lib/screen.h.
+var (
+	_ [FrameBytes - C.SCREEN_FRAME_BYTES]byte
+	_ [C.SCREEN_FRAME_BYTES - FrameBytes]byte
+	_ [FrameRowBytes - C.SCREEN_FRAME_ROW_BYTES]byte
+	_ [C.SCREEN_FRAME_ROW_BYTES - FrameRowBytes]byte
+)
+
 // TurnOn initializes the display and powers it up.
 func TurnOn() error {
 	if !bool(C.screen_turn_on()) {
@@ -20,28 +43,439 @@ func TurnOn() error {
 	return nil
 }
 
+// Start is the fast cold-start variant of TurnOn: it skips the environment
+// check, the banners and the initial clear. The first frame painted or
+// pushed afterwards is sent as a full refresh in place of the clear.
+func Start() error {
+	if !bool(C.screen_start()) {
+		return errors.New("failed to start display")
+	}
+	return nil
+}
+
 // TurnOff powers down the display.
 func TurnOff() {
 	C.screen_turn_off()
 }
 
+// SetAutoSleep controls whether the panel controller goes into deep sleep
+// after every refresh. It is on by default; the next refresh wakes it with a
+// short reset instead of a full init.
+func SetAutoSleep(on bool) {
+	C.screen_set_auto_sleep(C.bool(on))
+}
+
+// SetQuietHours stops all refreshes inside q. Frames painted or pushed in the
+// window are held back until FlushPending. The zero QuietHours disables it.
+func SetQuietHours(q QuietHours) {
+	C.screen_set_quiet_hours(C.int(q.Start), C.int(q.End))
+}
+
+// FlushPending sends the frame held back by quiet hours, if there is one and
+// the window has closed.
+func FlushPending() error {
+	if !bool(C.screen_flush_pending()) {
+		return errors.New("flush failed")
+	}
+	return nil
+}
+
+// TimingProfile selects the delays the driver uses around resets, wakes,
+// deep sleep and BUSY polling.
+type TimingProfile int
+
+const (
+	// TimingWaveshare keeps the padded delays of the vendor driver. The
+	// default.
+	TimingWaveshare TimingProfile = C.SCREEN_TIMING_WAVESHARE
+	// TimingDatasheet trims them to the controller minimums. It has not been
+	// checked on real hardware yet, so it is opt-in.
+	TimingDatasheet TimingProfile = C.SCREEN_TIMING_DATASHEET
+)
+
+// ParseTimingProfile accepts "waveshare" or "datasheet".
+func ParseTimingProfile(s string) (TimingProfile, error) {
+	switch s {
+	case "waveshare":
+		return TimingWaveshare, nil
+	case "datasheet":
+		return TimingDatasheet, nil
+	}
+	return 0, fmt.Errorf("unknown timing profile %q", s)
+}
+
+// SetTimingProfile switches the delays of the first panel; it takes effect
+// immediately. Added panels have their own, see PanelPins.
+func SetTimingProfile(p TimingProfile) error {
+	if !bool(C.screen_set_timing(C.int(p))) {
+		return fmt.Errorf("unknown timing profile %d", p)
+	}
+	return nil
+}
+
+// PaintLayout is the framebuffer layout Paint draws in.
+type PaintLayout int
+
+const (
+	// LayoutRows draws into the panel-native frame through a per-pixel
+	// rotation. The default.
+	LayoutRows PaintLayout = C.SCREEN_LAYOUT_ROWS
+	// LayoutPages draws text row by row into the controller's page order
+	// and lets its address counter do the rotation on upload.
+	LayoutPages PaintLayout = C.SCREEN_LAYOUT_PAGES
+)
+
+// ParsePaintLayout accepts "rows" or "pages".
+func ParsePaintLayout(s string) (PaintLayout, error) {
+	switch s {
+	case "rows":
+		return LayoutRows, nil
+	case "pages":
+		return LayoutPages, nil
+	}
+	return 0, fmt.Errorf("unknown paint layout %q", s)
+}
+
+// SetPaintLayout selects the layout of the next paints.
+func SetPaintLayout(l PaintLayout) error {
+	if !bool(C.screen_set_paint_layout(C.int(l))) {
+		return fmt.Errorf("unknown paint layout %d", l)
+	}
+	return nil
+}
+
+// SkippedRefreshes reports how many paints and pushes were dropped because
+// the panel already showed an identical frame.
+func SkippedRefreshes() uint64 {
+	return uint64(C.screen_skipped_refreshes())
+}
+
+// RefreshMode is the waveform used for a frame.
+type RefreshMode uint32
+
+const (
+	ModeNone    RefreshMode = C.SCREEN_MODE_NONE
+	ModePartial RefreshMode = C.SCREEN_MODE_PARTIAL
+	ModeFull    RefreshMode = C.SCREEN_MODE_FULL
+)
+
+func (m RefreshMode) String() string {
+	switch m {
+	case ModePartial:
+		return "partial"
+	case ModeFull:
+		return "full"
+	}
+	return "none"
+}
+
+// PaintStats are the library's counters and the phase timings of the last frame
+// sent to the panel. Wake and Sleep time the last TurnOn (or Start) and
+// TurnOff, while Resume is the part of the last frame spent waking the
+// controller from deep sleep; a partial refresh is woken by its own reset,
+// which counts as Upload. Asleep and Awake split the time since the panel
+// was turned on by controller state.
+type PaintStats struct {
+	Frames           uint64
+	FullRefreshes    uint64
+	PartialRefreshes uint64
+	Skipped          uint64
+	SPIBytes         uint64
+	BusyWaits        uint64
+	BusyTotal        time.Duration
+	DelayTotal       time.Duration
+	Resumes          uint64
+	ResumeTotal      time.Duration
+	Asleep           time.Duration
+	Awake            time.Duration
+	QuietDeferred    uint64
+	LastMode         RefreshMode
+
+	Layout time.Duration
+	Raster time.Duration
+	Resume time.Duration
+	Upload time.Duration
+	Busy   time.Duration
+	Wake   time.Duration
+	Sleep  time.Duration
+}
+
+// AsleepFraction returns the share of the time since TurnOn the controller
+// spent in deep sleep.
+func (s PaintStats) AsleepFraction() float64 {
+	total := s.Asleep + s.Awake
+	if total <= 0 {
+		return 0
+	}
+	return float64(s.Asleep) / float64(total)
+}
+
+func micros(us C.uint32_t) time.Duration {
+	return time.Duration(us) * time.Microsecond
+}
+
+// Stats returns a snapshot of the display statistics.
+func Stats() PaintStats {
+	var s C.screen_stats
+	C.screen_get_stats(&s)
+	return PaintStats{
+		Frames:           uint64(s.frames),
+		FullRefreshes:    uint64(s.full_refreshes),
+		PartialRefreshes: uint64(s.partial_refreshes),
+		Skipped:          uint64(s.skipped),
+		SPIBytes:         uint64(s.spi_bytes),
+		BusyWaits:        uint64(s.busy_waits),
+		BusyTotal:        time.Duration(s.busy_total_us) * time.Microsecond,
+		DelayTotal:       time.Duration(s.delay_total_us) * time.Microsecond,
+		Resumes:          uint64(s.resumes),
+		ResumeTotal:      time.Duration(s.resume_total_us) * time.Microsecond,
+		Asleep:           time.Duration(s.asleep_us) * time.Microsecond,
+		Awake:            time.Duration(s.awake_us) * time.Microsecond,
+		QuietDeferred:    uint64(s.quiet_deferred),
+		LastMode:         RefreshMode(s.last_mode),
+		Layout:           micros(s.layout_us),
+		Raster:           micros(s.raster_us),
+		Resume:           micros(s.resume_us),
+		Upload:           micros(s.upload_us),
+		Busy:             micros(s.busy_us),
+		Wake:             micros(s.wake_us),
+		Sleep:            micros(s.sleep_us),
+	}
+}
+
+// C int is 32 bits on every target we build for, so []int32 offsets can be
+// handed to C as int* without conversion.
+var (
+	_ [unsafe.Sizeof(C.int(0)) - 4]byte
+	_ [4 - unsafe.Sizeof(C.int(0))]byte
+)
+
 // Paint renders the provided lines using an optional font height (use 0 for default).
 func Paint(lines []string, fontHeight int) error {
 	if len(lines) == 0 {
 		return errors.New("no lines provided")
 	}
-	cLines := make([]*C.char, len(lines))
+	size := 0
+	for _, s := range lines {
+		size += len(s)
+	}
+	buf := make([]byte, 0, size)
+	offsets := make([]int32, len(lines)+1)
 	for i, s := range lines {
-		cLines[i] = C.CString(s)
+		buf = append(buf, s...)
+		offsets[i+1] = int32(len(buf))
+	}
+	return PaintBuffer(buf, offsets, fontHeight)
+}
+
+// PaintBuffer renders lines packed into one buffer: line i is
+// buf[offsets[i]:offsets[i+1]], so offsets holds one more entry than there
+// are lines. Both slices are handed to C as they are; cgo keeps Go memory
+// pinned for the duration of the call, so painting costs a single crossing
+// with no C allocations.
+func PaintBuffer(buf []byte, offsets []int32, fontHeight int) error {
+	if len(offsets) < 2 {
+		return errors.New("no lines provided")
 	}
-	defer func() {
-		for _, p := range cLines {
-			C.free(unsafe.Pointer(p))
+	// C reads every line through these offsets, so each must lie in buf
+	prev := int32(0)
+	for _, off := range offsets {
+		if off < prev {
+			return errors.New("line offsets are not increasing")
+		}
+		if int(off) > len(buf) {
+			return errors.New("line offsets exceed buffer")
 		}
-	}()
+		prev = off
+	}
 
-	if !bool(C.screen_paint((**C.char)(unsafe.Pointer(&cLines[0])), C.int(len(lines)), C.int(fontHeight))) {
+	var data *C.char
+	if len(buf) > 0 {
+		data = (*C.char)(unsafe.Pointer(&buf[0]))
+	}
+	cOffsets := (*C.int)(unsafe.Pointer(&offsets[0]))
+	if !bool(C.screen_paint_buf(data, cOffsets, C.int(len(offsets)-1), C.int(fontHeight))) {
 		return errors.New("paint failed")
 	}
 	return nil
 }
+
+// PushFrame uploads a full panel-native frame (see Frame) with a partial
+// refresh.
+func PushFrame(frame []byte) error {
+	return PushFrameFlags(frame, 0)
+}
+
+// PushFrameFlags uploads a full panel-native frame.
+func PushFrameFlags(frame []byte, flags FrameFlags) error {
+	if len(frame) != FrameBytes {
+		return fmt.Errorf("frame is %d bytes, want %d", len(frame), FrameBytes)
+	}
+	if !bool(C.screen_push_frame((*C.uint8_t)(unsafe.Pointer(&frame[0])), C.size_t(len(frame)), C.uint32_t(flags))) {
+		return errors.New("push frame failed")
+	}
+	return nil
+}
+
+// PushWindow replaces a rectangle of the current frame, given in native
+// columns and rows, and refreshes. buf holds height rows of (width+7)/8
+// bytes and column must be a multiple of 8.
+func PushWindow(buf []byte, column, row, width, height int, flags FrameFlags) error {
+	if len(buf) == 0 {
+		return errors.New("empty window")
+	}
+	ok := C.screen_push_window((*C.uint8_t)(unsafe.Pointer(&buf[0])), C.size_t(len(buf)),
+		C.int(column), C.int(row), C.int(width), C.int(height), C.uint32_t(flags))
+	if !bool(ok) {
+		return errors.New("push window failed")
+	}
+	return nil
+}
+
+// MaxPanels is the number of panels one process can drive, the first
+// included.
+const MaxPanels = C.SCREEN_MAX_PANELS
+
+// PanelPins are the lines of an additional panel, as BCM GPIO numbers, and
+// its timing profile. The panel shares SPI with the first one and is
+// selected by its own CS, CE1 (GPIO 7) or any free GPIO; DC is shared when
+// negative.
+type PanelPins struct {
+	CS, RST, Busy, DC int
+	Timing            TimingProfile
+}
+
+// AddPanel sets up and clears one more panel, turning the first one on if
+// needed, and returns its index for PushFrames. Added panels stay until
+// TurnOff. The gpiod2 backend drives a single panel.
+func AddPanel(p PanelPins) (int, error) {
+	pins := C.screen_panel_pins{
+		cs_pin:   C.int(p.CS),
+		rst_pin:  C.int(p.RST),
+		busy_pin: C.int(p.Busy),
+		dc_pin:   C.int(p.DC),
+		timing:   C.int(p.Timing),
+	}
+	i := int(C.screen_add_panel(&pins))
+	if i < 0 {
+		return 0, errors.New("add panel failed")
+	}
+	return i, nil
+}
+
+// PanelCount reports how many panels are set up, the first included.
+func PanelCount() int {
+	return int(C.screen_panel_count())
+}
+
+// PushFrames uploads frames[i] to panel i and refreshes those panels at
+// once: uploads take turns on the SPI bus while the refreshes overlap, so
+// updating every panel takes about as long as one refresh. A nil frame
+// leaves its panel alone; panel 0 is the one Paint and PushFrame draw on.
+func PushFrames(frames [][]byte, flags FrameFlags) error {
+	if len(frames) == 0 || len(frames) > MaxPanels {
+		return fmt.Errorf("%d frames, want 1 to %d", len(frames), MaxPanels)
+	}
+	for i, f := range frames {
+		if f != nil && len(f) != FrameBytes {
+			return fmt.Errorf("frame %d is %d bytes, want %d", i, len(f), FrameBytes)
+		}
+	}
+
+	// The pointer table may not hold Go pointers, so the frames are copied
+	// to C memory; that is a few kilobytes against a refresh of a second.
+	mem := C.malloc(C.size_t(len(frames) * FrameBytes))
+	if mem == nil {
+		return errors.New("push frames: out of memory")
+	}
+	defer C.free(mem)
+	data := unsafe.Slice((*byte)(mem), len(frames)*FrameBytes)
+	var ptrs [MaxPanels]*C.uint8_t
+	for i, f := range frames {
+		if f != nil {
+			copy(data[i*FrameBytes:], f)
+			ptrs[i] = (*C.uint8_t)(unsafe.Pointer(&data[i*FrameBytes]))
+		}
+	}
+	if !bool(C.screen_push_frames(&ptrs[0], C.int(len(frames)), C.uint32_t(flags))) {
+		return errors.New("push frames failed")
+	}
+	return nil
+}
+
+// Default limits of the frame history, see SetHistory.
+const (
+	MaxHistoryEntries     = C.SCREEN_HISTORY_MAX_ENTRIES
+	DefaultHistoryEntries = C.SCREEN_HISTORY_ENTRIES
+	DefaultHistoryBytes   = C.SCREEN_HISTORY_BYTES
+)
+
+// HistoryEntry describes a frame the library sent to a panel. Seq is the
+// value of PaintStats.Frames once it was sent and identifies it in
+// HistoryFrame; Size is the compressed size held for it.
+type HistoryEntry struct {
+	Seq   uint64
+	Time  time.Time
+	Panel int
+	Mode  RefreshMode
+	Size  int
+
+	Layout time.Duration
+	Raster time.Duration
+	Resume time.Duration
+	Upload time.Duration
+	Busy   time.Duration
+}
+
+func historyEntry(e *C.screen_history_entry) HistoryEntry {
+	return HistoryEntry{
+		Seq:    uint64(e.seq),
+		Time:   time.UnixMicro(int64(e.time_us)),
+		Panel:  int(e.panel),
+		Mode:   RefreshMode(e.mode),
+		Size:   int(e.size),
+		Layout: micros(e.layout_us),
+		Raster: micros(e.raster_us),
+		Resume: micros(e.resume_us),
+		Upload: micros(e.upload_us),
+		Busy:   micros(e.busy_us),
+	}
+}
+
+// SetHistory limits the frame history to the last entries frames, at most
+// MaxHistoryEntries, in at most bytes of compressed data. Zero entries turns
+// it off. It keeps DefaultHistoryEntries in DefaultHistoryBytes otherwise.
+func SetHistory(entries, bytes int) {
+	C.screen_set_history(C.int(entries), C.size_t(bytes))
+}
+
+// History lists the frames held in the history, oldest first. It is safe to
+// call while another goroutine paints.
+func History() []HistoryEntry {
+	entries := make([]C.screen_history_entry, MaxHistoryEntries)
+	n := int(C.screen_history(&entries[0], C.int(len(entries))))
+	out := make([]HistoryEntry, n)
+	for i := range out {
+		out[i] = historyEntry(&entries[i])
+	}
+	return out
+}
+
+// HistoryFrame decodes the frame with the given Seq from the history.
+func HistoryFrame(seq uint64) (Frame, HistoryEntry, error) {
+	var e C.screen_history_entry
+	f := make(Frame, FrameBytes)
+	if !bool(C.screen_history_frame(C.uint64_t(seq), &e, (*C.uint8_t)(unsafe.Pointer(&f[0])))) {
+		return nil, HistoryEntry{}, fmt.Errorf("frame %d is not in the history", seq)
+	}
+	return f, historyEntry(&e), nil
+}
+
+// CurrentFrame returns the last frame sent to a panel.
+func CurrentFrame(panel int) (Frame, error) {
+	f := make(Frame, FrameBytes)
+	if !bool(C.screen_current_frame(C.int(panel), (*C.uint8_t)(unsafe.Pointer(&f[0])))) {
+		return nil, fmt.Errorf("no frame sent to panel %d", panel)
+	}
+	return f, nil
+}
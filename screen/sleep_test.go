@@ -0,0 +1,42 @@
+package screen
+
+import "testing"
+
+// With auto sleep every refresh wakes the panel. Init_Wake waits on BUSY
+// once after its reset; a partial refresh is woken by its own reset
+// instead, so it only waits for the refresh itself.
+func TestAutoSleepWake(t *testing.T) {
+	if err := TurnOn(); err != nil {
+		t.Fatal(err)
+	}
+	defer TurnOff()
+	SetAutoSleep(true)
+	defer SetAutoSleep(false)
+
+	f := NewFrame()
+	for _, tc := range []struct {
+		name      string
+		flags     FrameFlags
+		busyWaits uint64
+	}{
+		{"full", FullRefresh, 2},
+		{"partial", 0, 1},
+		{"partial again", 0, 1},
+	} {
+		f[0]++
+		before := Stats()
+		if err := PushFrameFlags(f, tc.flags); err != nil {
+			t.Fatal(err)
+		}
+		after := Stats()
+		if n := after.Resumes - before.Resumes; n != 1 {
+			t.Errorf("%s: %d resumes, want 1", tc.name, n)
+		}
+		if n := after.BusyWaits - before.BusyWaits; n != tc.busyWaits {
+			t.Errorf("%s: %d BUSY waits, want %d", tc.name, n, tc.busyWaits)
+		}
+		if tc.flags == 0 && after.PartialRefreshes != before.PartialRefreshes+1 {
+			t.Errorf("%s: not a partial refresh", tc.name)
+		}
+	}
+}
@@ -0,0 +1,99 @@
+package main
+
+import (
+	"fmt"
+	"log"
+	"os"
+	"strings"
+	"sync"
+	"time"
+
+	"jarvis/quotes"
+	"jarvis/screen"
+)
+
+const startupEnv = "JARVIS_STARTUP"
+
+// timeline records startup milestones relative to the process start. Safe
+// for concurrent use, since the fast path marks from two goroutines.
+type timeline struct {
+	start time.Time
+	mu    sync.Mutex
+	marks []string
+}
+
+func newTimeline() *timeline {
+	return &timeline{start: time.Now()}
+}
+
+func (t *timeline) mark(name string) {
+	d := time.Since(t.start).Round(100 * time.Microsecond)
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	t.marks = append(t.marks, fmt.Sprintf("%s +%v", name, d))
+}
+
+func (t *timeline) String() string {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	return strings.Join(t.marks, ", ")
+}
+
+// fastStartup reports whether JARVIS_STARTUP=fast asks for the fast cold
+// start: no welcome screen, and the first quote is the first frame.
+func fastStartup() bool {
+	switch v := os.Getenv(startupEnv); v {
+	case "", "normal":
+		return false
+	case "fast":
+		return true
+	default:
+		fmt.Fprintf(os.Stderr, "Ignoring invalid %s=%q\n", startupEnv, v)
+		return false
+	}
+}
+
+// placeholderRotator stands in when no quotes could be loaded.
+func placeholderRotator() *quotes.Rotator {
+	return quotes.NewRotator([]quotes.Quote{{Quote: "No quotes available", Author: ""}})
+}
+
+// bringUp turns the panel on and loads the quotes. The normal path loads
+// the quotes first, fetching them when there is no cache, and then turns the
+// panel on and clears it. The fast path starts the panel on its own
+// goroutine while the quote cache is read and never waits on the network:
+// without a cache it returns a placeholder and fetch is set, so the caller
+// refreshes in the background.
+func bringUp(fast bool, tl *timeline) (rotator *quotes.Rotator, fetch bool, err error) {
+	if !fast {
+		rotator, err = quotes.NewRotatorFromCache()
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Failed to load quotes: %v\n", err)
+			rotator = placeholderRotator()
+		}
+		tl.mark("quotes loaded")
+		if err := screen.TurnOn(); err != nil {
+			return nil, false, err
+		}
+		tl.mark("panel on")
+		return rotator, false, nil
+	}
+
+	panel := make(chan error, 1)
+	go func() {
+		err := screen.Start()
+		tl.mark("panel on")
+		panel <- err
+	}()
+
+	rotator, err = quotes.OpenCachedRotator()
+	if err != nil {
+		log.Printf("No quote cache yet, fetching in the background: %v", err)
+		rotator, fetch = placeholderRotator(), true
+	}
+	tl.mark("quotes loaded")
+	if err := <-panel; err != nil {
+		return nil, false, err
+	}
+	return rotator, fetch, nil
+}
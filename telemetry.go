@@ -0,0 +1,132 @@
+package main
+
+import (
+	"errors"
+	"runtime"
+	rtmetrics "runtime/metrics"
+	"sync/atomic"
+	"time"
+
+	"jarvis/display"
+	"jarvis/metrics"
+	"jarvis/quotes"
+	"jarvis/screen"
+)
+
+const (
+	metricsEnv = "JARVIS_METRICS_ADDR"
+	heapMetric = "/memory/classes/heap/objects:bytes"
+)
+
+// telemetry owns the daemon's metrics. Paint stats are snapshotted by the
+// display loop after every paint, so scrapes never call into the C library
+// while it is drawing.
+type telemetry struct {
+	registry      *metrics.Registry
+	layout        *metrics.Histogram
+	raster        *metrics.Histogram
+	upload        *metrics.Histogram
+	busy          *metrics.Histogram
+	resume        *metrics.Histogram
+	fetches       *metrics.Histogram
+	fetchFailures *metrics.Counter
+	paint         atomic.Pointer[screen.PaintStats]
+	lastFrames    uint64
+}
+
+func newTelemetry(rotator *quotes.Rotator) *telemetry {
+	r := metrics.NewRegistry()
+	t := &telemetry{registry: r}
+	t.paint.Store(&screen.PaintStats{})
+
+	const phaseHelp = "Time spent in each phase of frames sent to the panel."
+	t.layout = r.Histogram("jarvis_paint_phase_seconds", phaseHelp, `phase="layout"`, metrics.DurationBuckets)
+	t.raster = r.Histogram("jarvis_paint_phase_seconds", phaseHelp, `phase="raster"`, metrics.DurationBuckets)
+	t.upload = r.Histogram("jarvis_paint_phase_seconds", phaseHelp, `phase="upload"`, metrics.DurationBuckets)
+	t.busy = r.Histogram("jarvis_paint_phase_seconds", phaseHelp, `phase="busy"`, metrics.DurationBuckets)
+	t.resume = r.Histogram("jarvis_panel_resume_seconds", "Time taken to wake the panel from deep sleep for a frame.", "", metrics.DurationBuckets)
+
+	const refreshHelp = "Frames sent to the panel, by refresh mode."
+	r.CounterFunc("jarvis_refreshes_total", refreshHelp, `mode="full"`, func() float64 {
+		return float64(t.paint.Load().FullRefreshes)
+	})
+	r.CounterFunc("jarvis_refreshes_total", refreshHelp, `mode="partial"`, func() float64 {
+		return float64(t.paint.Load().PartialRefreshes)
+	})
+	r.CounterFunc("jarvis_frames_skipped_total", "Paints dropped because the panel already showed the frame.", "", func() float64 {
+		return float64(t.paint.Load().Skipped)
+	})
+	const powerHelp = "Time since the panel was turned on, by controller state."
+	r.CounterFunc("jarvis_panel_seconds_total", powerHelp, `state="asleep"`, func() float64 {
+		return t.paint.Load().Asleep.Seconds()
+	})
+	r.CounterFunc("jarvis_panel_seconds_total", powerHelp, `state="awake"`, func() float64 {
+		return t.paint.Load().Awake.Seconds()
+	})
+	r.CounterFunc("jarvis_frames_deferred_total", "Frames held back by quiet hours.", "", func() float64 {
+		return float64(t.paint.Load().QuietDeferred)
+	})
+	r.CounterFunc("jarvis_spi_bytes_total", "Bytes written to the panel over SPI.", "", func() float64 {
+		return float64(t.paint.Load().SPIBytes)
+	})
+
+	t.fetches = r.Histogram("jarvis_quote_fetch_seconds", "Duration of quote fetch attempts.", "", metrics.DurationBuckets)
+	t.fetchFailures = r.Counter("jarvis_quote_fetch_failures_total", "Quote fetch attempts that failed.", "")
+	r.GaugeFunc("jarvis_quote_corpus_size", "Quotes in rotation.", "", func() float64 {
+		return float64(rotator.Len())
+	})
+	rotator.OnFetch = t.observeFetch
+
+	r.GaugeFunc("go_goroutines", "Number of goroutines that currently exist.", "", func() float64 {
+		return float64(runtime.NumGoroutine())
+	})
+	// runtime/metrics reads the heap size without the stop-the-world pause
+	// runtime.ReadMemStats would take on every scrape.
+	r.GaugeFunc("go_heap_objects_bytes", "Bytes of heap memory occupied by live and unswept objects.", "", func() float64 {
+		sample := []rtmetrics.Sample{{Name: heapMetric}}
+		rtmetrics.Read(sample)
+		if sample[0].Value.Kind() != rtmetrics.KindUint64 {
+			return 0
+		}
+		return float64(sample[0].Value.Uint64())
+	})
+	return t
+}
+
+// observePaint snapshots s and records its phase timings if it describes a
+// new frame. Called from the display loop only.
+func (t *telemetry) observePaint(s screen.PaintStats) {
+	t.paint.Store(&s)
+	if s.Frames == t.lastFrames {
+		return
+	}
+	t.lastFrames = s.Frames
+	t.layout.ObserveDuration(s.Layout)
+	t.raster.ObserveDuration(s.Raster)
+	t.upload.ObserveDuration(s.Upload)
+	t.busy.ObserveDuration(s.Busy)
+	if s.Resume > 0 {
+		t.resume.ObserveDuration(s.Resume)
+	}
+}
+
+// observeDisplay exports the counters of the display server.
+func (t *telemetry) observeDisplay(srv *display.Server) {
+	const help = "Updates submitted to the display server, by outcome."
+	t.registry.CounterFunc("jarvis_display_updates_total", help, `result="drawn"`, func() float64 {
+		return float64(srv.Stats().Drawn)
+	})
+	t.registry.CounterFunc("jarvis_display_updates_total", help, `result="superseded"`, func() float64 {
+		return float64(srv.Stats().Superseded)
+	})
+	t.registry.CounterFunc("jarvis_display_updates_total", help, `result="failed"`, func() float64 {
+		return float64(srv.Stats().Failed)
+	})
+}
+
+func (t *telemetry) observeFetch(d time.Duration, err error) {
+	t.fetches.ObserveDuration(d)
+	if err != nil && !errors.Is(err, quotes.ErrNotModified) {
+		t.fetchFailures.Inc()
+	}
+}
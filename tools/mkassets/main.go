@@ -0,0 +1,147 @@
+// Command mkassets packs the sample images compiled into ImageData.c style
+// sources into a single file that GUI_AssetPack maps at runtime.
+//
+// Every `const unsigned char name[size] = { ... };` array becomes one entry
+// named after the C identifier. The layout (all integers little-endian):
+//
+//	header  "EPDA" | version u16 | count u16
+//	index   count x { name [40]byte NUL padded | offset u32 | size u32 }, sorted by name
+//	data    blobs, each starting on a 16 byte boundary
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"flag"
+	"fmt"
+	"log"
+	"os"
+	"regexp"
+	"sort"
+	"strconv"
+	"strings"
+)
+
+const (
+	packVersion = 1
+	nameSize    = 40
+	headerSize  = 8
+	entrySize   = nameSize + 8
+	dataAlign   = 16
+)
+
+type asset struct {
+	name string
+	data []byte
+}
+
+var (
+	blockComment = regexp.MustCompile(`(?s)/\*.*?\*/`)
+	lineComment  = regexp.MustCompile(`//[^\n]*`)
+	arrayDecl    = regexp.MustCompile(`(?s)const\s+unsigned\s+char\s+(\w+)\s*\[\s*(\d*)\s*\]\s*=\s*\{(.*?)\}\s*;`)
+)
+
+func parseSource(path string) ([]asset, error) {
+	src, err := os.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	src = blockComment.ReplaceAll(src, nil)
+	src = lineComment.ReplaceAll(src, nil)
+
+	var assets []asset
+	for _, m := range arrayDecl.FindAllSubmatch(src, -1) {
+		name := string(m[1])
+		if len(name) >= nameSize {
+			return nil, fmt.Errorf("%s: name %q longer than %d bytes", path, name, nameSize-1)
+		}
+		data := make([]byte, 0, len(m[3])/5)
+		for _, tok := range strings.Split(string(m[3]), ",") {
+			tok = strings.TrimSpace(tok)
+			if tok == "" {
+				continue
+			}
+			v, err := strconv.ParseUint(tok, 0, 8)
+			if err != nil {
+				return nil, fmt.Errorf("%s: %s: %w", path, name, err)
+			}
+			data = append(data, byte(v))
+		}
+		// A declared size larger than the initializer is zero filled, as in C.
+		if len(m[2]) > 0 {
+			size, _ := strconv.Atoi(string(m[2]))
+			if size < len(data) {
+				return nil, fmt.Errorf("%s: %s has %d initializers for size %d", path, name, len(data), size)
+			}
+			data = append(data, make([]byte, size-len(data))...)
+		}
+		assets = append(assets, asset{name: name, data: data})
+	}
+	return assets, nil
+}
+
+func align(n int) int {
+	return (n + dataAlign - 1) &^ (dataAlign - 1)
+}
+
+func pack(assets []asset) ([]byte, error) {
+	sort.Slice(assets, func(i, j int) bool { return assets[i].name < assets[j].name })
+	for i := 1; i < len(assets); i++ {
+		if assets[i].name == assets[i-1].name {
+			return nil, fmt.Errorf("duplicate asset %q", assets[i].name)
+		}
+	}
+	if len(assets) > 0xFFFF {
+		return nil, fmt.Errorf("%d assets do not fit the index", len(assets))
+	}
+
+	var buf bytes.Buffer
+	buf.WriteString("EPDA")
+	binary.Write(&buf, binary.LittleEndian, uint16(packVersion))
+	binary.Write(&buf, binary.LittleEndian, uint16(len(assets)))
+
+	offset := align(headerSize + entrySize*len(assets))
+	for _, a := range assets {
+		var name [nameSize]byte
+		copy(name[:], a.name)
+		buf.Write(name[:])
+		binary.Write(&buf, binary.LittleEndian, uint32(offset))
+		binary.Write(&buf, binary.LittleEndian, uint32(len(a.data)))
+		offset = align(offset + len(a.data))
+	}
+	for _, a := range assets {
+		buf.Write(make([]byte, align(buf.Len())-buf.Len()))
+		buf.Write(a.data)
+	}
+	return buf.Bytes(), nil
+}
+
+func main() {
+	out := flag.String("o", "assets.pak", "output file")
+	flag.Parse()
+	if flag.NArg() == 0 {
+		log.Fatal("usage: mkassets -o assets.pak ImageData.c [more.c ...]")
+	}
+
+	var assets []asset
+	for _, path := range flag.Args() {
+		found, err := parseSource(path)
+		if err != nil {
+			log.Fatal(err)
+		}
+		assets = append(assets, found...)
+	}
+
+	data, err := pack(assets)
+	if err != nil {
+		log.Fatal(err)
+	}
+	tmp := *out + ".tmp"
+	if err := os.WriteFile(tmp, data, 0644); err != nil {
+		log.Fatal(err)
+	}
+	if err := os.Rename(tmp, *out); err != nil {
+		log.Fatal(err)
+	}
+	fmt.Printf("packed %d assets, %d bytes -> %s\n", len(assets), len(data), *out)
+}
@@ -0,0 +1,86 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+const testSource = `#include "ImageData.h"
+// const unsigned char gImage_line[] = { 0x01 };
+/* const unsigned char gImage_block[2] = { 0x02, 0x03 }; */
+const unsigned char gImage_b[] = { /* 0X00,0X01, */
+0X0F,0xf0,255,0,
+};
+const unsigned char gImage_a[5] = {1, 2, 3};
+const unsigned char gImage_c[17] = {
+0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11};
+`
+
+func TestParseAndPack(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "ImageData.c")
+	if err := os.WriteFile(path, []byte(testSource), 0644); err != nil {
+		t.Fatal(err)
+	}
+	assets, err := parseSource(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	want := map[string][]byte{
+		"gImage_a": {1, 2, 3, 0, 0}, // zero filled to the declared size
+		"gImage_b": {0x0F, 0xF0, 0xFF, 0x00},
+		"gImage_c": bytes.Repeat([]byte{0x11}, 17),
+	}
+	if len(assets) != len(want) {
+		t.Fatalf("parsed %d assets, want %d (commented ones skipped)", len(assets), len(want))
+	}
+
+	data, err := pack(assets)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if string(data[:4]) != "EPDA" || binary.LittleEndian.Uint16(data[4:]) != packVersion ||
+		binary.LittleEndian.Uint16(data[6:]) != uint16(len(want)) {
+		t.Fatalf("header % x", data[:headerSize])
+	}
+	prev := ""
+	for i := 0; i < len(want); i++ {
+		e := data[headerSize+i*entrySize:]
+		name := string(bytes.TrimRight(e[:nameSize], "\x00"))
+		off := binary.LittleEndian.Uint32(e[nameSize:])
+		size := binary.LittleEndian.Uint32(e[nameSize+4:])
+		if name <= prev {
+			t.Errorf("entry %d %q not after %q", i, name, prev)
+		}
+		prev = name
+		if off%dataAlign != 0 || off < headerSize+uint32(len(want))*entrySize {
+			t.Errorf("%s at offset %d", name, off)
+		}
+		if int(off+size) > len(data) || !bytes.Equal(data[off:off+size], want[name]) {
+			t.Errorf("%s: % x, want % x", name, data[off:min(int(off+size), len(data))], want[name])
+		}
+	}
+}
+
+func TestPackRejects(t *testing.T) {
+	if _, err := pack([]asset{{name: "x"}, {name: "x"}}); err == nil {
+		t.Error("duplicate names packed")
+	}
+	path := filepath.Join(t.TempDir(), "ImageData.c")
+	src := "const unsigned char a_name_that_is_exactly_forty_bytes_long_[1] = {0};"
+	if err := os.WriteFile(path, []byte(src), 0644); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := parseSource(path); err == nil {
+		t.Error("name too long for the index accepted")
+	}
+	src = "const unsigned char gImage_x[1] = {1, 2};"
+	if err := os.WriteFile(path, []byte(src), 0644); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := parseSource(path); err == nil {
+		t.Error("more initializers than the declared size accepted")
+	}
+}